@@ -0,0 +1,242 @@
+#define STB_IMAGE_IMPLEMENTATION
+// TextureCompressor的无窗口测试：不需要GL上下文
+// 用按格式规范独立实现的解码器(BC7 mode 6、BC4/BC5)把编码结果解回像素，检查块的位布局和误差；再检查.texcache的写入和读回
+// 用法: textureCompressorTest，全部通过时返回0
+#include "TextureCompressor.h"
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool condition, const std::string &message)
+    {
+        if (!condition)
+        {
+            std::cout << "FAILED: " << message << std::endl;
+            g_failures++;
+        }
+    }
+
+    // 按位从低到高读取一个16字节的块
+    struct BitReader
+    {
+        const std::uint8_t *data;
+        int position = 0;
+        std::uint32_t Read(int bits)
+        {
+            std::uint32_t value = 0;
+            for (int i = 0; i < bits; i++, position++)
+                value |= std::uint32_t((data[position >> 3] >> (position & 7)) & 1u) << i;
+            return value;
+        }
+    };
+
+    // BC7只解mode 6(编码器只输出这一种)，不是mode 6时返回false
+    bool decodeBC7Block(const std::uint8_t block[16], std::uint8_t pixels[64])
+    {
+        static constexpr int kWeights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+        BitReader reader{block};
+        int mode = 0;
+        while (mode < 8 && reader.Read(1) == 0)
+            mode++;
+        if (mode != 6)
+            return false;
+        int endpoints[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = static_cast<int>(reader.Read(7));
+            endpoints[1][c] = static_cast<int>(reader.Read(7));
+        }
+        int p0 = static_cast<int>(reader.Read(1));
+        int p1 = static_cast<int>(reader.Read(1));
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+            endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int index = static_cast<int>(reader.Read(i == 0 ? 3 : 4));
+            for (int c = 0; c < 4; c++)
+                pixels[i * 4 + c] = static_cast<std::uint8_t>(((64 - kWeights[index]) * endpoints[0][c] + kWeights[index] * endpoints[1][c] + 32) >> 6);
+        }
+        return true;
+    }
+
+    // BC4：两个端点字节加16个3位索引，r0 > r1时8级插值，否则6级插值再加0和255
+    void decodeBC4Block(const std::uint8_t block[8], std::uint8_t *channel)
+    {
+        int r0 = block[0], r1 = block[1];
+        int palette[8] = {r0, r1};
+        if (r0 > r1)
+        {
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+        }
+        else
+        {
+            for (int i = 2; i < 6; i++)
+                palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 6; i++)
+            bits |= std::uint64_t(block[2 + i]) << (i * 8);
+        for (int i = 0; i < 16; i++)
+            channel[i * 4] = static_cast<std::uint8_t>(palette[(bits >> (i * 3)) & 7]);
+    }
+
+    // 解出level 0，返回和原图的均方根误差(只统计channels个通道)；有块解不出来时返回负数
+    double decodeLevel0(const Renderer::CompressedImage &image, const std::vector<std::uint8_t> &rgba, int width, int height, int channels, int &maxError)
+    {
+        const auto &level = image.levels[0];
+        const std::uint8_t *block = image.data.data() + level.offset;
+        double sum = 0.0;
+        maxError = 0;
+        for (int by = 0; by < (height + 3) / 4; by++)
+        {
+            for (int bx = 0; bx < (width + 3) / 4; bx++, block += 16)
+            {
+                std::uint8_t pixels[64] = {};
+                if (image.codec == Renderer::TextureCodec::BC5)
+                {
+                    decodeBC4Block(block, pixels + 0);
+                    decodeBC4Block(block + 8, pixels + 1);
+                }
+                else if (!decodeBC7Block(block, pixels))
+                    return -1.0;
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
+                    {
+                        int sx = bx * 4 + x, sy = by * 4 + y;
+                        if (sx >= width || sy >= height)
+                            continue;
+                        for (int c = 0; c < channels; c++)
+                        {
+                            int d = int(pixels[(y * 4 + x) * 4 + c]) - int(rgba[(std::size_t(sy) * width + sx) * 4 + c]);
+                            sum += double(d) * d;
+                            maxError = std::max(maxError, std::abs(d));
+                        }
+                    }
+                }
+            }
+        }
+        return std::sqrt(sum / (double(width) * height * channels));
+    }
+
+    std::vector<std::uint8_t> makeImage(int width, int height, auto &&pixel)
+    {
+        std::vector<std::uint8_t> rgba(std::size_t(width) * height * 4);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                pixel(x, y, &rgba[(std::size_t(y) * width + x) * 4]);
+        return rgba;
+    }
+
+    void checkMipChain(const Renderer::CompressedImage &image, int width, int height, const std::string &name)
+    {
+        check(!image.Empty() && image.levels[0].width == std::uint32_t(width) && image.levels[0].height == std::uint32_t(height), name + ": level 0 size");
+        check(image.levels.back().width == 1 && image.levels.back().height == 1, name + ": mip chain ends at 1x1");
+        std::uint64_t expected = 0;
+        for (const auto &level : image.levels)
+        {
+            check(level.offset == expected && level.size == std::uint64_t((level.width + 3) / 4) * ((level.height + 3) / 4) * 16, name + ": level layout");
+            expected += level.size;
+        }
+        check(expected == image.data.size(), name + ": data size");
+    }
+
+    void testBC7()
+    {
+        using Renderer::TextureCodec;
+        // 两个方向的渐变：每个4x4块里的颜色近似共线，mode 6应该几乎无损
+        const int width = 64, height = 64;
+        auto gradient = makeImage(width, height, [](int x, int y, std::uint8_t *p)
+                                  { p[0] = std::uint8_t(x * 4); p[1] = std::uint8_t(y * 4); p[2] = std::uint8_t((x + y) * 2); p[3] = 255; });
+        auto image = Renderer::TextureCompressor::Encode(gradient.data(), width, height, TextureCodec::BC7);
+        checkMipChain(image, width, height, "bc7 gradient");
+        int maxError = 0;
+        double rmse = decodeLevel0(image, gradient, width, height, 4, maxError);
+        std::cout << "bc7 gradient: rmse " << rmse << ", max " << maxError << std::endl;
+        check(rmse >= 0.0, "bc7 gradient: every block decodes as mode 6");
+        check(rmse < 3.0 && maxError <= 12, "bc7 gradient: round-trip error");
+
+        // 2像素的棋盘格，边长不是4的倍数：每块只有两种颜色，端点可以精确表示0和255
+        const int checkerWidth = 30, checkerHeight = 18;
+        auto checker = makeImage(checkerWidth, checkerHeight, [](int x, int y, std::uint8_t *p)
+                                 { std::uint8_t v = ((x / 2 + y / 2) & 1) ? 255 : 0; p[0] = v; p[1] = std::uint8_t(255 - v); p[2] = v; p[3] = v ? 255 : 128; });
+        image = Renderer::TextureCompressor::Encode(checker.data(), checkerWidth, checkerHeight, TextureCodec::BC7_sRGB);
+        checkMipChain(image, checkerWidth, checkerHeight, "bc7 checker");
+        rmse = decodeLevel0(image, checker, checkerWidth, checkerHeight, 4, maxError);
+        std::cout << "bc7 checker: rmse " << rmse << ", max " << maxError << std::endl;
+        check(rmse >= 0.0 && maxError <= 1, "bc7 checker: round-trip error");
+    }
+
+    void testBC5()
+    {
+        // R、G是两个互不相关的通道，各自的BC4块只保证它们自己的精度
+        const int width = 32, height = 32;
+        auto normals = makeImage(width, height, [](int x, int y, std::uint8_t *p)
+                                 { p[0] = std::uint8_t(x * 8); p[1] = std::uint8_t(255 - y * 8 - (x & 1) * 3); p[2] = 255; p[3] = 255; });
+        auto image = Renderer::TextureCompressor::Encode(normals.data(), width, height, Renderer::TextureCodec::BC5);
+        checkMipChain(image, width, height, "bc5");
+        int maxError = 0;
+        double rmse = decodeLevel0(image, normals, width, height, 2, maxError);
+        std::cout << "bc5: rmse " << rmse << ", max " << maxError << std::endl;
+        // 8级插值，误差不超过端点距离的1/14
+        check(rmse < 1.5 && maxError <= 3, "bc5: round-trip error");
+    }
+
+    void testCache()
+    {
+        using Renderer::TextureCompressor;
+        auto directory = std::filesystem::temp_directory_path() / "textureCompressorTest";
+        std::filesystem::create_directories(directory);
+        std::string path = TextureCompressor::CachePathFor((directory / "image.png").string(), Renderer::TextureCodec::BC7);
+        auto rgba = makeImage(20, 12, [](int x, int y, std::uint8_t *p)
+                              { p[0] = std::uint8_t(x * 12); p[1] = std::uint8_t(y * 20); p[2] = std::uint8_t(x ^ y); p[3] = 200; });
+        auto image = TextureCompressor::Encode(rgba.data(), 20, 12, Renderer::TextureCodec::BC7);
+        constexpr std::uint64_t kHash = 0x1234567890abcdefull;
+        check(TextureCompressor::Write(path, kHash, image), "texcache: write");
+
+        Renderer::CompressedImage read;
+        check(TextureCompressor::Read(path, kHash, Renderer::TextureCodec::BC7, read), "texcache: read");
+        check(read.codec == image.codec && read.data == image.data && read.levels.size() == image.levels.size(), "texcache: read back the same data");
+        for (std::size_t i = 0; i < std::min(read.levels.size(), image.levels.size()); i++)
+        {
+            const auto &a = read.levels[i], &b = image.levels[i];
+            check(a.width == b.width && a.height == b.height && a.offset == b.offset && a.size == b.size, "texcache: level " + std::to_string(i));
+        }
+        check(!TextureCompressor::Read(path, kHash + 1, Renderer::TextureCodec::BC7, read), "texcache: rejects a different source hash");
+        check(!TextureCompressor::Read(path, kHash, Renderer::TextureCodec::BC5, read), "texcache: rejects a different codec");
+
+        // 截断的文件不能被当成有效缓存
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+        check(!TextureCompressor::Read(path, kHash, Renderer::TextureCodec::BC7, read), "texcache: rejects a truncated file");
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+}
+
+int main()
+{
+    testBC7();
+    testBC5();
+    testCache();
+    if (g_failures)
+    {
+        std::cout << "textureCompressorTest: " << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "textureCompressorTest: all checks passed" << std::endl;
+    return 0;
+}
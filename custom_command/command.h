@@ -1,6 +1,7 @@
 #pragma once
 #include "RenderQueue.h"
 #include "GBuffer.h"
+#include "FrameDataBuffer.h"
 inline void renderSphere();
 inline void renderQuad();
 inline void renderCube();
@@ -17,22 +18,19 @@ inline void pbrInitFunc(Renderer::Shader *shader, Camera *cam, Renderer::WindowS
     shader->setInt("material.aoMap", 7);
     shader->setVec3("albedo", 0.5f, 0.0f, 0.0f);
     shader->setFloat("ao", 1.0f);
-
-    auto resolution = window->GetFramebufferDims();
-    glm::mat4 projection = glm::perspective(glm::radians(cam->Zoom), (float)resolution.first / (float)resolution.second, 0.1f, 100.0f);
-    shader->setMat4("projection", projection);
     shader->unuse();
-    scene->SetSkybox(projection);
+    // 投影矩阵每帧由PBRRender写入FrameData
     scene->Bake(window->GetWindow());
-    shader->unuse();
 }
+// 每个pass一个排序提交列表，每帧重新填充
+inline Renderer::RenderList forwardList;
+inline Renderer::RenderList geometryList;
 inline void pbrRenderFunc(Renderer::Shader *shader, Camera *cam, Renderer::WindowSystem *window, Renderer::Scene *scene)
 {
     shader->use();
     glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = cam->GetViewMatrix();
-    shader->setMat4("view", view);
-    shader->setVec3("camPos", cam->Position);
+    // view、projection和camPos来自FrameData uniform块，不需要逐个着色器设置
+    const auto &frame = Renderer::FrameDataBuffer::GetInstance().Current();
     auto skybox = scene->GetSkybox();
     // bind pre-computed IBL data
     glActiveTexture(GL_TEXTURE0);
@@ -42,24 +40,34 @@ inline void pbrRenderFunc(Renderer::Shader *shader, Camera *cam, Renderer::Windo
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, skybox->GetBRDFLUTMap());
 
-    model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(0.25f));
-    shader->setMat4("model", model);
-    shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+    // 模型的世界矩阵和法线矩阵来自各自的节点层级(Model::SetTransform)，只在变化时重新计算
+    ModelLoader::LodContext lodContext;
+    lodContext.cameraPosition = cam->Position;
+    lodContext.projectionScale = ModelLoader::LodContext::ProjectionScale(glm::radians(cam->Zoom), static_cast<float>(window->GetFramebufferDims().second));
+    lodContext.cullClusters = true;
+    lodContext.viewProjection = frame.viewProjection;
+    // 所有模型的网格按排序键(着色器、VAO、材质、贴图、深度)排序后提交，可以间接绘制的不透明网格合并成glMultiDrawElementsIndirect
+    forwardList.Begin(lodContext);
     auto modelsptr = scene->GetModels();
     for (auto &modelptr : modelsptr)
     {
-        modelptr->Draw(*shader);
+        modelptr->Collect(forwardList, *shader);
+    }
+    forwardList.Submit();
+    for (auto &instanced : scene->GetInstancedModels())
+    {
+        instanced.model->DrawInstanced(*shader, *instanced.instances, lodContext);
     }
 
     // render light source (simply re-render sphere at light positions)
     // this looks a bit off as we use the same shader, but it'll make their positions obvious and
     // keeps the codeprint small.
+    // 光源数组整体一次上传
+    shader->setVec3Array("lightPositions", scene->lightPositions, std::size(scene->lightPositions));
+    shader->setVec3Array("lightColors", scene->lightColors, std::size(scene->lightColors));
     for (unsigned int i = 0; i < sizeof(scene->lightPositions) / sizeof(scene->lightPositions[0]); ++i)
     {
         glm::vec3 newPos = scene->lightPositions[i];
-        shader->setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-        shader->setVec3("lightColors[" + std::to_string(i) + "]", scene->lightColors[i]);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, newPos);
@@ -70,7 +78,7 @@ inline void pbrRenderFunc(Renderer::Shader *shader, Camera *cam, Renderer::Windo
     }
 
     // render skybox (render as last to prevent overdraw)
-    skybox->DrawSkybox(view);
+    skybox->DrawSkybox();
 }
 
 Renderer::GBuffer gBuffer{};
@@ -78,25 +86,11 @@ void inline deferredInitFunc(Renderer::Shader *shader, Camera *cam, Renderer::Wi
 {
     auto resolution = window->GetFramebufferDims();
     gBuffer.Load(resolution.first, resolution.second);
-    // 几何pass
-    shader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(cam->Zoom), (float)resolution.first / (float)resolution.second, 0.1f, 1000.0f);
-    shader->setMat4("projection", projection);
-    shader->unuse();
     glEnable(GL_STENCIL_TEST);
     glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
     glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
 }
 
-void inline lightBoxInitFunc(Renderer::Shader *shader, Camera *cam, Renderer::WindowSystem *window, Renderer::Scene *scene)
-{
-    auto resolution = window->GetFramebufferDims();
-    shader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(cam->Zoom), (float)resolution.first / (float)resolution.second, 0.1f, 1000.0f);
-    shader->setMat4("projection", projection);
-    shader->unuse();
-}
-
 void inline deferredRenderGeometryFunc(Renderer::Shader *shader, Camera *cam, Renderer::WindowSystem *window, Renderer::Scene *scene)
 {
     // 几何pass
@@ -105,16 +99,24 @@ void inline deferredRenderGeometryFunc(Renderer::Shader *shader, Camera *cam, Re
     glStencilMask(0xFF);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     shader->use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(1.0f));
-    shader->setMat4("model", model);
-    glm::mat4 view = cam->GetViewMatrix();
-    shader->setMat4("view", view);
-    shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+    const auto &frame = Renderer::FrameDataBuffer::GetInstance().Current();
+    // 模型的世界矩阵和法线矩阵来自各自的节点层级(Model::SetTransform)，只在变化时重新计算
+    ModelLoader::LodContext lodContext;
+    lodContext.cameraPosition = cam->Position;
+    lodContext.projectionScale = ModelLoader::LodContext::ProjectionScale(glm::radians(cam->Zoom), static_cast<float>(window->GetFramebufferDims().second));
+    lodContext.cullClusters = true;
+    lodContext.viewProjection = frame.viewProjection;
+    // 所有模型的网格按排序键(着色器、VAO、材质、贴图、深度)排序后提交，可以间接绘制的不透明网格合并成glMultiDrawElementsIndirect
+    geometryList.Begin(lodContext);
     auto modelsptr = scene->GetModels();
     for (auto &modelptr : modelsptr)
     {
-        modelptr->Draw(*shader);
+        modelptr->Collect(geometryList, *shader);
+    }
+    geometryList.Submit();
+    for (auto &instanced : scene->GetInstancedModels())
+    {
+        instanced.model->DrawInstanced(*shader, *instanced.instances, lodContext);
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     shader->unuse();
@@ -132,29 +134,15 @@ void inline deferredRenderShaderFunc(Renderer::Shader *shader, Camera *cam, Rend
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
     glBlitFramebuffer(0, 0, gBuffer.m_width, gBuffer.m_height, 0, 0, gBuffer.m_width, gBuffer.m_height, GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
     shader->use();
-    shader->setVec3("camPos", cam->Position);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, gBuffer.m_gPositionRoughness);
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, gBuffer.m_gNormalAO);
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, gBuffer.m_gAlbedoMetallic);
-    // render light source (simply re-render sphere at light positions)
-    // this looks a bit off as we use the same shader, but it'll make their positions obvious and
-    // keeps the codeprint small.
-    for (unsigned int i = 0; i < sizeof(scene->lightPositions) / sizeof(scene->lightPositions[0]); ++i)
-    {
-        glm::vec3 newPos = scene->lightPositions[i];
-        shader->setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-        shader->setVec3("lightColors[" + std::to_string(i) + "]", scene->lightColors[i]);
-
-        // model = glm::mat4(1.0f);
-        // model = glm::translate(model, newPos);
-        // model = glm::scale(model, glm::vec3(0.5f));
-        // shader->setMat4("model", model);
-        // shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        // renderSphere();
-    }
+    // 光源数组整体一次上传
+    shader->setVec3Array("lightPositions", scene->lightPositions, std::size(scene->lightPositions));
+    shader->setVec3Array("lightColors", scene->lightColors, std::size(scene->lightColors));
     renderQuad();
     shader->unuse();
     glEnable(GL_DEPTH_TEST);
@@ -166,7 +154,6 @@ inline void lightBoxShaderFunc(Renderer::Shader *shader, Camera *cam, Renderer::
 {
     // 着色pass
     shader->use();
-    shader->setMat4("view", cam->GetViewMatrix());
     glm::mat4 model;
     for (unsigned int i = 0; i < sizeof(scene->lightPositions) / sizeof(scene->lightPositions[0]); ++i)
     {
@@ -263,6 +250,8 @@ inline void renderSphere()
         glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        Renderer::ResourceTracker::GetInstance().Track(Renderer::ResourceKind::Buffer, vbo, Renderer::ResourceCategory::MeshBuffer, "renderSphere", data.size() * sizeof(float));
+        Renderer::ResourceTracker::GetInstance().Track(Renderer::ResourceKind::Buffer, ebo, Renderer::ResourceCategory::MeshBuffer, "renderSphere", indices.size() * sizeof(unsigned int));
         unsigned int stride = (3 + 2 + 3) * sizeof(float);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
@@ -313,6 +302,7 @@ void renderQuad()
         glBindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        Renderer::ResourceTracker::GetInstance().Track(Renderer::ResourceKind::Buffer, quadVBO, Renderer::ResourceCategory::MeshBuffer, "renderQuad", sizeof(quadVertices));
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid *)0);
         glEnableVertexAttribArray(1);
@@ -380,6 +370,7 @@ void renderCube()
         // Fill buffer
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        Renderer::ResourceTracker::GetInstance().Track(Renderer::ResourceKind::Buffer, cubeVBO, Renderer::ResourceCategory::MeshBuffer, "renderCube", sizeof(vertices));
         // Link vertex attributes
         glBindVertexArray(cubeVAO);
         glEnableVertexAttribArray(0);
@@ -0,0 +1,310 @@
+#define STB_IMAGE_IMPLEMENTATION
+// 提交开销的基准测试：不显示窗口，用N个小网格(立方体)分别走逐网格绘制和间接绘制(IndirectDrawBuffer)，
+// 统计每帧CPU提交耗时和含glFinish的整帧耗时，输出两者随网格数的变化以及间接绘制开始更快的网格数(交叉点)
+// 可以在Mesa llvmpipe这类软件GL驱动下运行(--software)
+// 用法: drawBenchmark [--frames N] [--counts 16,64,256,...] [--json out.json] [--csv out.csv]
+//                     [--software] [--material-textures bindless|arrays|bind]
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "FrameDataBuffer.h"
+#include "IndirectDrawBuffer.h"
+#include "BenchmarkCommon.h"
+#include "MaterialTextures.h"
+#include "Mesh.h"
+#include "RenderStats.h"
+#include "Shader.h"
+#include "TransformHierarchy.h"
+#include "filesystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct BenchmarkOptions : Benchmark::CommonOptions
+    {
+        int frames = 100;
+        std::vector<std::size_t> counts = {16, 64, 256, 1024, 4096, 16384};
+    };
+
+    struct BenchmarkResult
+    {
+        std::size_t meshes = 0;
+        // 每帧平均值
+        double directSubmitMs = 0.0;
+        double directFrameMs = 0.0;
+        double indirectSubmitMs = 0.0;
+        double indirectFrameMs = 0.0;
+        std::uint64_t directDrawCalls = 0;
+        std::uint64_t indirectDrawCalls = 0;
+    };
+
+    bool parseArgs(int argc, char **argv, BenchmarkOptions &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--frames" && hasValue)
+                options.frames = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--counts" && hasValue)
+            {
+                options.counts.clear();
+                std::stringstream list(argv[++i]);
+                for (std::string item; std::getline(list, item, ',');)
+                {
+                    if (long count = std::atol(item.c_str()); count > 0)
+                        options.counts.push_back(static_cast<std::size_t>(count));
+                }
+                if (options.counts.empty())
+                    return false;
+            }
+            else if (bool valid = true; Benchmark::ParseCommonArg(argc, argv, i, options, valid))
+            {
+                if (!valid)
+                    return false;
+            }
+            else
+                return false;
+        }
+        std::sort(options.counts.begin(), options.counts.end());
+        return true;
+    }
+
+    // 单位立方体，每个面4个顶点
+    void makeCube(std::vector<ModelLoader::Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const glm::vec3 normals[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for (const auto &normal : normals)
+        {
+            glm::vec3 u = glm::abs(normal.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+            glm::vec3 v = glm::cross(normal, u);
+            auto base = static_cast<unsigned int>(vertices.size());
+            for (int corner = 0; corner < 4; corner++)
+            {
+                ModelLoader::Vertex vertex{};
+                float s = corner & 1 ? 0.5f : -0.5f, t = corner & 2 ? 0.5f : -0.5f;
+                vertex.Position = normal * 0.5f + u * s + v * t;
+                vertex.Normal = normal;
+                vertex.TexCoords = glm::vec2(s + 0.5f, t + 0.5f);
+                vertices.push_back(vertex);
+            }
+            for (unsigned int index : {0u, 1u, 3u, 0u, 3u, 2u})
+                indices.push_back(base + index);
+        }
+    }
+
+    // 网格数为count的场景：每个网格一个节点，排成正方形网格，每个网格有自己的材质
+    struct DrawScene
+    {
+        std::vector<std::unique_ptr<ModelLoader::Mesh>> meshes;
+        Renderer::TransformHierarchy transforms;
+
+        explicit DrawScene(std::size_t count)
+        {
+            std::vector<ModelLoader::Vertex> vertices;
+            std::vector<unsigned int> indices;
+            makeCube(vertices, indices);
+            const auto side = static_cast<std::size_t>(std::ceil(std::sqrt(double(count))));
+            const float scale = 2.0f / float(side);
+            transforms.AddNode(-1, glm::mat4(1.0f));
+            meshes.reserve(count);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                glm::vec3 position((float(i % side) + 0.5f) * scale - 1.0f, (float(i / side) + 0.5f) * scale - 1.0f, 0.0f);
+                glm::mat4 local = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(scale * 0.8f));
+                ModelLoader::PBRMaterial material;
+                material.albedo = glm::vec3(float(i % 7) / 7.0f, float(i % 5) / 5.0f, float(i % 3) / 3.0f);
+                auto &mesh = meshes.emplace_back(std::make_unique<ModelLoader::Mesh>(vertices, indices, std::vector<ModelLoader::MeshTexture>(), true, material));
+                mesh->node = transforms.AddNode(0, local);
+            }
+        }
+    };
+
+    // 和Model::Draw一样逐网格设置nodeIndex并绘制
+    void drawDirect(Renderer::Shader &shader, DrawScene &scene, const ModelLoader::LodContext &context)
+    {
+        scene.transforms.Upload();
+        scene.transforms.Bind();
+        shader.setBool("nodeTransform", true);
+        ModelLoader::LodContext meshContext = context;
+        for (auto &mesh : scene.meshes)
+        {
+            shader.setInt("nodeIndex", static_cast<int>(mesh->node));
+            meshContext.model = scene.transforms.World(mesh->node);
+            mesh->Draw(shader, meshContext);
+        }
+        shader.setBool("nodeTransform", false);
+    }
+    // 和Model::DrawIndirect一样收集命令，然后一次提交
+    void drawIndirect(Renderer::Shader &shader, DrawScene &scene, Renderer::IndirectDrawBuffer &draws, const ModelLoader::LodContext &context)
+    {
+        scene.transforms.Upload();
+        draws.Clear();
+        ModelLoader::LodContext meshContext = context;
+        for (auto &mesh : scene.meshes)
+        {
+            meshContext.model = scene.transforms.World(mesh->node);
+            if (mesh->SupportsIndirect())
+                draws.Add(*mesh, meshContext, scene.transforms.Normal(mesh->node));
+        }
+        draws.Submit(shader);
+    }
+
+    // 先跑几帧预热(驱动编译着色器变体、分配缓冲)，再统计frames帧的平均值
+    template <typename DrawFunc>
+    void measure(GLFWwindow *window, int frames, DrawFunc &&draw, double &submitMs, double &frameMs, std::uint64_t &drawCalls)
+    {
+        constexpr int kWarmupFrames = 5;
+        auto &stats = Renderer::RenderStats::GetInstance();
+        double submitTotal = 0.0, frameTotal = 0.0;
+        for (int frame = 0; frame < kWarmupFrames + frames; frame++)
+        {
+            stats.BeginFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            auto start = std::chrono::steady_clock::now();
+            draw();
+            auto submitted = std::chrono::steady_clock::now();
+            glFinish();
+            auto finished = std::chrono::steady_clock::now();
+            glfwSwapBuffers(window);
+            if (frame < kWarmupFrames)
+                continue;
+            submitTotal += std::chrono::duration<double, std::milli>(submitted - start).count();
+            frameTotal += std::chrono::duration<double, std::milli>(finished - start).count();
+        }
+        submitMs = submitTotal / frames;
+        frameMs = frameTotal / frames;
+        drawCalls = stats.CurrentFrame().drawCalls;
+    }
+
+    void writeJson(const std::string &path, const std::string &renderer, const BenchmarkOptions &options, const std::vector<BenchmarkResult> &results, std::size_t crossover)
+    {
+        std::ofstream out(path);
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"renderer\": \"" << renderer << "\",\n  \"frames\": " << options.frames << ",\n  \"crossover\": " << crossover << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); i++)
+        {
+            const auto &result = results[i];
+            out << (i ? "," : "") << "\n    {\"meshes\": " << result.meshes << ", \"directSubmitMs\": " << result.directSubmitMs << ", \"directFrameMs\": " << result.directFrameMs
+                << ", \"directDrawCalls\": " << result.directDrawCalls << ", \"indirectSubmitMs\": " << result.indirectSubmitMs << ", \"indirectFrameMs\": " << result.indirectFrameMs
+                << ", \"indirectDrawCalls\": " << result.indirectDrawCalls << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+    void writeCsv(const std::string &path, const std::vector<BenchmarkResult> &results)
+    {
+        std::ofstream out(path);
+        out << std::fixed << std::setprecision(4);
+        out << "meshes,direct_submit_ms,direct_frame_ms,direct_draw_calls,indirect_submit_ms,indirect_frame_ms,indirect_draw_calls\n";
+        for (const auto &result : results)
+        {
+            out << result.meshes << ',' << result.directSubmitMs << ',' << result.directFrameMs << ',' << result.directDrawCalls << ','
+                << result.indirectSubmitMs << ',' << result.indirectFrameMs << ',' << result.indirectDrawCalls << '\n';
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        std::cout << "usage: drawBenchmark [--frames N] [--counts 16,64,256,...] [--json out.json] [--csv out.csv] "
+                     "[--software] [--material-textures bindless|arrays|bind]"
+                  << std::endl;
+        return 1;
+    }
+
+    // 着色器使用gl_DrawID，需要4.6
+    GLFWwindow *window = Benchmark::CreateHiddenContext(options.software, "drawBenchmark", 6);
+    if (!window)
+    {
+        std::cout << "drawBenchmark: failed to create an OpenGL 4.6 context" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "drawBenchmark: failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    std::string renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    std::cout << "drawBenchmark: " << renderer << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+    Renderer::MaterialTextures::GetInstance().Initialize(options.materialTextures);
+
+    std::vector<BenchmarkResult> results;
+    {
+        Renderer::Shader shader("drawBenchmark", FileSystem::getPath("shader/G-Buffer/g_buffer.vs").c_str(), FileSystem::getPath("shader/G-Buffer/g_buffer.fs").c_str());
+        Renderer::IndirectDrawBuffer draws;
+        shader.use();
+        // 相机固定不动，FrameData只写一次
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Renderer::FrameDataBuffer::GetInstance().BeginFrame(view, glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f), glm::vec3(0.0f, 0.0f, 3.0f), glm::vec2(64.0f), 0.0f, 0.0f,
+                                                             0.1f, 100.0f);
+        Renderer::FrameDataBuffer::GetInstance().EndFrame();
+        glEnable(GL_DEPTH_TEST);
+
+        ModelLoader::LodContext context;
+        context.cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f);
+        context.projectionScale = ModelLoader::LodContext::ProjectionScale(glm::radians(45.0f), 64.0f);
+        for (std::size_t count : options.counts)
+        {
+            DrawScene scene(count);
+            BenchmarkResult &result = results.emplace_back();
+            result.meshes = count;
+            measure(window, options.frames, [&]
+                    { drawDirect(shader, scene, context); }, result.directSubmitMs, result.directFrameMs, result.directDrawCalls);
+            measure(window, options.frames, [&]
+                    { drawIndirect(shader, scene, draws, context); }, result.indirectSubmitMs, result.indirectFrameMs, result.indirectDrawCalls);
+        }
+        shader.unuse();
+    }
+
+    // 交叉点：间接绘制的CPU提交耗时开始低于逐网格绘制的最小网格数，0表示测试范围内没有出现
+    std::size_t crossover = 0;
+    for (const auto &result : results)
+    {
+        if (result.indirectSubmitMs < result.directSubmitMs)
+        {
+            crossover = result.meshes;
+            break;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(3) << "\ndrawBenchmark results (ms per frame, submit = CPU time to issue the draws, frame = submit + glFinish)" << std::endl;
+    std::cout << std::setw(8) << "meshes" << std::setw(16) << "direct submit" << std::setw(14) << "direct frame" << std::setw(8) << "draws"
+              << std::setw(18) << "indirect submit" << std::setw(16) << "indirect frame" << std::setw(8) << "draws" << std::endl;
+    for (const auto &result : results)
+    {
+        std::cout << std::setw(8) << result.meshes << std::setw(16) << result.directSubmitMs << std::setw(14) << result.directFrameMs << std::setw(8) << result.directDrawCalls
+                  << std::setw(18) << result.indirectSubmitMs << std::setw(16) << result.indirectFrameMs << std::setw(8) << result.indirectDrawCalls << std::endl;
+    }
+    if (crossover > 0)
+        std::cout << "crossover: indirect submission is cheaper from " << crossover << " meshes" << std::endl;
+    else
+        std::cout << "crossover: not reached in the tested range" << std::endl;
+    if (!options.jsonPath.empty())
+        writeJson(options.jsonPath, renderer, options, results, crossover);
+    if (!options.csvPath.empty())
+        writeCsv(options.csvPath, results);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
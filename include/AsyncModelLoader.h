@@ -0,0 +1,182 @@
+#pragma once
+// 渐进式模型加载：读缓存/导入/网格转换在加载线程上进行，GL线程每帧在时间预算内逐个创建Mesh
+// 网格创建之前绘制它的包围盒代理，纹理沿用TextureStreamer的占位纹理，渲染循环不用等模型加载完成
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Renderer
+{
+    enum class ModelLoadState
+    {
+        Loading,   // 加载线程上读取和转换网格
+        Uploading, // GL线程上逐个创建网格，等待纹理驻留
+        Ready,
+        Cancelled,
+        Failed
+    };
+
+    class ModelLoadHandle
+    {
+    public:
+        ModelLoadHandle(std::string path, std::shared_ptr<ModelLoader::Model> model) : m_path(std::move(path)), m_model(std::move(model))
+        {
+        }
+        ModelLoadHandle(const ModelLoadHandle &) = delete;
+        ModelLoadHandle &operator=(const ModelLoadHandle &) = delete;
+
+        const std::string &Path() const noexcept { return m_path; }
+        // 加载期间模型只有代理网格，Ready之后才完整
+        const std::shared_ptr<ModelLoader::Model> &GetModel() const noexcept { return m_model; }
+        ModelLoadState GetState() const noexcept { return m_state.load(); }
+        bool IsDone() const noexcept
+        {
+            auto state = GetState();
+            return state == ModelLoadState::Ready || state == ModelLoadState::Cancelled || state == ModelLoadState::Failed;
+        }
+        // 0到1：网格转换、网格创建、纹理驻留分别占0.45、0.45、0.1
+        float Progress() const noexcept
+        {
+            if (GetState() == ModelLoadState::Ready)
+                return 1.0f;
+            std::size_t count = m_progress.meshCount.load();
+            if (count == 0)
+                return 0.0f;
+            return 0.45f * float(m_progress.convertedMeshes.load()) / float(count) + 0.45f * float(m_progress.uploadedMeshes.load()) / float(count) +
+                   0.1f * m_textureProgress.load();
+        }
+        // 任意线程都可以调用：加载线程不再转换剩下的网格，GL线程在下一次Update时释放已经创建的网格
+        void Cancel() noexcept { m_progress.cancelled = true; }
+
+    private:
+        friend class AsyncModelLoader;
+
+        std::string m_path;
+        std::shared_ptr<ModelLoader::Model> m_model;
+        ModelLoader::ModelLoadProgress m_progress;
+        std::atomic<ModelLoadState> m_state{ModelLoadState::Loading};
+        std::atomic<float> m_textureProgress{0.0f};
+        std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+        // 加载线程完成Prepare后交给GL线程，之后只在GL线程访问
+        std::mutex m_mutex;
+        bool m_prepareFinished = false;
+        std::unique_ptr<ModelLoader::PreparedModel> m_prepared;
+    };
+
+    class AsyncModelLoader
+    {
+        AsyncModelLoader() = default;
+        // 加载线程在静态析构时才退出，这时GL上下文已经销毁，未完成的加载不再创建GL对象
+        ~AsyncModelLoader() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static AsyncModelLoader instance{};
+            return instance;
+        }
+        AsyncModelLoader(const AsyncModelLoader &) = delete;
+        AsyncModelLoader &operator=(const AsyncModelLoader &) = delete;
+
+        // 立即返回句柄，模型在加载线程上准备好之后由Update在GL线程上分帧创建
+        std::shared_ptr<ModelLoadHandle> Load(const std::string &path, bool gamma = false, bool PBR = false, ModelLoader::ModelLoadOptions options = ModelLoader::ModelLoadOptions())
+        {
+            auto model = std::make_shared<ModelLoader::Model>(ModelLoader::deferredLoad, gamma, PBR, options);
+            auto handle = std::make_shared<ModelLoadHandle>(path, std::move(model));
+            m_loading.push_back(handle);
+            m_loadPool.Submit([handle]
+                              {
+                                  auto prepared = std::make_unique<ModelLoader::PreparedModel>();
+                                  bool ok = !handle->m_progress.cancelled && handle->m_model->Prepare(handle->m_path, *prepared, &handle->m_progress);
+                                  std::lock_guard<std::mutex> lock(handle->m_mutex);
+                                  if (ok)
+                                      handle->m_prepared = std::move(prepared);
+                                  handle->m_prepareFinished = true; });
+            return handle;
+        }
+
+        // 在GL线程每帧调用：创建网格的总耗时不超过budgetMs(每帧至少创建一个，保证加载能推进)，并移除已经结束的加载
+        void Update(double budgetMs = 4.0)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool uploaded = false;
+            for (auto &handle : m_loading)
+                step(*handle, start, budgetMs, uploaded);
+            std::erase_if(m_loading, [](const std::shared_ptr<ModelLoadHandle> &handle)
+                          { return handle->IsDone(); });
+        }
+
+        std::size_t PendingCount() const noexcept { return m_loading.size(); }
+
+    private:
+        void step(ModelLoadHandle &handle, std::chrono::steady_clock::time_point start, double budgetMs, bool &uploaded)
+        {
+            auto &model = *handle.m_model;
+            if (handle.GetState() == ModelLoadState::Loading)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(handle.m_mutex);
+                    if (!handle.m_prepareFinished)
+                        return;
+                }
+                if (handle.m_progress.cancelled)
+                {
+                    handle.m_prepared.reset();
+                    handle.m_state = ModelLoadState::Cancelled;
+                    return;
+                }
+                if (!handle.m_prepared)
+                {
+                    std::cout << "AsyncModelLoader: failed to load " << handle.m_path << std::endl;
+                    handle.m_state = ModelLoadState::Failed;
+                    return;
+                }
+                model.BeginUpload(*handle.m_prepared, true);
+                handle.m_state = ModelLoadState::Uploading;
+            }
+
+            if (handle.m_progress.cancelled)
+            {
+                model.Unload();
+                handle.m_prepared.reset();
+                handle.m_state = ModelLoadState::Cancelled;
+                std::cout << "AsyncModelLoader: cancelled " << handle.m_path << std::endl;
+                return;
+            }
+            while (handle.m_prepared)
+            {
+                if (uploaded && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+                    return;
+                bool more = model.UploadNext(*handle.m_prepared);
+                uploaded = true;
+                handle.m_progress.uploadedMeshes = handle.m_prepared->nextMesh;
+                // 网格全部创建完，释放源数据(网格缓存的映射、导入器等)
+                if (!more)
+                    handle.m_prepared.reset();
+            }
+
+            // 纹理由TextureStreamer上传，全部驻留后才算加载完成(解码失败的纹理不会驻留，streamer空闲时也结束)
+            std::size_t resident = 0;
+            for (const auto &texture : model.textures_loaded)
+                resident += texture->IsResident() ? 1 : 0;
+            handle.m_textureProgress = model.textures_loaded.empty() ? 1.0f : float(resident) / float(model.textures_loaded.size());
+            if (resident == model.textures_loaded.size() || TextureStreamer::GetInstance().PendingCount() == 0)
+            {
+                handle.m_state = ModelLoadState::Ready;
+                std::cout << "AsyncModelLoader: " << handle.m_path << " ready in "
+                          << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - handle.m_start).count() << " ms" << std::endl;
+            }
+        }
+
+        // 单独的加载线程：Prepare内部的网格转换还会提交到共享的ThreadPool并等待结果，不能在共享池里执行
+        ThreadPool m_loadPool{1};
+        std::vector<std::shared_ptr<ModelLoadHandle>> m_loading;
+    };
+}
@@ -0,0 +1,86 @@
+#pragma once
+// loadBenchmark和drawBenchmark共用：不显示窗口的GL上下文，以及两者共有的命令行参数
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "MaterialTextures.h"
+
+#include <cstdlib>
+#include <string>
+
+namespace Benchmark
+{
+    // --json/--csv/--software/--material-textures
+    struct CommonOptions
+    {
+        bool software = false;
+        Renderer::MaterialTextureMode materialTextures = Renderer::MaterialTextureMode::Bindless;
+        std::string jsonPath;
+        std::string csvPath;
+    };
+
+    // argv[i]是共用参数时解析它(需要值的参数会让i前进)并返回true；值不合法时valid置为false
+    inline bool ParseCommonArg(int argc, char **argv, int &i, CommonOptions &options, bool &valid)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue)
+            options.jsonPath = argv[++i];
+        else if (arg == "--csv" && hasValue)
+            options.csvPath = argv[++i];
+        else if (arg == "--software")
+            options.software = true;
+        else if (arg == "--material-textures" && hasValue)
+        {
+            std::string mode = argv[++i];
+            if (mode == "bindless")
+                options.materialTextures = Renderer::MaterialTextureMode::Bindless;
+            else if (mode == "arrays")
+                options.materialTextures = Renderer::MaterialTextureMode::Arrays;
+            else if (mode == "bind")
+                options.materialTextures = Renderer::MaterialTextureMode::Bind;
+            else
+                valid = false;
+        }
+        else
+            return false;
+        return true;
+    }
+
+    // 隐藏窗口的core profile上下文，从4.6开始依次尝试到4.minMinor(llvmpipe等驱动可能只有4.5)
+    // software为true时让Mesa使用llvmpipe软件渲染
+    // Linux上没有X11/Wayland显示时(GLFW 3.4+)改用null平台和OSMesa创建上下文，不需要窗口系统；更早的GLFW需要用xvfb-run运行
+    inline GLFWwindow *CreateHiddenContext(bool software, const char *title, int minMinor = 6)
+    {
+        if (software)
+        {
+#ifdef _WIN32
+            _putenv_s("GALLIUM_DRIVER", "llvmpipe");
+#else
+            setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+            setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+#endif
+        }
+#if defined(__linux__) && defined(GLFW_PLATFORM_NULL)
+        const bool headless = !std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY");
+        if (headless)
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+        if (!glfwInit())
+            return nullptr;
+#if defined(__linux__) && defined(GLFW_PLATFORM_NULL)
+        if (headless)
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        for (int minor = 6; minor >= minMinor; minor--)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+            if (GLFWwindow *window = glfwCreateWindow(64, 64, title, nullptr, nullptr))
+                return window;
+        }
+        return nullptr;
+    }
+}
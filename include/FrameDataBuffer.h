@@ -0,0 +1,163 @@
+#pragma once
+// 每帧一次的相机和时间数据：std140的uniform块FrameData，固定在binding 0，所有着色器共用
+// 每帧开始时写一次，不再逐个着色器设置view/projection/camPos
+// 缓冲三重缓冲并持久映射，每帧写下一个槽位；写之前等待该槽位三帧前放下的fence，保证GPU已经读完
+#include <glad/glad.h>
+
+#include "ResourceTracker.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace Renderer
+{
+    constexpr GLuint kFrameDataBinding = 0;
+
+    // 和shader/frame_data.glsl中std140的FrameData一致
+    struct FrameData
+    {
+        glm::mat4 view = glm::mat4(1.0f);
+        glm::mat4 projection = glm::mat4(1.0f);
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        glm::mat4 inverseView = glm::mat4(1.0f);
+        glm::mat4 inverseProjection = glm::mat4(1.0f);
+        // 上一帧的矩阵(第一帧等于当前帧)，给运动矢量、时间性抗锯齿之类的效果用
+        glm::mat4 previousView = glm::mat4(1.0f);
+        glm::mat4 previousProjection = glm::mat4(1.0f);
+        glm::mat4 previousViewProjection = glm::mat4(1.0f);
+        // w没有使用
+        glm::vec4 cameraPosition = glm::vec4(0.0f);
+        glm::vec2 resolution = glm::vec2(0.0f);
+        float time = 0.0f;
+        float deltaTime = 0.0f;
+        float nearPlane = 0.0f;
+        float farPlane = 0.0f;
+        std::uint32_t frameIndex = 0;
+        std::uint32_t padding = 0;
+    };
+    static_assert(sizeof(FrameData) == 560, "FrameData must match the std140 FrameData layout");
+
+    class FrameDataBuffer
+    {
+        FrameDataBuffer() = default;
+        // 静态析构时GL上下文已经销毁，不释放GL对象
+        ~FrameDataBuffer() = default;
+
+    public:
+        static constexpr std::uint32_t kFramesInFlight = 3;
+
+        static auto &GetInstance()
+        {
+            static FrameDataBuffer instance{};
+            return instance;
+        }
+        FrameDataBuffer(const FrameDataBuffer &) = delete;
+        FrameDataBuffer &operator=(const FrameDataBuffer &) = delete;
+
+        // 每帧渲染之前调用一次：补全逆矩阵和上一帧的矩阵，写入这一帧的槽位并绑定到kFrameDataBinding
+        void BeginFrame(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition, glm::vec2 resolution, float time, float deltaTime,
+                        float nearPlane, float farPlane)
+        {
+            if (!m_buffer)
+                allocate();
+            FrameData data;
+            data.view = view;
+            data.projection = projection;
+            data.viewProjection = projection * view;
+            data.inverseView = glm::inverse(view);
+            data.inverseProjection = glm::inverse(projection);
+            const bool first = m_frameIndex == 0;
+            data.previousView = first ? view : m_current.view;
+            data.previousProjection = first ? projection : m_current.projection;
+            data.previousViewProjection = first ? data.viewProjection : m_current.viewProjection;
+            data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+            data.resolution = resolution;
+            data.time = time;
+            data.deltaTime = deltaTime;
+            data.nearPlane = nearPlane;
+            data.farPlane = farPlane;
+            data.frameIndex = m_frameIndex;
+            m_current = data;
+
+            m_slot = m_frameIndex % kFramesInFlight;
+            waitSlot(m_slot);
+            const std::size_t offset = std::size_t(m_slot) * m_slotSize;
+            if (m_mapped)
+                std::memcpy(m_mapped + offset, &data, sizeof(FrameData));
+            else
+            {
+                // 映射失败时退回到glBufferSubData
+                glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+                glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(FrameData), &data);
+                glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            }
+            glBindBufferRange(GL_UNIFORM_BUFFER, kFrameDataBinding, m_buffer, offset, sizeof(FrameData));
+            m_frameIndex++;
+        }
+        // 这一帧读取FrameData的绘制全部提交之后调用，在槽位上放fence
+        void EndFrame()
+        {
+            if (!m_buffer)
+                return;
+            if (m_fences[m_slot])
+                glDeleteSync(m_fences[m_slot]);
+            m_fences[m_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        // 这一帧写入的数据，CPU端的剔除、LOD选择和排序直接复用
+        const FrameData &Current() const noexcept { return m_current; }
+
+    private:
+        void allocate()
+        {
+            GLint alignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            const std::size_t align = static_cast<std::size_t>(std::max(alignment, 1));
+            m_slotSize = (sizeof(FrameData) + align - 1) / align * align;
+            const std::size_t bytes = m_slotSize * kFramesInFlight;
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glBufferStorage(GL_UNIFORM_BUFFER, bytes, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+            m_mapped = static_cast<std::uint8_t *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, bytes, flags));
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            if (!m_mapped)
+                std::cout << "FrameDataBuffer: failed to map the frame data buffer" << std::endl;
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_buffer, ResourceCategory::DrawData, "FrameDataBuffer", bytes);
+        }
+        // 一般三帧前的fence早已完成，只有CPU跑得比GPU快三帧以上时才会真正等待
+        void waitSlot(std::uint32_t slot)
+        {
+            GLsync fence = m_fences[slot];
+            if (!fence)
+                return;
+            constexpr GLuint64 kTimeout = 1000000000; // 1秒
+            while (true)
+            {
+                // 刷新命令队列，保证fence已经提交给GPU
+                GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kTimeout);
+                if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+                    break;
+                if (result == GL_WAIT_FAILED)
+                {
+                    std::cout << "FrameDataBuffer: glClientWaitSync failed" << std::endl;
+                    break;
+                }
+            }
+            glDeleteSync(fence);
+            m_fences[slot] = nullptr;
+        }
+
+        GLuint m_buffer = 0;
+        std::uint8_t *m_mapped = nullptr;
+        std::size_t m_slotSize = 0;
+        GLsync m_fences[kFramesInFlight] = {};
+        std::uint32_t m_slot = 0;
+        std::uint32_t m_frameIndex = 0;
+        FrameData m_current;
+    };
+}
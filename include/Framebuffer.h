@@ -1,5 +1,6 @@
 #pragma once
 #include "glad/glad.h"
+#include "ResourceTracker.h"
 #include <vector>
 #include <ranges>
 namespace Renderer
@@ -18,6 +19,7 @@ namespace Renderer
             glBindTexture(GL_TEXTURE_2D, texture);
 
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 800, 600, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            ResourceTracker::GetInstance().Track(ResourceKind::Texture, texture, ResourceCategory::Framebuffer, "Framebuffer", TextureBytes(GL_RGB, 800, 600));
 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -30,6 +32,7 @@ namespace Renderer
             glGenRenderbuffers(1, &rbo);
             glBindRenderbuffer(GL_RENDERBUFFER, rbo);
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 800, 600);
+            ResourceTracker::GetInstance().Track(ResourceKind::Renderbuffer, rbo, ResourceCategory::Framebuffer, "Framebuffer", TextureBytes(GL_DEPTH24_STENCIL8, 800, 600));
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
             m_rbos.push_back(rbo);
@@ -44,6 +47,11 @@ namespace Renderer
             glDeleteFramebuffers(1, &m_fbo);
             glDeleteTextures(m_textures.size(), m_textures.data());
             glDeleteRenderbuffers(m_rbos.size(), m_rbos.data());
+            auto &tracker = ResourceTracker::GetInstance();
+            for (auto texture : m_textures)
+                tracker.Release(ResourceKind::Texture, texture);
+            for (auto rbo : m_rbos)
+                tracker.Release(ResourceKind::Renderbuffer, rbo);
         };
         void bind() { glBindFramebuffer(GL_FRAMEBUFFER, m_fbo); };
         void unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); };
@@ -52,6 +60,7 @@ namespace Renderer
             GLuint rbo = m_rbos[rbo_id];
             glBindRenderbuffer(GL_RENDERBUFFER, rbo);
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, dst_width, dst_height);
+            ResourceTracker::GetInstance().Track(ResourceKind::Renderbuffer, rbo, ResourceCategory::Framebuffer, "Framebuffer", TextureBytes(GL_DEPTH24_STENCIL8, dst_width, dst_height));
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
         };
@@ -61,6 +70,7 @@ namespace Renderer
             glGenRenderbuffers(1, &rbo);
             glBindRenderbuffer(GL_RENDERBUFFER, rbo);
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, dst_width, dst_height);
+            ResourceTracker::GetInstance().Track(ResourceKind::Renderbuffer, rbo, ResourceCategory::Framebuffer, "Framebuffer", TextureBytes(GL_DEPTH24_STENCIL8, dst_width, dst_height));
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
             if (isbind)
             {
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include "Shader.h"
 #include "filesystem.h"
+#include "ResourceTracker.h"
 namespace Renderer
 {
     class GBuffer
@@ -30,6 +31,11 @@ namespace Renderer
             glDeleteTextures(1, &m_gNormalAO);
             glDeleteTextures(1, &m_gAlbedoMetallic);
             glDeleteTextures(1, &m_gEmission);
+            glDeleteRenderbuffers(1, &m_rboDepth);
+            auto &tracker = ResourceTracker::GetInstance();
+            for (auto texture : {m_gPositionRoughness, m_gNormalAO, m_gAlbedoMetallic})
+                tracker.Release(ResourceKind::Texture, texture);
+            tracker.Release(ResourceKind::Renderbuffer, m_rboDepth);
         }
         void Load(unsigned int width, unsigned int height)
         {
@@ -72,11 +78,16 @@ namespace Renderer
             unsigned int attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
             glDrawBuffers(3, attachments);
             // create and attach depth buffer (renderbuffer)
-            unsigned int rboDepth;
-            glGenRenderbuffers(1, &rboDepth);
-            glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
+            glGenRenderbuffers(1, &m_rboDepth);
+            glBindRenderbuffer(GL_RENDERBUFFER, m_rboDepth);
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rboDepth);
+            // 登记显存占用
+            auto &tracker = ResourceTracker::GetInstance();
+            tracker.Track(ResourceKind::Texture, m_gPositionRoughness, ResourceCategory::GBuffer, "GBuffer.positionRoughness", TextureBytes(GL_RGBA16F, width, height));
+            tracker.Track(ResourceKind::Texture, m_gNormalAO, ResourceCategory::GBuffer, "GBuffer.normalAO", TextureBytes(GL_RGBA16F, width, height));
+            tracker.Track(ResourceKind::Texture, m_gAlbedoMetallic, ResourceCategory::GBuffer, "GBuffer.albedoMetallic", TextureBytes(GL_RGBA, width, height));
+            tracker.Track(ResourceKind::Renderbuffer, m_rboDepth, ResourceCategory::GBuffer, "GBuffer.depth", TextureBytes(GL_DEPTH24_STENCIL8, width, height));
             // finally check if framebuffer is complete
             if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
                 std::cout << "G-Buffer not complete!" << std::endl;
@@ -105,6 +116,8 @@ namespace Renderer
         unsigned int m_gPositionRoughness, m_gNormalAO;
         unsigned int m_gAlbedoMetallic;
         unsigned int m_gEmission;
+        // 深度缓冲
+        unsigned int m_rboDepth = 0;
 
         unsigned int m_width, m_height;
 
@@ -0,0 +1,307 @@
+#pragma once
+// 全局几何体缓冲：每种顶点格式一组大的不可变缓冲(glBufferStorage)，所有Mesh都是其中的一段
+// Mesh只记录baseVertex/firstIndex，用glDrawElementsBaseVertex绘制，同一种格式的网格共用一个VAO，不再每个网格一套VAO/VBO/EBO
+// 一页装不下时再分配新的一页(每页一个VAO)，一般的场景只有一页
+// 索引缓冲按2字节为单位分配，16位和32位索引的网格可以放在同一页(32位索引按4字节对齐)
+#include <glad/glad.h>
+
+#include "InstanceBuffer.h"
+#include "ResourceTracker.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Renderer
+{
+    // 以元素为单位的区间分配器：空闲块按偏移保存，首次适配(可以要求起始偏移对齐)，释放时和相邻空闲块合并
+    class RangeAllocator
+    {
+    public:
+        static constexpr std::uint32_t kInvalidOffset = ~0u;
+
+        explicit RangeAllocator(std::uint32_t capacity = 0) : m_capacity(capacity)
+        {
+            if (capacity > 0)
+                m_free.emplace(0, capacity);
+        }
+        std::uint32_t Allocate(std::uint32_t size, std::uint32_t alignment = 1)
+        {
+            if (size == 0)
+                return kInvalidOffset;
+            for (auto it = m_free.begin(); it != m_free.end(); ++it)
+            {
+                std::uint32_t blockOffset = it->first;
+                std::uint32_t blockSize = it->second;
+                std::uint32_t padding = (alignment - blockOffset % alignment) % alignment;
+                if (blockSize < padding + size)
+                    continue;
+                std::uint32_t offset = blockOffset + padding;
+                std::uint32_t remaining = blockSize - padding - size;
+                m_free.erase(it);
+                // 对齐留下的空隙还是空闲块
+                if (padding > 0)
+                    m_free.emplace(blockOffset, padding);
+                if (remaining > 0)
+                    m_free.emplace(offset + size, remaining);
+                m_used += size;
+                return offset;
+            }
+            return kInvalidOffset;
+        }
+        void Free(std::uint32_t offset, std::uint32_t size)
+        {
+            if (size == 0)
+                return;
+            m_used -= size;
+            auto next = m_free.lower_bound(offset);
+            // 和后一个空闲块相接
+            if (next != m_free.end() && offset + size == next->first)
+            {
+                size += next->second;
+                next = m_free.erase(next);
+            }
+            // 和前一个空闲块相接
+            if (next != m_free.begin())
+            {
+                auto prev = std::prev(next);
+                if (prev->first + prev->second == offset)
+                {
+                    prev->second += size;
+                    return;
+                }
+            }
+            m_free.emplace(offset, size);
+        }
+
+        std::uint32_t Capacity() const noexcept { return m_capacity; }
+        std::uint32_t Used() const noexcept { return m_used; }
+        std::size_t FreeBlocks() const noexcept { return m_free.size(); }
+        std::uint32_t LargestFreeBlock() const
+        {
+            std::uint32_t largest = 0;
+            for (const auto &block : m_free)
+                largest = std::max(largest, block.second);
+            return largest;
+        }
+
+    private:
+        std::map<std::uint32_t, std::uint32_t> m_free;
+        std::uint32_t m_capacity = 0;
+        std::uint32_t m_used = 0;
+    };
+
+    // 一个网格在arena中的位置，page < 0表示无效；firstIndex以该网格自己的索引宽度为单位
+    struct GeometryAllocation
+    {
+        ModelLoader::VertexFormat format = ModelLoader::VertexFormat::Full;
+        ModelLoader::IndexType indexType = ModelLoader::IndexType::UInt32;
+        int page = -1;
+        std::uint32_t baseVertex = 0;
+        std::uint32_t vertexCount = 0;
+        std::uint32_t firstIndex = 0;
+        std::uint32_t indexCount = 0;
+
+        bool Valid() const noexcept { return page >= 0; }
+        GLenum GLIndexType() const noexcept { return ModelLoader::GLIndexType(indexType); }
+        // 网格内第index个索引在页索引缓冲中的字节偏移，直接作为glDrawElements*的indices参数
+        const void *IndexOffset(std::uint32_t index) const noexcept
+        {
+            return (const void *)(std::uintptr_t(firstIndex + index) * ModelLoader::IndexSize(indexType));
+        }
+    };
+
+    // 某种顶点格式的占用和碎片情况，fragmentation = 1 - 最大空闲块/总空闲量，0表示空闲空间是连续的
+    struct GeometryArenaStats
+    {
+        std::size_t pages = 0;
+        std::uint64_t vertexBytesUsed = 0;
+        std::uint64_t vertexBytesCapacity = 0;
+        std::uint64_t indexBytesUsed = 0;
+        std::uint64_t indexBytesCapacity = 0;
+        std::size_t freeBlocks = 0;
+        float vertexFragmentation = 0.0f;
+        float indexFragmentation = 0.0f;
+    };
+
+    class GeometryArena
+    {
+        GeometryArena() = default;
+        // GL对象随上下文一起销毁
+        ~GeometryArena() = default;
+
+    public:
+        // 每页的默认大小，单个网格比这还大时按网格大小单独分一页
+        static constexpr std::uint64_t kPageVertexBytes = 64ull << 20;
+        static constexpr std::uint64_t kPageIndexBytes = 32ull << 20;
+
+        static auto &GetInstance()
+        {
+            static GeometryArena instance{};
+            return instance;
+        }
+        GeometryArena(const GeometryArena &) = delete;
+        GeometryArena &operator=(const GeometryArena &) = delete;
+
+        // 分配并上传一个网格的顶点和索引，索引保持相对网格自身(从0开始)，绘制时加上baseVertex
+        // indexData的宽度由indexType决定，按原样上传
+        GeometryAllocation Allocate(ModelLoader::VertexFormat format, const void *vertexData, std::size_t vertexCount, const void *indexData, ModelLoader::IndexType indexType, std::size_t indexCount)
+        {
+            GeometryAllocation allocation;
+            allocation.format = format;
+            allocation.indexType = indexType;
+            allocation.vertexCount = static_cast<std::uint32_t>(vertexCount);
+            allocation.indexCount = static_cast<std::uint32_t>(indexCount);
+            if (vertexCount == 0 || indexCount == 0)
+                return allocation;
+            auto &pages = m_pages[static_cast<std::size_t>(format)];
+            for (std::size_t i = 0; i < pages.size() && !allocation.Valid(); i++)
+                tryAllocate(*pages[i], static_cast<int>(i), allocation);
+            if (!allocation.Valid())
+            {
+                pages.push_back(createPage(format, vertexCount, indexCount * ModelLoader::IndexSize(indexType)));
+                if (!tryAllocate(*pages.back(), static_cast<int>(pages.size() - 1), allocation))
+                {
+                    std::cout << "GeometryArena: failed to allocate " << vertexCount << " vertices / " << indexCount << " indices" << std::endl;
+                    return allocation;
+                }
+            }
+
+            const Page &page = *pages[allocation.page];
+            const std::size_t stride = ModelLoader::VertexStride(format);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, page.vbo);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, std::uint64_t(allocation.baseVertex) * stride, vertexCount * stride, vertexData);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, page.ebo);
+            const std::size_t indexSize = ModelLoader::IndexSize(indexType);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, std::uint64_t(allocation.firstIndex) * indexSize, indexCount * indexSize, indexData);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            return allocation;
+        }
+        // 释放后这段空间可以被之后加载的网格复用
+        void Free(GeometryAllocation &allocation)
+        {
+            if (!allocation.Valid())
+                return;
+            Page &page = *m_pages[static_cast<std::size_t>(allocation.format)][allocation.page];
+            page.vertices.Free(allocation.baseVertex, allocation.vertexCount);
+            const std::uint32_t units = indexUnits(allocation.indexType);
+            page.indices.Free(allocation.firstIndex * units, allocation.indexCount * units);
+            allocation.page = -1;
+        }
+
+        // 绑定分配所在页的VAO，连续绘制同一页的网格时VAO不变，驱动会跳过重复绑定
+        void Bind(const GeometryAllocation &allocation) const
+        {
+            glBindVertexArray(m_pages[static_cast<std::size_t>(allocation.format)][allocation.page]->vao);
+        }
+
+        GeometryArenaStats GetStats(ModelLoader::VertexFormat format) const
+        {
+            GeometryArenaStats stats;
+            const std::size_t stride = ModelLoader::VertexStride(format);
+            std::uint64_t vertexFree = 0, indexFree = 0, vertexLargest = 0, indexLargest = 0;
+            for (const auto &page : m_pages[static_cast<std::size_t>(format)])
+            {
+                stats.pages++;
+                stats.vertexBytesUsed += std::uint64_t(page->vertices.Used()) * stride;
+                stats.vertexBytesCapacity += std::uint64_t(page->vertices.Capacity()) * stride;
+                stats.indexBytesUsed += std::uint64_t(page->indices.Used()) * kIndexUnitBytes;
+                stats.indexBytesCapacity += std::uint64_t(page->indices.Capacity()) * kIndexUnitBytes;
+                stats.freeBlocks += page->vertices.FreeBlocks() + page->indices.FreeBlocks();
+                vertexFree += page->vertices.Capacity() - page->vertices.Used();
+                indexFree += page->indices.Capacity() - page->indices.Used();
+                vertexLargest = std::max<std::uint64_t>(vertexLargest, page->vertices.LargestFreeBlock());
+                indexLargest = std::max<std::uint64_t>(indexLargest, page->indices.LargestFreeBlock());
+            }
+            stats.vertexFragmentation = vertexFree > 0 ? 1.0f - float(vertexLargest) / float(vertexFree) : 0.0f;
+            stats.indexFragmentation = indexFree > 0 ? 1.0f - float(indexLargest) / float(indexFree) : 0.0f;
+            return stats;
+        }
+        void PrintStats() const
+        {
+            const char *names[] = {"full", "compact"};
+            for (std::size_t format = 0; format < kFormatCount; format++)
+            {
+                auto stats = GetStats(static_cast<ModelLoader::VertexFormat>(format));
+                if (stats.pages == 0)
+                    continue;
+                std::cout << "GeometryArena(" << names[format] << "): " << stats.pages << " pages, vertices "
+                          << stats.vertexBytesUsed / 1024 << "/" << stats.vertexBytesCapacity / 1024 << " KB, indices "
+                          << stats.indexBytesUsed / 1024 << "/" << stats.indexBytesCapacity / 1024 << " KB, "
+                          << stats.freeBlocks << " free blocks, fragmentation " << stats.vertexFragmentation << "/" << stats.indexFragmentation << std::endl;
+            }
+        }
+
+    private:
+        struct Page
+        {
+            GLuint vao = 0;
+            GLuint vbo = 0;
+            GLuint ebo = 0;
+            RangeAllocator vertices;
+            // 以kIndexUnitBytes为单位
+            RangeAllocator indices;
+        };
+        static constexpr std::size_t kFormatCount = 2;
+        static constexpr std::uint32_t kIndexUnitBytes = 2;
+
+        static std::uint32_t indexUnits(ModelLoader::IndexType type)
+        {
+            return static_cast<std::uint32_t>(ModelLoader::IndexSize(type) / kIndexUnitBytes);
+        }
+
+        static bool tryAllocate(Page &page, int pageIndex, GeometryAllocation &allocation)
+        {
+            std::uint32_t baseVertex = page.vertices.Allocate(allocation.vertexCount);
+            if (baseVertex == RangeAllocator::kInvalidOffset)
+                return false;
+            const std::uint32_t units = indexUnits(allocation.indexType);
+            std::uint32_t indexUnit = page.indices.Allocate(allocation.indexCount * units, units);
+            if (indexUnit == RangeAllocator::kInvalidOffset)
+            {
+                page.vertices.Free(baseVertex, allocation.vertexCount);
+                return false;
+            }
+            allocation.page = pageIndex;
+            allocation.baseVertex = baseVertex;
+            allocation.firstIndex = indexUnit / units;
+            return true;
+        }
+        static std::unique_ptr<Page> createPage(ModelLoader::VertexFormat format, std::size_t vertexCount, std::size_t indexBytes)
+        {
+            const std::size_t stride = ModelLoader::VertexStride(format);
+            auto vertexCapacity = static_cast<std::uint32_t>(std::max<std::uint64_t>(kPageVertexBytes / stride, vertexCount));
+            auto indexCapacity = static_cast<std::uint32_t>(std::max<std::uint64_t>(kPageIndexBytes, indexBytes) / kIndexUnitBytes);
+            auto page = std::make_unique<Page>();
+            page->vertices = RangeAllocator(vertexCapacity);
+            page->indices = RangeAllocator(indexCapacity);
+
+            glGenVertexArrays(1, &page->vao);
+            glGenBuffers(1, &page->vbo);
+            glGenBuffers(1, &page->ebo);
+            glBindVertexArray(page->vao);
+            // 不可变存储，只允许用glBufferSubData写入新分配的区间
+            glBindBuffer(GL_ARRAY_BUFFER, page->vbo);
+            glBufferStorage(GL_ARRAY_BUFFER, std::uint64_t(vertexCapacity) * stride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ebo);
+            glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, std::uint64_t(indexCapacity) * kIndexUnitBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            // 页一旦创建就一直保留，登记的是整页容量而不是已经分配出去的部分
+            auto &tracker = ResourceTracker::GetInstance();
+            const std::string owner = format == ModelLoader::VertexFormat::Compact ? "GeometryArena.compact" : "GeometryArena.full";
+            tracker.Track(ResourceKind::Buffer, page->vbo, ResourceCategory::MeshBuffer, owner, std::uint64_t(vertexCapacity) * stride);
+            tracker.Track(ResourceKind::Buffer, page->ebo, ResourceCategory::MeshBuffer, owner, std::uint64_t(indexCapacity) * kIndexUnitBytes);
+            ModelLoader::SetupVertexAttributes(format);
+            // 逐实例属性默认读单位变换，实例化绘制时临时换成实例缓冲
+            ModelLoader::SetupInstanceAttributes();
+            InstanceBuffer::BindIdentity();
+            glBindVertexArray(0);
+            return page;
+        }
+
+        std::vector<std::unique_ptr<Page>> m_pages[kFormatCount];
+    };
+}
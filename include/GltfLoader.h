@@ -0,0 +1,729 @@
+#pragma once
+// glTF 2.0(.gltf + .bin / .glb)的专用加载路径，不经过Assimp的通用场景图
+// .glb和外部.bin都是内存映射的，访问器(accessor)直接从映射内存读到最终的顶点/索引数组里，只有这一次拷贝
+// 结果和Assimp路径(kImportFlags)保持一致：UV上下翻转、缺法线时生成平滑法线、缺切线时按UV计算切线，节点变换不烘焙进顶点，而是保存成节点层级
+// 遇到不支持的特性(稀疏访问器、非三角形图元)时Open返回false，由Model回退到Assimp
+// 内嵌的图片(bufferView或data URI)以"*图片下标"作为纹理路径，由Image()直接给出映射内存中的数据
+#include "ImageSource.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ModelLoader
+{
+    class GltfLoader
+    {
+    public:
+        static bool IsGltf(const std::string &path)
+        {
+            std::string extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                           { return static_cast<char>(std::tolower(c)); });
+            return extension == ".gltf" || extension == ".glb";
+        }
+
+        // 映射文件、解析JSON并校验所有要用到的访问器，之后ProcessPrimitive只读，可以在工作线程上并行调用
+        bool Open(const std::string &path, std::string &error)
+        {
+            m_directory = path.substr(0, path.find_last_of('/'));
+            m_file = std::make_shared<MappedFile>(path);
+            if (!m_file->IsOpen())
+                return fail(error, "failed to open " + path);
+            const char *jsonBegin = reinterpret_cast<const char *>(m_file->Data());
+            const char *jsonEnd = jsonBegin + m_file->Size();
+            Span binChunk{};
+            if (m_file->Size() >= 12 && std::memcmp(m_file->Data(), "glTF", 4) == 0)
+            {
+                if (!parseGlb(jsonBegin, jsonEnd, binChunk, error))
+                    return false;
+            }
+            if (!JsonValue::Parse(jsonBegin, jsonEnd, m_json, &error))
+                return false;
+            if (m_json["asset"]["version"].AsString().rfind("2", 0) != 0)
+                return fail(error, "unsupported glTF version");
+
+            // 缓冲：glb的第一个缓冲可以没有uri，指向BIN块；其余的是外部文件(映射)或者base64的data URI(解码)
+            const JsonValue &buffers = m_json["buffers"];
+            for (std::size_t i = 0; i < buffers.Size(); i++)
+            {
+                const JsonValue &uri = buffers[i]["uri"];
+                std::size_t byteLength = static_cast<std::size_t>(buffers[i]["byteLength"].AsNumber());
+                if (uri.IsNull())
+                {
+                    if (i != 0 || binChunk.data == nullptr || binChunk.size < byteLength)
+                        return fail(error, "buffer " + std::to_string(i) + " has no data");
+                    binChunk.owner = m_file;
+                    m_buffers.push_back(binChunk);
+                    continue;
+                }
+                if (uri.AsString().rfind("data:", 0) == 0)
+                {
+                    auto decoded = std::make_shared<std::vector<std::uint8_t>>();
+                    if (!DecodeDataUri(uri.AsString(), *decoded) || decoded->size() < byteLength)
+                        return fail(error, "invalid data URI in buffer " + std::to_string(i));
+                    m_buffers.push_back({decoded->data(), decoded->size(), decoded});
+                    continue;
+                }
+                auto file = std::make_shared<MappedFile>(m_directory + '/' + DecodeUri(uri.AsString()));
+                if (!file->IsOpen() || file->Size() < byteLength)
+                    return fail(error, "failed to map buffer " + uri.AsString());
+                m_buffers.push_back({file->Data(), file->Size(), file});
+            }
+
+            // 按场景节点的深度优先顺序收集图元和节点层级，场景的各个根节点都挂在节点0(模型根)下面
+            const JsonValue &scenes = m_json["scenes"];
+            const JsonValue &scene = scenes[static_cast<std::size_t>(std::max(m_json["scene"].AsInt(0), 0))];
+            std::vector<int> visited(m_json["nodes"].Size(), 0);
+            m_nodes.assign(1, SceneNode());
+            if (scene.IsNull())
+            {
+                for (std::size_t i = 0; i < m_json["nodes"].Size(); i++)
+                    collectNode(static_cast<int>(i), visited, 0);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < scene["nodes"].Size(); i++)
+                    collectNode(scene["nodes"][i].AsInt(), visited, 0);
+            }
+
+            for (const auto &primitive : m_primitives)
+            {
+                if (!validatePrimitive(*primitive, error))
+                    return false;
+            }
+            return true;
+        }
+
+        std::size_t PrimitiveCount() const noexcept { return m_primitives.size(); }
+        const std::vector<SceneNode> &Nodes() const noexcept { return m_nodes; }
+
+        // 把一个图元转换成MeshData，只做CPU端的工作，不能调用GL
+        MeshData ProcessPrimitive(std::size_t index, bool usePBR) const
+        {
+            const JsonValue &primitive = *m_primitives[index];
+            const JsonValue &attributes = primitive["attributes"];
+            MeshData data;
+            data.node = m_primitiveNodes[index];
+            std::vector<Vertex> &vertices = data.vertices;
+
+            Accessor positions = accessor(attributes["POSITION"].AsInt());
+            vertices.assign(positions.count, Vertex{});
+            for (std::size_t i = 0; i < positions.count; i++)
+                vertices[i].Position = positions.Read<3>(i);
+
+            if (primitive["indices"].IsNull())
+            {
+                data.indices.resize(positions.count);
+                for (std::size_t i = 0; i < positions.count; i++)
+                    data.indices[i] = static_cast<unsigned int>(i);
+            }
+            else
+            {
+                Accessor indices = accessor(primitive["indices"].AsInt());
+                data.indices.resize(indices.count - indices.count % 3);
+                for (std::size_t i = 0; i < data.indices.size(); i++)
+                    data.indices[i] = indices.ReadIndex(i);
+            }
+
+            if (!attributes["NORMAL"].IsNull())
+            {
+                Accessor normals = accessor(attributes["NORMAL"].AsInt());
+                for (std::size_t i = 0; i < vertices.size(); i++)
+                    vertices[i].Normal = normals.Read<3>(i);
+            }
+            else
+                generateNormals(vertices, data.indices);
+
+            bool hasTexCoords = !attributes["TEXCOORD_0"].IsNull();
+            if (hasTexCoords)
+            {
+                // 和aiProcess_FlipUVs一致，纹理按OpenGL的左下角原点采样
+                Accessor texCoords = accessor(attributes["TEXCOORD_0"].AsInt());
+                for (std::size_t i = 0; i < vertices.size(); i++)
+                {
+                    glm::vec2 uv = texCoords.Read<2>(i);
+                    vertices[i].TexCoords = glm::vec2(uv.x, 1.0f - uv.y);
+                }
+            }
+            if (!attributes["TANGENT"].IsNull())
+            {
+                // glTF规定副切线 = cross(N, T.xyz) * T.w
+                Accessor tangents = accessor(attributes["TANGENT"].AsInt());
+                for (std::size_t i = 0; i < vertices.size(); i++)
+                {
+                    glm::vec4 tangent = tangents.Read<4>(i);
+                    vertices[i].Tangent = glm::vec3(tangent);
+                    vertices[i].Bitangent = glm::cross(vertices[i].Normal, glm::vec3(tangent)) * (tangent.w < 0.0f ? -1.0f : 1.0f);
+                }
+            }
+            else if (hasTexCoords)
+                generateTangents(vertices, data.indices);
+
+            bool skinned = !attributes["JOINTS_0"].IsNull() && !attributes["WEIGHTS_0"].IsNull();
+            if (skinned)
+            {
+                Accessor joints = accessor(attributes["JOINTS_0"].AsInt());
+                Accessor weights = accessor(attributes["WEIGHTS_0"].AsInt());
+                for (std::size_t i = 0; i < vertices.size(); i++)
+                {
+                    for (int k = 0; k < MAX_BONE_INFLUENCE; k++)
+                    {
+                        vertices[i].m_BoneIDs[k] = static_cast<int>(joints.ReadComponent(i, k, false));
+                        vertices[i].m_Weights[k] = weights.ReadComponent(i, k, true);
+                    }
+                }
+            }
+            else
+            {
+                // 和Assimp路径一样，没有骨骼的网格用压缩顶点格式
+                data.format = VertexFormat::Compact;
+                data.compactVertices.resize(vertices.size());
+                std::transform(vertices.begin(), vertices.end(), data.compactVertices.begin(), PackVertex);
+                std::vector<Vertex>().swap(vertices);
+            }
+
+            // 没有材质的图元按glTF的默认材质处理(各项参数取默认值)
+            const JsonValue &materialIndex = primitive["material"];
+            processMaterial(materialIndex.IsNull() ? materialIndex : m_json["materials"][static_cast<std::size_t>(std::max(materialIndex.AsInt(), 0))], usePBR, data);
+            return data;
+        }
+
+        // 内嵌图片index的数据，直接指向glb的BIN块(或外部.bin的映射、data URI解码后的缓冲)，不拷贝
+        // 返回的ImageSource持有数据的所有权，GltfLoader销毁后仍然有效；外部文件图片或出错时返回空
+        Renderer::ImageSource Image(std::size_t index) const
+        {
+            Renderer::ImageSource source;
+            const JsonValue &image = m_json["images"][index];
+            if (image["uri"].IsString())
+            {
+                auto decoded = std::make_shared<std::vector<std::uint8_t>>();
+                if (DecodeDataUri(image["uri"].AsString(), *decoded))
+                {
+                    source.data = decoded->data();
+                    source.size = decoded->size();
+                    source.owner = decoded;
+                }
+                return source;
+            }
+            const JsonValue &view = m_json["bufferViews"][static_cast<std::size_t>(std::max(image["bufferView"].AsInt(), 0))];
+            std::size_t buffer = static_cast<std::size_t>(view["buffer"].AsInt());
+            std::size_t offset = static_cast<std::size_t>(view["byteOffset"].AsNumber());
+            std::size_t length = static_cast<std::size_t>(view["byteLength"].AsNumber());
+            if (image["bufferView"].IsNull() || view.IsNull() || buffer >= m_buffers.size() ||
+                offset > m_buffers[buffer].size || length > m_buffers[buffer].size - offset)
+                return source;
+            source.data = m_buffers[buffer].data + offset;
+            source.size = length;
+            source.owner = m_buffers[buffer].owner;
+            return source;
+        }
+
+        // data:[<mime>][;base64],<data>，只支持base64编码
+        static bool DecodeDataUri(const std::string &uri, std::vector<std::uint8_t> &out)
+        {
+            std::size_t comma = uri.find(',');
+            if (uri.rfind("data:", 0) != 0 || comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+                return false;
+            out.clear();
+            out.reserve((uri.size() - comma) / 4 * 3);
+            std::uint32_t bits = 0;
+            int bitCount = 0;
+            for (std::size_t i = comma + 1; i < uri.size() && uri[i] != '='; i++)
+            {
+                char c = uri[i];
+                int value;
+                if (c >= 'A' && c <= 'Z')
+                    value = c - 'A';
+                else if (c >= 'a' && c <= 'z')
+                    value = c - 'a' + 26;
+                else if (c >= '0' && c <= '9')
+                    value = c - '0' + 52;
+                else if (c == '+' || c == '-')
+                    value = 62;
+                else if (c == '/' || c == '_')
+                    value = 63;
+                else if (c == '\r' || c == '\n' || c == ' ')
+                    continue;
+                else
+                    return false;
+                bits = (bits << 6) | static_cast<std::uint32_t>(value);
+                bitCount += 6;
+                if (bitCount >= 8)
+                {
+                    bitCount -= 8;
+                    out.push_back(static_cast<std::uint8_t>(bits >> bitCount));
+                }
+            }
+            return true;
+        }
+
+        // 把URI里的%XX转义还原成文件名
+        static std::string DecodeUri(const std::string &uri)
+        {
+            std::string decoded;
+            decoded.reserve(uri.size());
+            for (std::size_t i = 0; i < uri.size(); i++)
+            {
+                if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+                {
+                    decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                }
+                else
+                    decoded += uri[i];
+            }
+            return decoded;
+        }
+
+        // Open会映射的外部缓冲文件(buffers[].uri解码后的路径)，不含glb的BIN块和data URI；网格缓存用它判断源文件是否改变
+        static std::vector<std::string> ExternalBufferPaths(const std::string &path)
+        {
+            std::vector<std::string> paths;
+            GltfLoader loader;
+            loader.m_file = std::make_shared<MappedFile>(path);
+            if (!loader.m_file->IsOpen())
+                return paths;
+            const char *jsonBegin = reinterpret_cast<const char *>(loader.m_file->Data());
+            const char *jsonEnd = jsonBegin + loader.m_file->Size();
+            Span binChunk{};
+            std::string error;
+            if (loader.m_file->Size() >= 12 && std::memcmp(loader.m_file->Data(), "glTF", 4) == 0 && !loader.parseGlb(jsonBegin, jsonEnd, binChunk, error))
+                return paths;
+            JsonValue json;
+            if (!JsonValue::Parse(jsonBegin, jsonEnd, json))
+                return paths;
+            const std::string directory = path.substr(0, path.find_last_of('/'));
+            const JsonValue &buffers = json["buffers"];
+            for (std::size_t i = 0; i < buffers.Size(); i++)
+            {
+                const JsonValue &uri = buffers[i]["uri"];
+                if (uri.IsString() && uri.AsString().rfind("data:", 0) != 0)
+                    paths.push_back(directory + '/' + DecodeUri(uri.AsString()));
+            }
+            return paths;
+        }
+
+    private:
+        // 缓冲的数据，owner持有映射文件或者解码后的data URI
+        struct Span
+        {
+            const std::uint8_t *data;
+            std::size_t size;
+            std::shared_ptr<const void> owner;
+        };
+
+        // 访问器在映射内存中的视图
+        struct Accessor
+        {
+            const std::uint8_t *data = nullptr;
+            std::size_t count = 0;
+            std::size_t stride = 0;
+            int componentType = 0;
+            int components = 0;
+            bool normalized = false;
+
+            float ReadComponent(std::size_t index, int component, bool normalize) const
+            {
+                if (component >= components)
+                    return 0.0f;
+                const std::uint8_t *p = data + index * stride + component * ComponentSize(componentType);
+                switch (componentType)
+                {
+                case kFloat:
+                {
+                    float value;
+                    std::memcpy(&value, p, sizeof(value));
+                    return value;
+                }
+                case kByte:
+                    return normalize ? std::max(static_cast<std::int8_t>(*p) / 127.0f, -1.0f) : static_cast<float>(static_cast<std::int8_t>(*p));
+                case kUnsignedByte:
+                    return normalize ? *p / 255.0f : static_cast<float>(*p);
+                case kShort:
+                {
+                    std::int16_t value;
+                    std::memcpy(&value, p, sizeof(value));
+                    return normalize ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+                }
+                case kUnsignedShort:
+                {
+                    std::uint16_t value;
+                    std::memcpy(&value, p, sizeof(value));
+                    return normalize ? value / 65535.0f : static_cast<float>(value);
+                }
+                default:
+                {
+                    std::uint32_t value;
+                    std::memcpy(&value, p, sizeof(value));
+                    return static_cast<float>(value);
+                }
+                }
+            }
+            template <int N>
+            glm::vec<N, float> Read(std::size_t index) const
+            {
+                glm::vec<N, float> value(0.0f);
+                if (componentType == kFloat && components >= N)
+                {
+                    std::memcpy(&value, data + index * stride, sizeof(value));
+                    return value;
+                }
+                for (int i = 0; i < N; i++)
+                    value[i] = ReadComponent(index, i, normalized);
+                return value;
+            }
+            unsigned int ReadIndex(std::size_t index) const
+            {
+                const std::uint8_t *p = data + index * stride;
+                if (componentType == kUnsignedByte)
+                    return *p;
+                if (componentType == kUnsignedShort)
+                {
+                    std::uint16_t value;
+                    std::memcpy(&value, p, sizeof(value));
+                    return value;
+                }
+                std::uint32_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return value;
+            }
+        };
+
+        static constexpr int kByte = 5120;
+        static constexpr int kUnsignedByte = 5121;
+        static constexpr int kShort = 5122;
+        static constexpr int kUnsignedShort = 5123;
+        static constexpr int kUnsignedInt = 5125;
+        static constexpr int kFloat = 5126;
+
+        static std::size_t ComponentSize(int componentType)
+        {
+            switch (componentType)
+            {
+            case kByte:
+            case kUnsignedByte:
+                return 1;
+            case kShort:
+            case kUnsignedShort:
+                return 2;
+            case kUnsignedInt:
+            case kFloat:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+        static int ComponentCount(const std::string &type)
+        {
+            if (type == "SCALAR")
+                return 1;
+            if (type == "VEC2")
+                return 2;
+            if (type == "VEC3")
+                return 3;
+            if (type == "VEC4" || type == "MAT2")
+                return 4;
+            if (type == "MAT3")
+                return 9;
+            if (type == "MAT4")
+                return 16;
+            return 0;
+        }
+
+        static bool fail(std::string &error, const std::string &message)
+        {
+            error = message;
+            return false;
+        }
+
+        // glb：12字节文件头，然后是JSON块和可选的BIN块
+        bool parseGlb(const char *&jsonBegin, const char *&jsonEnd, Span &binChunk, std::string &error) const
+        {
+            auto read32 = [this](std::size_t offset)
+            {
+                std::uint32_t value;
+                std::memcpy(&value, m_file->Data() + offset, sizeof(value));
+                return value;
+            };
+            const std::size_t length = std::min<std::size_t>(read32(8), m_file->Size());
+            if (read32(4) != 2)
+                return fail(error, "unsupported glb version");
+            for (std::size_t offset = 12; offset + 8 <= length;)
+            {
+                std::uint32_t chunkLength = read32(offset);
+                std::uint32_t chunkType = read32(offset + 4);
+                if (chunkLength > length - offset - 8)
+                    return fail(error, "truncated glb chunk");
+                const std::uint8_t *chunk = m_file->Data() + offset + 8;
+                if (chunkType == 0x4E4F534A) // "JSON"
+                {
+                    jsonBegin = reinterpret_cast<const char *>(chunk);
+                    jsonEnd = jsonBegin + chunkLength;
+                }
+                else if (chunkType == 0x004E4942 && binChunk.data == nullptr) // "BIN\0"
+                    binChunk = {chunk, chunkLength};
+                offset += 8 + ((chunkLength + 3) & ~3u);
+            }
+            return true;
+        }
+
+        void collectNode(int node, std::vector<int> &visited, std::int32_t parent)
+        {
+            if (node < 0 || static_cast<std::size_t>(node) >= visited.size() || visited[node])
+                return;
+            visited[node] = 1;
+            const JsonValue &nodeJson = m_json["nodes"][static_cast<std::size_t>(node)];
+            auto index = static_cast<std::uint32_t>(m_nodes.size());
+            m_nodes.push_back({nodeMatrix(nodeJson), parent});
+            const JsonValue &mesh = m_json["meshes"][static_cast<std::size_t>(std::max(nodeJson["mesh"].AsInt(), 0))];
+            if (!nodeJson["mesh"].IsNull())
+            {
+                for (std::size_t i = 0; i < mesh["primitives"].Size(); i++)
+                {
+                    m_primitives.push_back(&mesh["primitives"][i]);
+                    m_primitiveNodes.push_back(index);
+                }
+            }
+            for (std::size_t i = 0; i < nodeJson["children"].Size(); i++)
+                collectNode(nodeJson["children"][i].AsInt(), visited, static_cast<std::int32_t>(index));
+        }
+        // 节点的局部变换：matrix(列主序)，或者translation * rotation(四元数xyzw) * scale
+        static glm::mat4 nodeMatrix(const JsonValue &node)
+        {
+            glm::mat4 result(1.0f);
+            const JsonValue &matrix = node["matrix"];
+            if (matrix.Size() == 16)
+            {
+                for (int column = 0; column < 4; column++)
+                    for (int row = 0; row < 4; row++)
+                        result[column][row] = static_cast<float>(matrix[static_cast<std::size_t>(column * 4 + row)].AsNumber());
+                return result;
+            }
+            auto component = [](const JsonValue &array, std::size_t i, float fallback)
+            { return array.Size() > i ? static_cast<float>(array[i].AsNumber(fallback)) : fallback; };
+            const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+            const float x = component(r, 0, 0.0f), y = component(r, 1, 0.0f), z = component(r, 2, 0.0f), w = component(r, 3, 1.0f);
+            const float sx = component(s, 0, 1.0f), sy = component(s, 1, 1.0f), sz = component(s, 2, 1.0f);
+            result[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f);
+            result[1] = glm::vec4(2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f);
+            result[2] = glm::vec4(2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+            result[3] = glm::vec4(component(t, 0, 0.0f), component(t, 1, 0.0f), component(t, 2, 0.0f), 1.0f);
+            return result;
+        }
+
+        bool validateAccessor(const JsonValue &index, std::size_t minCount, std::string &error) const
+        {
+            if (index.IsNull())
+                return true;
+            const JsonValue &json = m_json["accessors"][static_cast<std::size_t>(std::max(index.AsInt(), 0))];
+            if (json.IsNull() || index.AsInt() < 0)
+                return fail(error, "invalid accessor index");
+            if (!json["sparse"].IsNull())
+                return fail(error, "sparse accessors are not supported");
+            const JsonValue &view = m_json["bufferViews"][static_cast<std::size_t>(std::max(json["bufferView"].AsInt(), 0))];
+            std::size_t buffer = static_cast<std::size_t>(view["buffer"].AsInt());
+            std::size_t elementSize = ComponentSize(json["componentType"].AsInt()) * ComponentCount(json["type"].AsString());
+            std::size_t count = static_cast<std::size_t>(json["count"].AsNumber());
+            if (json["bufferView"].IsNull() || view.IsNull() || buffer >= m_buffers.size() || elementSize == 0 || count < minCount)
+                return fail(error, "invalid accessor");
+            std::size_t viewOffset = static_cast<std::size_t>(view["byteOffset"].AsNumber());
+            std::size_t viewLength = static_cast<std::size_t>(view["byteLength"].AsNumber());
+            std::size_t offset = static_cast<std::size_t>(json["byteOffset"].AsNumber());
+            std::size_t stride = std::max(static_cast<std::size_t>(view["byteStride"].AsNumber()), elementSize);
+            if (viewOffset > m_buffers[buffer].size || viewLength > m_buffers[buffer].size - viewOffset ||
+                (count > 0 && (offset > viewLength || (count - 1) * stride + elementSize > viewLength - offset)))
+                return fail(error, "accessor out of range");
+            return true;
+        }
+        bool validatePrimitive(const JsonValue &primitive, std::string &error) const
+        {
+            int mode = primitive["mode"].AsInt(4);
+            if (mode != 4)
+                return fail(error, "primitive mode " + std::to_string(mode) + " is not supported");
+            const JsonValue &attributes = primitive["attributes"];
+            if (attributes["POSITION"].IsNull())
+                return fail(error, "primitive without POSITION");
+            std::size_t vertexCount = static_cast<std::size_t>(m_json["accessors"][static_cast<std::size_t>(std::max(attributes["POSITION"].AsInt(), 0))]["count"].AsNumber());
+            for (const char *name : {"POSITION", "NORMAL", "TEXCOORD_0", "TANGENT", "JOINTS_0", "WEIGHTS_0"})
+            {
+                if (!validateAccessor(attributes[name], vertexCount, error))
+                    return false;
+            }
+            if (!validateAccessor(primitive["indices"], 0, error))
+                return false;
+            // 索引不能越过顶点数
+            if (!primitive["indices"].IsNull())
+            {
+                Accessor indices = accessor(primitive["indices"].AsInt());
+                for (std::size_t i = 0; i < indices.count; i++)
+                {
+                    if (indices.ReadIndex(i) >= vertexCount)
+                        return fail(error, "index out of range");
+                }
+            }
+            return true;
+        }
+        Accessor accessor(int index) const
+        {
+            const JsonValue &json = m_json["accessors"][static_cast<std::size_t>(index)];
+            const JsonValue &view = m_json["bufferViews"][static_cast<std::size_t>(json["bufferView"].AsInt())];
+            Accessor result;
+            result.componentType = json["componentType"].AsInt();
+            result.components = ComponentCount(json["type"].AsString());
+            result.count = static_cast<std::size_t>(json["count"].AsNumber());
+            result.normalized = json["normalized"].AsBool();
+            result.stride = std::max(static_cast<std::size_t>(view["byteStride"].AsNumber()), ComponentSize(result.componentType) * result.components);
+            result.data = m_buffers[static_cast<std::size_t>(view["buffer"].AsInt())].data +
+                          static_cast<std::size_t>(view["byteOffset"].AsNumber()) + static_cast<std::size_t>(json["byteOffset"].AsNumber());
+            return result;
+        }
+
+        // 和aiProcess_GenSmoothNormals一样按面积加权平均相邻三角形的法线
+        static void generateNormals(std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+        {
+            for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                Vertex &a = vertices[indices[i]], &b = vertices[indices[i + 1]], &c = vertices[indices[i + 2]];
+                glm::vec3 normal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+                a.Normal += normal;
+                b.Normal += normal;
+                c.Normal += normal;
+            }
+            for (auto &vertex : vertices)
+            {
+                float length = glm::length(vertex.Normal);
+                vertex.Normal = length > 0.0f ? vertex.Normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        }
+        // 和aiProcess_CalcTangentSpace一样由UV的梯度得到切线和副切线(用翻转后的UV)
+        static void generateTangents(std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+        {
+            for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                Vertex &a = vertices[indices[i]], &b = vertices[indices[i + 1]], &c = vertices[indices[i + 2]];
+                glm::vec3 e1 = b.Position - a.Position, e2 = c.Position - a.Position;
+                glm::vec2 d1 = b.TexCoords - a.TexCoords, d2 = c.TexCoords - a.TexCoords;
+                float det = d1.x * d2.y - d2.x * d1.y;
+                if (std::abs(det) < 1e-12f)
+                    continue;
+                float r = 1.0f / det;
+                glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+                glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+                for (Vertex *v : {&a, &b, &c})
+                {
+                    v->Tangent += tangent;
+                    v->Bitangent += bitangent;
+                }
+            }
+            for (auto &vertex : vertices)
+            {
+                // 切线对法线正交化，退化时随便取一个和法线垂直的方向
+                glm::vec3 tangent = vertex.Tangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Tangent);
+                float length = glm::length(tangent);
+                if (length < 1e-12f)
+                {
+                    tangent = std::abs(vertex.Normal.x) < 0.9f ? glm::cross(vertex.Normal, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(vertex.Normal, glm::vec3(0.0f, 1.0f, 0.0f));
+                    length = glm::length(tangent);
+                }
+                vertex.Tangent = tangent / length;
+                float sign = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+                vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * sign;
+            }
+        }
+
+        // textureInfo -> 图片的相对路径；内嵌的图片(bufferView或data URI)返回"*图片下标"，和Assimp的内嵌纹理约定一致
+        bool texturePath(const JsonValue &textureInfo, std::string &path) const
+        {
+            if (textureInfo.IsNull())
+                return false;
+            const JsonValue &texture = m_json["textures"][static_cast<std::size_t>(std::max(textureInfo["index"].AsInt(), 0))];
+            const JsonValue &image = m_json["images"][static_cast<std::size_t>(std::max(texture["source"].AsInt(), 0))];
+            if (texture["source"].IsNull() || image.IsNull())
+            {
+                std::cout << "GltfLoader: skipping texture " << textureInfo["index"].AsInt() << " without an image" << std::endl;
+                return false;
+            }
+            const std::string &uri = image["uri"].AsString();
+            if (!image["uri"].IsString() || uri.rfind("data:", 0) == 0)
+                path = '*' + std::to_string(texture["source"].AsInt());
+            else
+                path = DecodeUri(uri);
+            return true;
+        }
+
+        // 和Model::processMesh对Assimp材质的处理保持一致，纹理顺序也相同
+        void processMaterial(const JsonValue &material, bool usePBR, MeshData &data) const
+        {
+            const JsonValue &pbr = material["pbrMetallicRoughness"];
+            std::string path;
+            if (!usePBR)
+            {
+                if (texturePath(pbr["baseColorTexture"], path))
+                    data.textures.push_back({"material.texture_diffuse", path, false});
+                return;
+            }
+            PBRMaterial &pbrMat = data.material;
+            // 1. albedo
+            if (texturePath(pbr["baseColorTexture"], path))
+            {
+                data.textures.push_back({"material.albedoMap", path, true});
+                pbrMat.useAlbedoMap = GL_TRUE;
+            }
+            else
+            {
+                const JsonValue &factor = pbr["baseColorFactor"];
+                pbrMat.albedo = glm::vec3(factor[0].AsNumber(1.0), factor[1].AsNumber(1.0), factor[2].AsNumber(1.0));
+            }
+            // 2. normal
+            if (texturePath(material["normalTexture"], path))
+            {
+                data.textures.push_back({"material.normalMap", path, false});
+                pbrMat.useNormalMap = GL_TRUE;
+            }
+            // 3/4. metallicRoughness贴图同时作为金属度(b通道)和粗糙度(g通道)
+            if (texturePath(pbr["metallicRoughnessTexture"], path))
+            {
+                data.textures.push_back({"material.metallicMap", path, false});
+                data.textures.push_back({"material.roughnessMap", path, false});
+                pbrMat.useMetallicMap = GL_TRUE;
+                pbrMat.useRoughnessMap = GL_TRUE;
+            }
+            else
+            {
+                pbrMat.metallic = static_cast<float>(pbr["metallicFactor"].AsNumber(1.0));
+                pbrMat.roughness = static_cast<float>(pbr["roughnessFactor"].AsNumber(1.0));
+            }
+            // 5. ao
+            if (texturePath(material["occlusionTexture"], path))
+            {
+                data.textures.push_back({"material.aoMap", path, false});
+                pbrMat.useAOMap = GL_TRUE;
+            }
+            // 6. emissive
+            if (texturePath(material["emissiveTexture"], path))
+            {
+                data.textures.push_back({"material.emissiveMap", path, true});
+                pbrMat.useEmissiveMap = GL_TRUE;
+            }
+        }
+
+        std::string m_directory;
+        std::shared_ptr<MappedFile> m_file;
+        std::vector<Span> m_buffers;
+        JsonValue m_json;
+        std::vector<const JsonValue *> m_primitives;
+        // 每个图元所在的节点，和m_primitives一一对应
+        std::vector<std::uint32_t> m_primitiveNodes;
+        std::vector<SceneNode> m_nodes;
+    };
+}
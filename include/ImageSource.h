@@ -0,0 +1,25 @@
+#pragma once
+// 内存中的图片来源：glb的bufferView、data URI解码后的数据、Assimp的内嵌纹理
+// 数据直接指向模型的映射内存(或者解码后的缓冲)，owner保证异步解码完成之前数据一直有效，不需要写临时文件
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Renderer
+{
+    struct ImageSource
+    {
+        // 纹理的名字，同时作为TextureCache的键和压缩缓存的路径前缀，比如"dir/model.glb#image3"
+        std::string name;
+        std::shared_ptr<const void> owner;
+        const std::uint8_t *data = nullptr;
+        std::size_t size = 0;
+        // width > 0时data是未压缩的RGBA8像素(Assimp中mHeight != 0的内嵌纹理)，否则是png/jpg等编码后的文件内容
+        int width = 0;
+        int height = 0;
+
+        bool Empty() const noexcept { return data == nullptr || size == 0; }
+        bool IsRaw() const noexcept { return width > 0; }
+    };
+}
@@ -0,0 +1,217 @@
+#pragma once
+// GPU驱动的提交：每帧把可见网格(选好的LOD或者剔除后剩下的meshlet区间)收集成DrawElementsIndirectCommand，
+// 同一页、同一索引宽度的命令放在一批，每批只调用一次glMultiDrawElementsIndirect
+// 每条命令对应一条IndirectDrawData(世界矩阵、法线矩阵、材质槽位)，放在binding 4的SSBO里，顶点着色器按indirectDrawBase + gl_DrawID读取
+// 提交的GL调用次数只和批次数(一般是顶点格式数 x 索引宽度)有关，和网格数无关；需要逐次绑定贴图的网格仍由调用方直接绘制
+#include <glad/glad.h>
+
+#include "GeometryArena.h"
+#include "MaterialTextures.h"
+#include "Mesh.h"
+#include "RenderStats.h"
+#include "ResourceTracker.h"
+#include "Shader.h"
+#include "TransformHierarchy.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Renderer
+{
+    constexpr GLuint kIndirectDrawBinding = 4;
+
+    // glMultiDrawElementsIndirect要求的命令布局
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count = 0;
+        GLuint instanceCount = 1;
+        GLuint firstIndex = 0;
+        GLint baseVertex = 0;
+        GLuint baseInstance = 0;
+    };
+    static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must be tightly packed");
+
+    // 和着色器中std430的IndirectDraw一致
+    struct IndirectDrawData
+    {
+        glm::mat4 world = glm::mat4(1.0f);
+        NormalMatrix normal;
+        std::uint32_t materialIndex = 0;
+        std::uint32_t padding[3] = {};
+    };
+    static_assert(sizeof(IndirectDrawData) == 128, "IndirectDrawData must match the std430 IndirectDraw layout");
+
+    class IndirectDrawBuffer
+    {
+    public:
+        IndirectDrawBuffer() = default;
+        ~IndirectDrawBuffer()
+        {
+            auto &tracker = ResourceTracker::GetInstance();
+            for (GLuint buffer : {m_commandBuffer, m_drawBuffer})
+            {
+                if (!buffer)
+                    continue;
+                glDeleteBuffers(1, &buffer);
+                tracker.Release(ResourceKind::Buffer, buffer);
+            }
+        }
+        IndirectDrawBuffer(const IndirectDrawBuffer &) = delete;
+        IndirectDrawBuffer &operator=(const IndirectDrawBuffer &) = delete;
+
+        // 每帧收集之前调用，保留各批次数组的容量
+        void Clear()
+        {
+            for (auto &batch : m_batches)
+            {
+                batch.commands.clear();
+                batch.draws.clear();
+            }
+        }
+        // 加入一个网格：按context选择LOD，LOD0且开启簇剔除时每段可见的meshlet区间一条命令
+        // 网格必须SupportsIndirect()，context.model是网格的世界矩阵，normal是对应的法线矩阵
+        void Add(const ModelLoader::Mesh &mesh, const ModelLoader::LodContext &context, const NormalMatrix &normal)
+        {
+            IndirectDrawData draw;
+            draw.world = context.model;
+            draw.normal = normal;
+            draw.materialIndex = mesh.materialSlot;
+            Batch &batch = findBatch(mesh.geometry);
+            auto &stats = RenderStats::GetInstance();
+            const std::uint64_t fullTriangles = mesh.lods[0].indexCount / 3;
+            const std::size_t lod = mesh.SelectLod(context);
+            if (lod != 0 || !context.cullClusters || mesh.meshlets.empty())
+            {
+                const ModelLoader::MeshLod &range = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+                push(batch, mesh.geometry, range.indexOffset, range.indexCount, draw);
+                stats.AddIndirect(1, range.indexCount / 3, fullTriangles);
+                return;
+            }
+            const std::size_t first = batch.commands.size();
+            const std::size_t triangles = mesh.CullMeshletRanges(context, [&](std::uint32_t indexOffset, std::uint32_t count)
+                                                                 { push(batch, mesh.geometry, indexOffset, count, draw); });
+            if (batch.commands.size() == first)
+                stats.AddCulled(fullTriangles);
+            else
+                stats.AddIndirect(batch.commands.size() - first, triangles, fullTriangles);
+        }
+
+        // 上传这一帧的命令和绘制数据，每批一次glMultiDrawElementsIndirect
+        void Submit(Shader &shader)
+        {
+            const std::size_t total = CommandCount();
+            if (total == 0)
+                return;
+            reserve(total);
+            // 整块缓冲先失效再写，驱动不需要等上一帧的绘制读完
+            glInvalidateBufferData(m_commandBuffer);
+            glInvalidateBufferData(m_drawBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawBuffer);
+            std::size_t offset = 0;
+            for (const auto &batch : m_batches)
+            {
+                if (batch.commands.empty())
+                    continue;
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset * sizeof(DrawElementsIndirectCommand), batch.commands.size() * sizeof(DrawElementsIndirectCommand), batch.commands.data());
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(IndirectDrawData), batch.draws.size() * sizeof(IndirectDrawData), batch.draws.data());
+                offset += batch.commands.size();
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kIndirectDrawBinding, m_drawBuffer);
+
+            MaterialTextures::GetInstance().BindArrays();
+            shader.setBool("indirectDraw", true);
+            auto &arena = GeometryArena::GetInstance();
+            offset = 0;
+            for (const auto &batch : m_batches)
+            {
+                if (batch.commands.empty())
+                    continue;
+                shader.setBool("compactVertex", batch.geometry.format == ModelLoader::VertexFormat::Compact);
+                // gl_DrawID在每次glMultiDrawElementsIndirect中从0开始
+                shader.setInt("indirectDrawBase", static_cast<int>(offset));
+                arena.Bind(batch.geometry);
+                glMultiDrawElementsIndirect(GL_TRIANGLES, batch.geometry.GLIndexType(), (const void *)(offset * sizeof(DrawElementsIndirectCommand)),
+                                            static_cast<GLsizei>(batch.commands.size()), 0);
+                RenderStats::GetInstance().AddMultiDraw();
+                offset += batch.commands.size();
+            }
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            shader.setBool("indirectDraw", false);
+            shader.setBool("compactVertex", false);
+        }
+
+        std::size_t CommandCount() const noexcept
+        {
+            std::size_t total = 0;
+            for (const auto &batch : m_batches)
+                total += batch.commands.size();
+            return total;
+        }
+
+    private:
+        // 能用同一次glMultiDrawElementsIndirect绘制的命令：同一个VAO(顶点格式和页)、同一种索引宽度
+        struct Batch
+        {
+            GeometryAllocation geometry;
+            std::vector<DrawElementsIndirectCommand> commands;
+            std::vector<IndirectDrawData> draws;
+        };
+
+        Batch &findBatch(const GeometryAllocation &geometry)
+        {
+            auto matches = [&](const Batch &batch)
+            {
+                return batch.geometry.format == geometry.format && batch.geometry.page == geometry.page && batch.geometry.indexType == geometry.indexType;
+            };
+            // 连续的网格一般在同一批里
+            if (m_lastBatch < m_batches.size() && matches(m_batches[m_lastBatch]))
+                return m_batches[m_lastBatch];
+            auto iter = std::find_if(m_batches.begin(), m_batches.end(), matches);
+            if (iter == m_batches.end())
+            {
+                m_batches.emplace_back().geometry = geometry;
+                iter = std::prev(m_batches.end());
+            }
+            m_lastBatch = static_cast<std::size_t>(iter - m_batches.begin());
+            return *iter;
+        }
+        static void push(Batch &batch, const GeometryAllocation &geometry, std::uint32_t indexOffset, std::uint32_t indexCount, const IndirectDrawData &draw)
+        {
+            DrawElementsIndirectCommand command;
+            command.count = indexCount;
+            command.firstIndex = geometry.firstIndex + indexOffset;
+            command.baseVertex = static_cast<GLint>(geometry.baseVertex);
+            batch.commands.push_back(command);
+            batch.draws.push_back(draw);
+        }
+        // 命令数超过容量时按两倍重新分配两个缓冲
+        void reserve(std::size_t count)
+        {
+            if (count <= m_capacity)
+                return;
+            m_capacity = std::max<std::size_t>(count, m_capacity * 2);
+            allocate(m_commandBuffer, GL_DRAW_INDIRECT_BUFFER, m_capacity * sizeof(DrawElementsIndirectCommand));
+            allocate(m_drawBuffer, GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(IndirectDrawData));
+        }
+        static void allocate(GLuint &buffer, GLenum target, std::size_t size)
+        {
+            if (!buffer)
+                glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, buffer, ResourceCategory::DrawData, "IndirectDrawBuffer", size);
+            glBindBuffer(target, 0);
+        }
+
+        std::vector<Batch> m_batches;
+        std::size_t m_lastBatch = 0;
+        std::size_t m_capacity = 0;
+        GLuint m_commandBuffer = 0;
+        GLuint m_drawBuffer = 0;
+    };
+}
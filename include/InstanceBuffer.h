@@ -0,0 +1,110 @@
+#pragma once
+// 同一个模型的多个实例：CPU端保存每个实例的变换，绘制前把模型矩阵和法线矩阵上传到一个顶点缓冲
+// GeometryArena每页的VAO都在kInstanceBinding上声明了逐实例属性，绘制时只需要换绑这个缓冲，一个网格一次glDrawElementsInstancedBaseVertex
+#include <glad/glad.h>
+
+#include "ResourceTracker.h"
+#include "VertexFormat.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Renderer
+{
+    class InstanceBuffer
+    {
+    public:
+        InstanceBuffer() = default;
+        explicit InstanceBuffer(std::vector<glm::mat4> transforms) : m_transforms(std::move(transforms))
+        {
+        }
+        ~InstanceBuffer()
+        {
+            if (m_buffer)
+            {
+                glDeleteBuffers(1, &m_buffer);
+                ResourceTracker::GetInstance().Release(ResourceKind::Buffer, m_buffer);
+            }
+        }
+        InstanceBuffer(const InstanceBuffer &) = delete;
+        InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+        // 返回实例下标，删除实例后排在它后面的下标会前移
+        std::size_t Add(const glm::mat4 &transform)
+        {
+            m_transforms.push_back(transform);
+            m_dirty = true;
+            return m_transforms.size() - 1;
+        }
+        void Set(std::size_t index, const glm::mat4 &transform)
+        {
+            m_transforms[index] = transform;
+            m_dirty = true;
+        }
+        void Remove(std::size_t index)
+        {
+            m_transforms.erase(m_transforms.begin() + static_cast<std::ptrdiff_t>(index));
+            m_dirty = true;
+        }
+        void Clear()
+        {
+            m_transforms.clear();
+            m_dirty = true;
+        }
+        std::size_t Count() const noexcept { return m_transforms.size(); }
+        const std::vector<glm::mat4> &Transforms() const noexcept { return m_transforms; }
+
+        // 在GL线程调用：实例变化后重新计算法线矩阵并整体上传(缓冲重新分配，不会等待上一帧还在使用的数据)
+        void Upload()
+        {
+            if (!m_dirty)
+                return;
+            m_dirty = false;
+            m_data.resize(m_transforms.size());
+            for (std::size_t i = 0; i < m_transforms.size(); i++)
+            {
+                m_data[i].model = m_transforms[i];
+                m_data[i].normal = glm::transpose(glm::inverse(glm::mat3(m_transforms[i])));
+            }
+            if (!m_buffer)
+                glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glBufferData(GL_ARRAY_BUFFER, m_data.size() * sizeof(ModelLoader::InstanceData), m_data.data(), GL_DYNAMIC_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_buffer, ResourceCategory::DrawData, "InstanceBuffer", m_data.size() * sizeof(ModelLoader::InstanceData));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        // 把实例缓冲绑定到当前VAO的逐实例属性上
+        void Bind() const
+        {
+            glBindVertexBuffer(ModelLoader::kInstanceBinding, m_buffer, 0, sizeof(ModelLoader::InstanceData));
+        }
+
+        // 只有一个单位变换的缓冲，非实例化绘制时留在VAO上，保证启用的逐实例属性始终有缓冲可读
+        static GLuint IdentityBuffer()
+        {
+            static GLuint buffer = 0;
+            if (!buffer)
+            {
+                ModelLoader::InstanceData identity{glm::mat4(1.0f), glm::mat3(1.0f)};
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                glBufferStorage(GL_ARRAY_BUFFER, sizeof(identity), &identity, 0);
+                ResourceTracker::GetInstance().Track(ResourceKind::Buffer, buffer, ResourceCategory::DrawData, "InstanceBuffer.identity", sizeof(identity));
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            return buffer;
+        }
+        static void BindIdentity()
+        {
+            glBindVertexBuffer(ModelLoader::kInstanceBinding, IdentityBuffer(), 0, sizeof(ModelLoader::InstanceData));
+        }
+
+    private:
+        std::vector<glm::mat4> m_transforms;
+        std::vector<ModelLoader::InstanceData> m_data;
+        GLuint m_buffer = 0;
+        bool m_dirty = true;
+    };
+}
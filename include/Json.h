@@ -0,0 +1,323 @@
+#pragma once
+// 最小的JSON解析器(DOM)，只用于读取glTF这类小体积的描述文件
+// 访问不存在的键或越界的下标时返回一个null值，调用方可以直接链式访问再用As*带默认值读取
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ModelLoader
+{
+    class JsonValue
+    {
+    public:
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+        Type GetType() const noexcept { return m_type; }
+        bool IsNull() const noexcept { return m_type == Type::Null; }
+        bool IsNumber() const noexcept { return m_type == Type::Number; }
+        bool IsString() const noexcept { return m_type == Type::String; }
+        bool IsArray() const noexcept { return m_type == Type::Array; }
+        bool IsObject() const noexcept { return m_type == Type::Object; }
+
+        double AsNumber(double fallback = 0.0) const noexcept { return m_type == Type::Number ? m_number : fallback; }
+        int AsInt(int fallback = -1) const noexcept { return m_type == Type::Number ? static_cast<int>(m_number) : fallback; }
+        bool AsBool(bool fallback = false) const noexcept { return m_type == Type::Bool ? m_bool : fallback; }
+        const std::string &AsString() const noexcept { return m_string; }
+
+        std::size_t Size() const noexcept
+        {
+            return m_type == Type::Array ? m_array.size() : m_type == Type::Object ? m_object.size() : 0;
+        }
+        const JsonValue &operator[](std::size_t index) const noexcept
+        {
+            return m_type == Type::Array && index < m_array.size() ? m_array[index] : Null();
+        }
+        const JsonValue &operator[](std::string_view key) const noexcept
+        {
+            if (const JsonValue *value = Find(key))
+                return *value;
+            return Null();
+        }
+        const JsonValue *Find(std::string_view key) const noexcept
+        {
+            if (m_type != Type::Object)
+                return nullptr;
+            for (const auto &member : m_object)
+            {
+                if (member.first == key)
+                    return &member.second;
+            }
+            return nullptr;
+        }
+        const std::vector<std::pair<std::string, JsonValue>> &Members() const noexcept { return m_object; }
+
+        // 解析[begin, end)，失败时返回false并在error中给出出错位置
+        static bool Parse(const char *begin, const char *end, JsonValue &out, std::string *error = nullptr)
+        {
+            Parser parser{begin, begin, end};
+            if (!parser.ParseValue(out, 0) || (parser.SkipSpace(), parser.cur != end))
+            {
+                if (error)
+                    *error = "invalid JSON at offset " + std::to_string(parser.cur - begin);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static const JsonValue &Null()
+        {
+            static const JsonValue null;
+            return null;
+        }
+
+        struct Parser
+        {
+            const char *begin;
+            const char *cur;
+            const char *end;
+            static constexpr int kMaxDepth = 256;
+
+            void SkipSpace()
+            {
+                while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r'))
+                    cur++;
+            }
+            bool Consume(std::string_view literal)
+            {
+                if (static_cast<std::size_t>(end - cur) < literal.size() || std::string_view(cur, literal.size()) != literal)
+                    return false;
+                cur += literal.size();
+                return true;
+            }
+            bool ParseValue(JsonValue &value, int depth)
+            {
+                SkipSpace();
+                if (cur >= end || depth > kMaxDepth)
+                    return false;
+                switch (*cur)
+                {
+                case '{':
+                    return ParseObject(value, depth);
+                case '[':
+                    return ParseArray(value, depth);
+                case '"':
+                    value.m_type = Type::String;
+                    return ParseString(value.m_string);
+                case 't':
+                    value.m_type = Type::Bool;
+                    value.m_bool = true;
+                    return Consume("true");
+                case 'f':
+                    value.m_type = Type::Bool;
+                    value.m_bool = false;
+                    return Consume("false");
+                case 'n':
+                    value.m_type = Type::Null;
+                    return Consume("null");
+                default:
+                    return ParseNumber(value);
+                }
+            }
+            bool ParseObject(JsonValue &value, int depth)
+            {
+                value.m_type = Type::Object;
+                cur++;
+                SkipSpace();
+                if (cur < end && *cur == '}')
+                {
+                    cur++;
+                    return true;
+                }
+                while (true)
+                {
+                    SkipSpace();
+                    std::string key;
+                    if (cur >= end || *cur != '"' || !ParseString(key))
+                        return false;
+                    SkipSpace();
+                    if (cur >= end || *cur++ != ':')
+                        return false;
+                    value.m_object.emplace_back(std::move(key), JsonValue());
+                    if (!ParseValue(value.m_object.back().second, depth + 1))
+                        return false;
+                    SkipSpace();
+                    if (cur >= end)
+                        return false;
+                    if (*cur == ',')
+                    {
+                        cur++;
+                        continue;
+                    }
+                    return *cur++ == '}';
+                }
+            }
+            bool ParseArray(JsonValue &value, int depth)
+            {
+                value.m_type = Type::Array;
+                cur++;
+                SkipSpace();
+                if (cur < end && *cur == ']')
+                {
+                    cur++;
+                    return true;
+                }
+                while (true)
+                {
+                    value.m_array.emplace_back();
+                    if (!ParseValue(value.m_array.back(), depth + 1))
+                        return false;
+                    SkipSpace();
+                    if (cur >= end)
+                        return false;
+                    if (*cur == ',')
+                    {
+                        cur++;
+                        continue;
+                    }
+                    return *cur++ == ']';
+                }
+            }
+            bool ParseNumber(JsonValue &value)
+            {
+                // strtod需要以'\0'结尾的字符串，数字不会很长，先拷贝出来
+                const char *start = cur;
+                while (cur < end && (std::isdigit(static_cast<unsigned char>(*cur)) || *cur == '-' || *cur == '+' || *cur == '.' || *cur == 'e' || *cur == 'E'))
+                    cur++;
+                if (cur == start)
+                    return false;
+                std::string text(start, cur);
+                char *parsedEnd = nullptr;
+                value.m_type = Type::Number;
+                value.m_number = std::strtod(text.c_str(), &parsedEnd);
+                return parsedEnd == text.c_str() + text.size();
+            }
+            static void AppendUtf8(std::string &out, std::uint32_t codepoint)
+            {
+                if (codepoint < 0x80)
+                    out += static_cast<char>(codepoint);
+                else if (codepoint < 0x800)
+                {
+                    out += static_cast<char>(0xC0 | (codepoint >> 6));
+                    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+                }
+                else if (codepoint < 0x10000)
+                {
+                    out += static_cast<char>(0xE0 | (codepoint >> 12));
+                    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+                }
+                else
+                {
+                    out += static_cast<char>(0xF0 | (codepoint >> 18));
+                    out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (codepoint & 0x3F));
+                }
+            }
+            bool ParseHex4(std::uint32_t &codepoint)
+            {
+                if (end - cur < 4)
+                    return false;
+                codepoint = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    char c = *cur++;
+                    codepoint <<= 4;
+                    if (c >= '0' && c <= '9')
+                        codepoint |= c - '0';
+                    else if (c >= 'a' && c <= 'f')
+                        codepoint |= c - 'a' + 10;
+                    else if (c >= 'A' && c <= 'F')
+                        codepoint |= c - 'A' + 10;
+                    else
+                        return false;
+                }
+                return true;
+            }
+            bool ParseString(std::string &out)
+            {
+                cur++;
+                while (cur < end && *cur != '"')
+                {
+                    char c = *cur++;
+                    if (c != '\\')
+                    {
+                        out += c;
+                        continue;
+                    }
+                    if (cur >= end)
+                        return false;
+                    switch (*cur++)
+                    {
+                    case '"':
+                        out += '"';
+                        break;
+                    case '\\':
+                        out += '\\';
+                        break;
+                    case '/':
+                        out += '/';
+                        break;
+                    case 'b':
+                        out += '\b';
+                        break;
+                    case 'f':
+                        out += '\f';
+                        break;
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'u':
+                    {
+                        std::uint32_t codepoint = 0;
+                        if (!ParseHex4(codepoint))
+                            return false;
+                        // UTF-16代理对
+                        if (codepoint >= 0xD800 && codepoint < 0xDC00)
+                        {
+                            std::uint32_t low = 0;
+                            if (!Consume("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+                                return false;
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        AppendUtf8(out, codepoint);
+                        break;
+                    }
+                    default:
+                        return false;
+                    }
+                }
+                if (cur >= end)
+                    return false;
+                cur++;
+                return true;
+            }
+        };
+
+        Type m_type = Type::Null;
+        bool m_bool = false;
+        double m_number = 0.0;
+        std::string m_string;
+        std::vector<JsonValue> m_array;
+        std::vector<std::pair<std::string, JsonValue>> m_object;
+    };
+}
@@ -0,0 +1,148 @@
+#pragma once
+// 只读内存映射文件，用于网格缓存等大块二进制数据的零拷贝读取
+// HashBytes用来给映射的源文件算内容哈希，作为各种磁盘缓存的键
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace ModelLoader
+{
+    // FNV-1a 64位哈希
+    inline std::uint64_t HashBytes(const void *data, std::size_t size, std::uint64_t seed = 14695981039346656037ull)
+    {
+        const auto *bytes = static_cast<const std::uint8_t *>(data);
+        std::uint64_t hash = seed;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    class MappedFile
+    {
+    public:
+        MappedFile() noexcept = default;
+        explicit MappedFile(const std::string &path)
+        {
+            Open(path);
+        }
+        ~MappedFile()
+        {
+            Close();
+        }
+        // 禁止复制，只允许移动
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&other) noexcept
+        {
+            *this = std::move(other);
+        }
+        MappedFile &operator=(MappedFile &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Close();
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+#ifdef _WIN32
+                std::swap(m_file, other.m_file);
+                std::swap(m_mapping, other.m_mapping);
+#endif
+            }
+            return *this;
+        }
+
+        bool Open(const std::string &path)
+        {
+            Close();
+#ifdef _WIN32
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            {
+                Close();
+                return false;
+            }
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping == nullptr)
+            {
+                Close();
+                return false;
+            }
+            m_data = static_cast<const std::uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            void *ptr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            // 映射建立后文件描述符就可以关闭了
+            ::close(fd);
+            if (ptr == MAP_FAILED)
+                return false;
+            m_data = static_cast<const std::uint8_t *>(ptr);
+            m_size = static_cast<std::size_t>(st.st_size);
+#endif
+            if (m_data == nullptr)
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        void Close()
+        {
+#ifdef _WIN32
+            if (m_data)
+                UnmapViewOfFile(m_data);
+            if (m_mapping)
+                CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                CloseHandle(m_file);
+            m_mapping = nullptr;
+            m_file = INVALID_HANDLE_VALUE;
+#else
+            if (m_data)
+                munmap(const_cast<std::uint8_t *>(m_data), m_size);
+#endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        bool IsOpen() const noexcept { return m_data != nullptr; }
+        const std::uint8_t *Data() const noexcept { return m_data; }
+        std::size_t Size() const noexcept { return m_size; }
+
+    private:
+        const std::uint8_t *m_data = nullptr;
+        std::size_t m_size = 0;
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+    };
+}
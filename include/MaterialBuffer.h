@@ -0,0 +1,125 @@
+#pragma once
+// 所有网格的PBR材质参数放在一个持久映射(coherent)的SSBO数组里(binding 3)，每个网格占一个槽位
+// 材质只在创建或修改时写一次映射内存，绘制时只设置materialIndex，不再每次绘制映射/解映射UBO
+// 槽位用完时按两倍扩容：新建缓冲、把CPU端副本整体写入、重新绑定
+#include <glad/glad.h>
+
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace Renderer
+{
+    constexpr GLuint kMaterialBinding = 3;
+    // std430下着色器中MaterialData的数组步长：44字节的参数补齐到48，之后5个uvec2贴图引用，整体按16字节对齐
+    constexpr std::size_t kMaterialStride = 96;
+
+    class MaterialBuffer
+    {
+        MaterialBuffer() = default;
+        // 静态析构时GL上下文已经销毁，不释放GL对象
+        ~MaterialBuffer() = default;
+
+    public:
+        static constexpr std::uint32_t kInvalidSlot = ~0u;
+
+        static auto &GetInstance()
+        {
+            static MaterialBuffer instance{};
+            return instance;
+        }
+        MaterialBuffer(const MaterialBuffer &) = delete;
+        MaterialBuffer &operator=(const MaterialBuffer &) = delete;
+
+        // 分配一个槽位并写入材质(size不超过kMaterialStride)，只能在GL线程调用
+        std::uint32_t Allocate(const void *data, std::size_t size)
+        {
+            std::uint32_t slot;
+            if (!m_freeSlots.empty())
+            {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else
+            {
+                slot = m_slotCount++;
+                if (m_slotCount > m_capacity)
+                    grow(std::max<std::uint32_t>(m_capacity * 2, kInitialCapacity));
+            }
+            Write(slot, data, size);
+            return slot;
+        }
+        // 材质变化时调用：把槽位内[offset, offset + size)的部分直接写入映射内存，不需要任何GL调用
+        // 还在执行的上一帧可能读到新的值，材质修改不频繁，这里不做额外同步
+        void Write(std::uint32_t slot, const void *data, std::size_t size, std::size_t offset = 0)
+        {
+            if (slot >= m_slotCount || offset + size > kMaterialStride)
+                return;
+            std::uint8_t *shadow = m_shadow.data() + std::size_t(slot) * kMaterialStride;
+            std::memcpy(shadow + offset, data, size);
+            if (m_mapped)
+            {
+                std::memcpy(m_mapped + std::size_t(slot) * kMaterialStride, shadow, kMaterialStride);
+                return;
+            }
+            // 映射失败时退回到glBufferSubData
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, std::size_t(slot) * kMaterialStride, kMaterialStride, shadow);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        void Free(std::uint32_t slot)
+        {
+            if (slot < m_slotCount)
+                m_freeSlots.push_back(slot);
+        }
+        // 其他代码改动过kMaterialBinding上的绑定时重新绑定
+        void Bind() const
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMaterialBinding, m_buffer);
+        }
+
+        std::uint32_t SlotCount() const noexcept { return m_slotCount - static_cast<std::uint32_t>(m_freeSlots.size()); }
+        std::uint32_t Capacity() const noexcept { return m_capacity; }
+
+    private:
+        static constexpr std::uint32_t kInitialCapacity = 256;
+
+        void grow(std::uint32_t capacity)
+        {
+            const std::size_t bytes = std::size_t(capacity) * kMaterialStride;
+            m_shadow.resize(bytes, 0);
+            if (m_buffer)
+            {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+                glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+                glDeleteBuffers(1, &m_buffer);
+                ResourceTracker::GetInstance().Release(ResourceKind::Buffer, m_buffer);
+                m_buffer = 0;
+                m_mapped = nullptr;
+            }
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, bytes, m_shadow.data(), flags | GL_DYNAMIC_STORAGE_BIT);
+            m_mapped = static_cast<std::uint8_t *>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes, flags));
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            if (!m_mapped)
+                std::cout << "MaterialBuffer: failed to map the material buffer" << std::endl;
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_buffer, ResourceCategory::DrawData, "MaterialBuffer", bytes);
+            m_capacity = capacity;
+            Bind();
+        }
+
+        GLuint m_buffer = 0;
+        std::uint8_t *m_mapped = nullptr;
+        // CPU端副本，扩容时整体写入新缓冲
+        std::vector<std::uint8_t> m_shadow;
+        std::vector<std::uint32_t> m_freeSlots;
+        std::uint32_t m_slotCount = 0;
+        std::uint32_t m_capacity = 0;
+    };
+}
@@ -0,0 +1,290 @@
+#pragma once
+// 材质贴图的三种绑定方式，Initialize时按驱动能力选择(也可以用环境变量PBR_MATERIAL_TEXTURES=bindless|arrays|bind强制指定)：
+// Bindless：ARB_bindless_texture，纹理句柄直接写进MaterialBuffer，绘制时不绑定任何纹理
+// Arrays：按(格式, 尺寸, mip层数)把纹理复制进若干张GL_TEXTURE_2D_ARRAY，材质里记录(数组下标, 层)，数组固定绑在kMaterialArrayUnit开始的纹理单元上
+// Bind：原来的每次绘制绑定到3~7号纹理单元；数组数量用完时单张纹理也退回这种方式
+// 选择的方式通过Shader::AddGlobalDefine告诉着色器，所以必须在GL上下文创建之后、加载任何着色器之前调用Initialize
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "ResourceTracker.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Renderer
+{
+    enum class MaterialTextureMode : std::uint8_t
+    {
+        Bind,
+        Arrays,
+        Bindless
+    };
+    inline const char *MaterialTextureModeName(MaterialTextureMode mode)
+    {
+        switch (mode)
+        {
+        case MaterialTextureMode::Bindless:
+            return "bindless";
+        case MaterialTextureMode::Arrays:
+            return "arrays";
+        default:
+            return "bind";
+        }
+    }
+
+    // 纹理数组占用的纹理单元：0~2是IBL，3~7是逐次绑定的材质贴图，片元着色器至少有16个单元
+    constexpr GLuint kMaterialArrayUnit = 8;
+    constexpr std::size_t kMaxMaterialArrays = 8;
+    // 材质里的贴图引用等于它时，着色器从逐次绑定的采样器(material.xxxMap)读取
+    inline const glm::uvec2 kMaterialTextureBound = glm::uvec2(0xFFFFFFFFu, 0xFFFFFFFFu);
+
+    class MaterialTextures
+    {
+        MaterialTextures() = default;
+        // 静态析构时GL上下文已经销毁，不释放GL对象
+        ~MaterialTextures() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static MaterialTextures instance{};
+            return instance;
+        }
+        MaterialTextures(const MaterialTextures &) = delete;
+        MaterialTextures &operator=(const MaterialTextures &) = delete;
+
+        // 选择驱动支持的、不超过requested的方式，返回实际使用的方式
+        MaterialTextureMode Initialize(MaterialTextureMode requested = MaterialTextureMode::Bindless)
+        {
+            if (m_initialized)
+                return m_mode;
+            m_initialized = true;
+            if (const char *env = std::getenv("PBR_MATERIAL_TEXTURES"))
+            {
+                std::string value = env;
+                if (value == "bind")
+                    requested = MaterialTextureMode::Bind;
+                else if (value == "arrays")
+                    requested = MaterialTextureMode::Arrays;
+                else if (value == "bindless")
+                    requested = MaterialTextureMode::Bindless;
+            }
+            m_mode = requested;
+            if (m_mode == MaterialTextureMode::Bindless && !loadBindless())
+                m_mode = MaterialTextureMode::Arrays;
+            if (m_mode == MaterialTextureMode::Bindless)
+                Shader::AddGlobalDefine("MATERIAL_BINDLESS");
+            else if (m_mode == MaterialTextureMode::Arrays)
+                Shader::AddGlobalDefine("MATERIAL_TEXTURE_ARRAYS");
+            std::cout << "MaterialTextures: using " << MaterialTextureModeName(m_mode) << " material textures" << std::endl;
+            return m_mode;
+        }
+        MaterialTextureMode Mode() const noexcept { return m_mode; }
+
+        // 返回写进材质的贴图引用：Bindless是64位句柄的低/高32位，Arrays是(数组下标, 层)
+        // 第一次解析一张纹理时创建句柄或复制到数组里，之后直接查表；纹理必须已经上传完成
+        glm::uvec2 Resolve(GLuint texture)
+        {
+            if (texture == 0 || m_mode == MaterialTextureMode::Bind)
+                return kMaterialTextureBound;
+            auto iter = m_entries.find(texture);
+            if (iter != m_entries.end())
+                return iter->second.ref;
+            Entry entry;
+            if (m_mode == MaterialTextureMode::Bindless)
+            {
+                entry.handle = m_getTextureHandle(texture);
+                if (entry.handle != 0)
+                {
+                    m_makeHandleResident(entry.handle);
+                    entry.ref = glm::uvec2(static_cast<std::uint32_t>(entry.handle), static_cast<std::uint32_t>(entry.handle >> 32));
+                }
+            }
+            else
+                entry.ref = addToArray(texture);
+            m_entries[texture] = entry;
+            return entry.ref;
+        }
+        // 删除纹理之前调用：释放句柄的驻留状态或者数组中的层
+        void Release(GLuint texture)
+        {
+            auto iter = m_entries.find(texture);
+            if (iter == m_entries.end())
+                return;
+            const Entry &entry = iter->second;
+            if (entry.handle != 0)
+                m_makeHandleNonResident(entry.handle);
+            else if (entry.ref != kMaterialTextureBound)
+                m_arrays[entry.ref.x].freeLayers.push_back(entry.ref.y);
+            m_entries.erase(iter);
+        }
+        // Arrays方式下把数组绑定到固定的纹理单元，只有数组新建或扩容之后才真正调用GL
+        void BindArrays()
+        {
+            if (!m_arraysDirty)
+                return;
+            m_arraysDirty = false;
+            for (std::size_t i = 0; i < m_arrays.size(); i++)
+            {
+                glActiveTexture(GL_TEXTURE0 + kMaterialArrayUnit + static_cast<GLuint>(i));
+                glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i].id);
+            }
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+    private:
+        using GetTextureHandleProc = GLuint64(APIENTRY *)(GLuint);
+        using HandleResidencyProc = void(APIENTRY *)(GLuint64);
+
+        struct Entry
+        {
+            glm::uvec2 ref = kMaterialTextureBound;
+            GLuint64 handle = 0;
+        };
+        struct TextureArray
+        {
+            GLuint id = 0;
+            GLenum format = 0;
+            GLsizei width = 0;
+            GLsizei height = 0;
+            GLsizei levels = 0;
+            GLsizei capacity = 0;
+            GLsizei used = 0;
+            std::vector<std::uint32_t> freeLayers;
+        };
+
+        // glad不一定生成了扩展函数，直接通过GLFW检查扩展并取函数指针
+        bool loadBindless()
+        {
+            if (!glfwExtensionSupported("GL_ARB_bindless_texture"))
+                return false;
+            m_getTextureHandle = reinterpret_cast<GetTextureHandleProc>(glfwGetProcAddress("glGetTextureHandleARB"));
+            m_makeHandleResident = reinterpret_cast<HandleResidencyProc>(glfwGetProcAddress("glMakeTextureHandleResidentARB"));
+            m_makeHandleNonResident = reinterpret_cast<HandleResidencyProc>(glfwGetProcAddress("glMakeTextureHandleNonResidentARB"));
+            return m_getTextureHandle && m_makeHandleResident && m_makeHandleNonResident;
+        }
+
+        // glTexStorage3D需要带位宽的内部格式
+        static GLenum sizedFormat(GLint format)
+        {
+            switch (format)
+            {
+            case GL_RED:
+                return GL_R8;
+            case GL_RG:
+                return GL_RG8;
+            case GL_RGB:
+                return GL_RGB8;
+            case GL_RGBA:
+                return GL_RGBA8;
+            case GL_SRGB:
+                return GL_SRGB8;
+            case GL_SRGB_ALPHA:
+                return GL_SRGB8_ALPHA8;
+            default:
+                return static_cast<GLenum>(format);
+            }
+        }
+
+        glm::uvec2 addToArray(GLuint texture)
+        {
+            GLint format = 0, width = 0, height = 0, levels = 0;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            // 没有定义的mip层宽度为0(压缩纹理的mip链可能不完整)
+            for (GLint levelWidth = width; levelWidth > 0 && levels < 16; levels++)
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, levels + 1, GL_TEXTURE_WIDTH, &levelWidth);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            if (width <= 0 || height <= 0)
+                return kMaterialTextureBound;
+
+            const GLenum sized = sizedFormat(format);
+            auto iter = std::find_if(m_arrays.begin(), m_arrays.end(), [&](const TextureArray &array)
+                                     { return array.format == sized && array.width == width && array.height == height && array.levels == levels; });
+            if (iter == m_arrays.end())
+            {
+                if (m_arrays.size() >= kMaxMaterialArrays)
+                    return kMaterialTextureBound;
+                TextureArray array;
+                array.format = sized;
+                array.width = width;
+                array.height = height;
+                array.levels = levels;
+                m_arrays.push_back(array);
+                iter = std::prev(m_arrays.end());
+            }
+            TextureArray &array = *iter;
+            std::uint32_t layer;
+            if (!array.freeLayers.empty())
+            {
+                layer = array.freeLayers.back();
+                array.freeLayers.pop_back();
+            }
+            else
+            {
+                if (array.used == array.capacity && !grow(array))
+                    return kMaterialTextureBound;
+                layer = static_cast<std::uint32_t>(array.used++);
+            }
+            for (GLint level = 0; level < levels; level++)
+            {
+                glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+                                   std::max(width >> level, 1), std::max(height >> level, 1), 1);
+            }
+            return glm::uvec2(static_cast<std::uint32_t>(iter - m_arrays.begin()), layer);
+        }
+        // 层数翻倍：新建数组并把已有的层复制过去
+        bool grow(TextureArray &array)
+        {
+            GLint maxLayers = 0;
+            glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+            const GLsizei capacity = std::min<GLsizei>(std::max<GLsizei>(array.capacity * 2, 4), maxLayers);
+            if (capacity <= array.capacity)
+                return false;
+            GLuint id;
+            glGenTextures(1, &id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.format, array.width, array.height, capacity);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            auto &tracker = ResourceTracker::GetInstance();
+            if (array.id)
+            {
+                for (GLint level = 0; level < array.levels; level++)
+                {
+                    glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                                       std::max(array.width >> level, 1), std::max(array.height >> level, 1), array.used);
+                }
+                glDeleteTextures(1, &array.id);
+                tracker.Release(ResourceKind::Texture, array.id);
+            }
+            tracker.Track(ResourceKind::Texture, id, ResourceCategory::Texture, "MaterialTextures.array", TextureBytes(array.format, array.width, array.height, array.levels > 1, capacity));
+            array.id = id;
+            array.capacity = capacity;
+            m_arraysDirty = true;
+            return true;
+        }
+
+        bool m_initialized = false;
+        MaterialTextureMode m_mode = MaterialTextureMode::Bind;
+        GetTextureHandleProc m_getTextureHandle = nullptr;
+        HandleResidencyProc m_makeHandleResident = nullptr;
+        HandleResidencyProc m_makeHandleNonResident = nullptr;
+        std::unordered_map<GLuint, Entry> m_entries;
+        std::vector<TextureArray> m_arrays;
+        bool m_arraysDirty = false;
+    };
+}
@@ -1,7 +1,7 @@
 #pragma once
 
-// 该处牵扯到如何优化ubo性能，最好不要为每一个mesh都创建一个ubo(但是目前先这么做)，而是为每一个材质创建一个ubo，然后将所有使用该材质的mesh的ubo指向该材质的ubo
-// 因为每个mesh要是维护一个ubo的话，那么不同的mesh的ubo会绑定到同一个binding point上，这样就会导致每次绘制时都要重新绑定ubo，这样就会降低性能
+// 材质参数不再每个mesh一个ubo：所有mesh的材质都在MaterialBuffer(持久映射的SSBO)里，绘制时只切换materialIndex
+// 每个mesh维护一个ubo的话，每次绘制都要重新绑定并映射ubo，会导致驱动同步，降低性能
 // https://community.khronos.org/t/performance-of-opengles-glbindbufferbase/107860/5
 // https://community.khronos.org/t/glbindbufferrange-hugely-expensive/71026
 #include <glad/glad.h> // holds all OpenGL type declarations
@@ -10,34 +10,29 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+#include "MaterialBuffer.h"
+#include "MaterialTextures.h"
+#include "Meshlet.h"
+#include "RenderStats.h"
+#include "ResourceTracker.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "VertexFormat.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace ModelLoader
 {
-#define MAX_BONE_INFLUENCE 4
-
-    struct Vertex
-    {
-        // position
-        glm::vec3 Position;
-        // normal
-        glm::vec3 Normal;
-        // texCoords
-        glm::vec2 TexCoords;
-        // tangent
-        glm::vec3 Tangent;
-        // bitangent
-        glm::vec3 Bitangent;
-        // bone indexes which will influence this vertex
-        int m_BoneIDs[MAX_BONE_INFLUENCE];
-        // weights from each bone
-        float m_Weights[MAX_BONE_INFLUENCE];
-    };
-
     struct PBRMaterial
     {
         // material properties
@@ -53,53 +48,406 @@ namespace ModelLoader
         GLuint useAOMap = GL_FALSE;
         GLuint useEmissiveMap = GL_FALSE;
     };
+    // MaterialBuffer中一个材质的布局，和着色器中std430的MaterialData一致：
+    // PBRMaterial参数按原样写入，之后是albedo/normal/metallic/roughness/ao五张贴图的引用(见MaterialTextures::Resolve)
+    constexpr std::size_t kMaterialTextureSlots = 5;
+    struct MaterialRecord
+    {
+        PBRMaterial params;
+        GLuint padding = 0;
+        glm::uvec2 textures[kMaterialTextureSlots];
+    };
+    static_assert(sizeof(PBRMaterial) == 44 && offsetof(MaterialRecord, textures) == 48, "MaterialRecord must match the std430 MaterialData layout");
+    static_assert(sizeof(MaterialRecord) <= Renderer::kMaterialStride, "MaterialRecord must fit in a MaterialBuffer slot");
+    // 贴图用途(采样器名)对应的槽位，不是PBR贴图时返回-1
+    inline int MaterialTextureSlot(const std::string &type)
+    {
+        static const char *const names[kMaterialTextureSlots] = {"material.albedoMap", "material.normalMap", "material.metallicMap", "material.roughnessMap", "material.aoMap"};
+        for (std::size_t i = 0; i < kMaterialTextureSlots; i++)
+            if (type == names[i])
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    // 网格引用的一张纹理(还未加载)，path是相对模型目录的路径
+    struct TextureRef
+    {
+        std::string type;
+        std::string path;
+        bool gammaCorrection = false;
+    };
+
+    // 网格上绑定的一张纹理：纹理对象由TextureCache在所有模型间共享，用途(采样器名)属于网格
+    // 比如glTF的metallicRoughness贴图同时作为metallicMap和roughnessMap使用
+    struct MeshTexture
+    {
+        std::string type;
+        std::shared_ptr<Renderer::Texture> texture;
+    };
+
+    // processMesh得到的CPU端网格数据，可以写入网格缓存，也可以用来创建Mesh
+    // 一级LOD：同一个索引缓冲中的一段，error是相对LOD0的几何误差(模型空间距离)
+    struct MeshLod
+    {
+        std::uint32_t indexOffset;
+        std::uint32_t indexCount;
+        float error;
+    };
+    constexpr std::size_t kMaxMeshLods = 4;
+
+    // 运行时选择LOD需要的信息：模型矩阵、相机位置，以及距离为1处一个单位长度对应的像素数
+    // Model::Draw会把model换成每个网格所在节点的世界矩阵
+    struct LodContext
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        float projectionScale = 1.0f;
+        // 投影到屏幕上的误差不超过这么多像素时就可以用更粗的LOD
+        float pixelThreshold = 1.0f;
+        // 开启后LOD0按meshlet做视锥/背面锥剔除，需要设置viewProjection
+        bool cullClusters = false;
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+
+        static float ProjectionScale(float fovyRadians, float viewportHeight)
+        {
+            return viewportHeight / (2.0f * std::tan(fovyRadians * 0.5f));
+        }
+    };
+
+    // 模型的一个节点：局部变换和父节点下标(-1表示根)，loader保证父节点排在子节点之前，节点0是整个模型的根
+    struct SceneNode
+    {
+        glm::mat4 local = glm::mat4(1.0f);
+        std::int32_t parent = -1;
+    };
+
+    // 没有骨骼的网格使用压缩格式，顶点存在compactVertices里，vertices为空
+    struct MeshData
+    {
+        VertexFormat format = VertexFormat::Full;
+        std::vector<Vertex> vertices;
+        std::vector<CompactVertex> compactVertices;
+        std::vector<unsigned int> indices;
+        std::vector<TextureRef> textures;
+        PBRMaterial material;
+        // 为空表示只有LOD0(全部索引)，否则indices里依次存放各级LOD的索引
+        std::vector<MeshLod> lods;
+        glm::vec3 boundsCenter = glm::vec3(0.0f);
+        float boundsRadius = 0.0f;
+        // LOD0的簇划分
+        std::vector<Meshlet> meshlets;
+        // 网格所在的节点(SceneNode下标)，顶点是相对这个节点的
+        std::uint32_t node = 0;
+
+        const void *VertexData() const
+        {
+            return format == VertexFormat::Compact ? static_cast<const void *>(compactVertices.data()) : static_cast<const void *>(vertices.data());
+        }
+        std::size_t VertexCount() const
+        {
+            return format == VertexFormat::Compact ? compactVertices.size() : vertices.size();
+        }
+    };
 
+    // 释放几何数据之后留在CPU端的碰撞用网格：最粗一级LOD引用到的位置和三角形(位置相对网格所在节点)
+    struct MeshCollision
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> indices;
+    };
+
+    // Mesh持有GL资源(MaterialBuffer的槽位、GeometryArena中的分配)，只能移动不能复制
     class Mesh
     {
     public:
         // mesh Data
+        // 只有直接用Vertex数组构造的网格才保留CPU端的顶点和索引，可以用ReleaseCpuGeometry释放
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
-        std::vector<std::shared_ptr<Renderer::Texture>> textures;
+        std::vector<MeshTexture> textures;
         PBRMaterial pbrmat;
-        unsigned int VAO;
-        bool usePBR;
-        /*  UBO  */
-        GLuint ubo;
-        GLuint bindingPoint = 0; // 和pbr.fs中的layout(std140, binding = 0)对应
-        GLfloat *ubo_ptr;
+        // 顶点和索引在全局GeometryArena中的位置
+        Renderer::GeometryAllocation geometry;
+        VertexFormat vertexFormat = VertexFormat::Full;
+        // 索引数量(从缓存创建的网格不保留CPU端的indices，所以单独记录)，包含所有LOD
+        std::size_t indexCount = 0;
+        // lods[0]是完整网格，至少有一级
+        std::vector<MeshLod> lods;
+        glm::vec3 boundsCenter = glm::vec3(0.0f);
+        float boundsRadius = 0.0f;
+        std::vector<Meshlet> meshlets;
+        // 所在节点在Model::GetTransforms()中的下标
+        std::uint32_t node = 0;
+        // 模型空间的轴对齐包围盒
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        // ModelLoadOptions::keepCollision打开时才有
+        std::shared_ptr<const MeshCollision> collision;
+        bool usePBR = false;
+        // 透明网格由Renderer::RenderList按从后往前的顺序开启混合绘制(加载器目前都按不透明处理)
+        bool transparent = false;
+        // 材质参数在MaterialBuffer中的槽位，绘制时作为materialIndex传给着色器
+        std::uint32_t materialSlot = Renderer::MaterialBuffer::kInvalidSlot;
+        // 贴图引用是否已经全部指向真正的纹理(异步纹理上传前引用的是占位纹理)
+        bool texturesResolved = false;
+        // 有贴图只能逐次绑定(Bind方式，或者纹理数组已经用完)
+        bool bindTextures = true;
 
-        void InitializeUBO()
+        // 修改材质参数只写一次MaterialBuffer，之后的绘制不再有额外开销(不要直接改pbrmat)
+        void SetMaterial(const PBRMaterial &material)
+        {
+            pbrmat = material;
+            if (materialSlot != Renderer::MaterialBuffer::kInvalidSlot)
+                Renderer::MaterialBuffer::GetInstance().Write(materialSlot, &pbrmat, sizeof(pbrmat));
+        }
+        // 提前把贴图引用写进材质(创建句柄或复制进纹理数组)，否则在第一次绘制时进行
+        void ResolveMaterialTextures()
         {
-            // 生成 UBO
-            glGenBuffers(1, &ubo);
-            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-            glBufferData(GL_UNIFORM_BUFFER, 44, nullptr, GL_STATIC_DRAW);
-            glBindBuffer(GL_UNIFORM_BUFFER, 0);
-            glBindBufferRange(GL_UNIFORM_BUFFER, 0, ubo, 0, 44);
+            if (materialSlot != Renderer::MaterialBuffer::kInvalidSlot && !texturesResolved)
+                resolveTextures();
         }
 
         // constructor
-        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<std::shared_ptr<Renderer::Texture>> textures, bool PBR, PBRMaterial pbr = PBRMaterial()) : usePBR(PBR)
+        // 参数按值传入后直接移动到成员里，调用方传右值时没有拷贝
+        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<MeshTexture> textures, bool PBR, PBRMaterial pbr = PBRMaterial()) : usePBR(PBR)
         {
-            this->vertices = vertices;
-            this->indices = indices;
-            this->textures = textures;
+            this->vertices = std::move(vertices);
+            this->indices = std::move(indices);
+            this->textures = std::move(textures);
             this->pbrmat = pbr;
-            // 生成 UBO(为每一个材质创建一个ubo，每次更新网格关于材质的数据时只需要更新材质的ubo即可)
-            InitializeUBO();
+            initializeMaterial();
             // now that we have all the required data, set the vertex buffers and its attribute pointers.
-            setupMesh();
+            setupMesh(this->vertices.data(), VertexFormat::Full, this->vertices.size(), this->indices.data(), IndexType::UInt32, this->indices.size());
+        }
+        // 直接从外部内存(比如映射的网格缓存)上传顶点和索引，不在CPU端保留副本，vertexData的布局由format决定，indexData的宽度由indexType决定
+        Mesh(const void *vertexData, VertexFormat format, std::size_t vertexCount, const void *indexData, IndexType indexType, std::size_t indexCount, std::vector<MeshTexture> textures, bool PBR, PBRMaterial pbr = PBRMaterial()) : usePBR(PBR)
+        {
+            this->textures = std::move(textures);
+            this->pbrmat = pbr;
+            initializeMaterial();
+            setupMesh(vertexData, format, vertexCount, indexData, indexType, indexCount);
         }
         ~Mesh()
         {
-            glDeleteVertexArrays(1, &VAO);
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteBuffers(1, &ubo);
+            releaseGL();
+        }
+        Mesh(const Mesh &) = delete;
+        Mesh &operator=(const Mesh &) = delete;
+        Mesh(Mesh &&other) noexcept
+        {
+            moveFrom(other);
+        }
+        Mesh &operator=(Mesh &&other) noexcept
+        {
+            if (this != &other)
+            {
+                releaseGL();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        // 上传完成后释放CPU端的顶点和索引，只保留包围体(和collision)；需要时用Model::ReloadGeometry从网格缓存重新读取
+        void ReleaseCpuGeometry()
+        {
+            std::vector<Vertex>().swap(vertices);
+            std::vector<unsigned int>().swap(indices);
+        }
+        bool HasCpuGeometry() const noexcept { return !vertices.empty(); }
+        void SetBounds(const glm::vec3 &minimum, const glm::vec3 &maximum)
+        {
+            boundsMin = minimum;
+            boundsMax = maximum;
+        }
+        void SetLods(const std::vector<MeshLod> &meshLods, const glm::vec3 &center, float radius)
+        {
+            if (!meshLods.empty())
+                lods = meshLods;
+            boundsCenter = center;
+            boundsRadius = radius;
+        }
+        void SetMeshlets(std::vector<Meshlet> clusters)
+        {
+            meshlets = std::move(clusters);
+        }
+        // 剔除不可见的meshlet，相邻的可见簇合并成一段，对每一段调用emit(网格内的索引偏移, 索引数)，返回可见的三角形数
+        template <typename Emit>
+        std::size_t CullMeshletRanges(const LodContext &context, Emit &&emit) const
+        {
+            ModelLoader::ClusterCuller culler(context.viewProjection * context.model,
+                                              glm::vec3(glm::inverse(context.model) * glm::vec4(context.cameraPosition, 1.0f)));
+            std::size_t triangles = 0;
+            std::size_t visible = 0;
+            std::uint32_t rangeBegin = 0, rangeEnd = ~0u;
+            for (const auto &meshlet : meshlets)
+            {
+                if (!culler.IsVisible(meshlet))
+                    continue;
+                visible++;
+                triangles += meshlet.triangleCount;
+                if (meshlet.indexOffset != rangeEnd)
+                {
+                    if (rangeEnd != ~0u)
+                        emit(rangeBegin, rangeEnd - rangeBegin);
+                    rangeBegin = meshlet.indexOffset;
+                }
+                rangeEnd = meshlet.indexOffset + meshlet.triangleCount * 3;
+            }
+            if (rangeEnd != ~0u)
+                emit(rangeBegin, rangeEnd - rangeBegin);
+            Renderer::RenderStats::GetInstance().AddClusters(meshlets.size(), visible);
+            return triangles;
+        }
+        std::size_t CullMeshlets(const LodContext &context, std::vector<GLsizei> &counts, std::vector<const void *> &offsets) const
+        {
+            counts.clear();
+            offsets.clear();
+            return CullMeshletRanges(context, [&](std::uint32_t indexOffset, std::uint32_t count)
+                                     {
+                                         counts.push_back(static_cast<GLsizei>(count));
+                                         offsets.push_back(geometry.IndexOffset(indexOffset)); });
+        }
+        // 能否放进IndirectDrawBuffer一次提交：材质在MaterialBuffer里，贴图也都写进了材质(不需要逐次绑定)
+        bool SupportsIndirect()
+        {
+            if (!geometry.Valid() || materialSlot == Renderer::MaterialBuffer::kInvalidSlot)
+                return false;
+            if (!texturesResolved)
+                resolveTextures();
+            return !bindTextures;
+        }
+        // 选择投影误差不超过pixelThreshold的最粗一级LOD
+        std::size_t SelectLod(const LodContext &context) const
+        {
+            if (lods.size() <= 1)
+                return 0;
+            glm::vec3 center = glm::vec3(context.model * glm::vec4(boundsCenter, 1.0f));
+            float scale = std::max({glm::length(glm::vec3(context.model[0])), glm::length(glm::vec3(context.model[1])), glm::length(glm::vec3(context.model[2]))});
+            // 到包围球表面的距离，相机在包围球内时按很近处理
+            float distance = std::max(glm::length(center - context.cameraPosition) - boundsRadius * scale, 1e-3f);
+            std::size_t selected = 0;
+            for (std::size_t i = 1; i < lods.size(); i++)
+            {
+                float pixels = lods[i].error * scale / distance * context.projectionScale;
+                if (pixels > context.pixelThreshold)
+                    break;
+                selected = i;
+            }
+            return selected;
         }
         // render the mesh
-        void Draw(Renderer::Shader &shader)
+        void Draw(Renderer::Shader &shader, std::size_t lod = 0)
+        {
+            if (!geometry.Valid())
+                return;
+            bindMaterial(shader);
+            Renderer::GeometryArena::GetInstance().Bind(geometry);
+            drawLod(lod);
+            resetState(shader);
+        }
+        // 按LodContext选择LOD；选中LOD0且开启了簇剔除时，只提交通过视锥和背面锥剔除的meshlet
+        void Draw(Renderer::Shader &shader, const LodContext &context)
+        {
+            if (!geometry.Valid())
+                return;
+            bindMaterial(shader);
+            Renderer::GeometryArena::GetInstance().Bind(geometry);
+            DrawGeometry(context);
+            resetState(shader);
+        }
+        // 只提交绘制调用：材质、贴图和VAO已经由调用方绑定(Renderer::RenderList只在它们变化时绑定)
+        void DrawGeometry(const LodContext &context)
+        {
+            std::size_t lod = SelectLod(context);
+            if (lod != 0 || !context.cullClusters || meshlets.empty())
+            {
+                drawLod(lod);
+                return;
+            }
+            std::size_t triangles = CullMeshlets(context, m_drawCounts, m_drawOffsets);
+            auto &stats = Renderer::RenderStats::GetInstance();
+            if (m_drawCounts.empty())
+            {
+                stats.AddCulled(lods[0].indexCount / 3);
+                return;
+            }
+            m_drawBaseVertices.assign(m_drawCounts.size(), static_cast<GLint>(geometry.baseVertex));
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_drawCounts.data(), geometry.GLIndexType(), m_drawOffsets.data(),
+                                          static_cast<GLsizei>(m_drawCounts.size()), m_drawBaseVertices.data());
+            stats.AddDraw(triangles, lods[0].indexCount / 3);
+        }
+        // Draw绑定的状态分成三部分，供排序提交只绑定变化的部分：材质槽位、逐次绑定的贴图(非PBR网格的贴图也在这里)
+        void BindMaterialSlot(Renderer::Shader &shader)
+        {
+            if (!usePBR)
+                return;
+            if (!texturesResolved)
+                resolveTextures();
+            shader.setInt("materialIndex", static_cast<int>(materialSlot));
+        }
+        // 贴图都已经写进材质时不需要绑定
+        bool NeedsTextureBinding() const noexcept { return !usePBR || bindTextures; }
+        void BindTextures(Renderer::Shader &shader)
+        {
+            if (!usePBR)
+                bindMaterial(shader);
+            else if (bindTextures)
+                bindPBRTextures(shader);
+        }
+
+        // 所有实例一次绘制：LOD取各实例需要的最细一级，不做meshlet剔除(簇的包围锥是相对单个模型矩阵的)
+        void DrawInstanced(Renderer::Shader &shader, Renderer::InstanceBuffer &instances, const LodContext &context)
+        {
+            if (!geometry.Valid() || instances.Count() == 0)
+                return;
+            std::size_t lod = lods.size() - 1;
+            LodContext instanceContext = context;
+            for (const auto &transform : instances.Transforms())
+            {
+                if (lod == 0)
+                    break;
+                instanceContext.model = transform * context.model;
+                lod = std::min(lod, SelectLod(instanceContext));
+            }
+            DrawInstanced(shader, instances, lod);
+        }
+        void DrawInstanced(Renderer::Shader &shader, Renderer::InstanceBuffer &instances, std::size_t lod = 0)
+        {
+            if (!geometry.Valid() || instances.Count() == 0)
+                return;
+            instances.Upload();
+            bindMaterial(shader);
+            shader.setBool("instanced", true);
+            Renderer::GeometryArena::GetInstance().Bind(geometry);
+            instances.Bind();
+            const MeshLod &range = lods[std::min(lod, lods.size() - 1)];
+            const auto count = static_cast<GLsizei>(instances.Count());
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), geometry.GLIndexType(),
+                                              const_cast<void *>(geometry.IndexOffset(range.indexOffset)), count, static_cast<GLint>(geometry.baseVertex));
+            // VAO是同一页所有网格共用的，换回单位变换
+            Renderer::InstanceBuffer::BindIdentity();
+            shader.setBool("instanced", false);
+            Renderer::RenderStats::GetInstance().AddDraw(range.indexCount / 3 * instances.Count(), lods[0].indexCount / 3 * instances.Count());
+            resetState(shader);
+        }
+
+    private:
+        void drawLod(std::size_t lod)
+        {
+            // 绘制网格，索引是相对网格自身的，由baseVertex偏移到arena中的位置
+            const MeshLod &range = lods[std::min(lod, lods.size() - 1)];
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), geometry.GLIndexType(),
+                                     const_cast<void *>(geometry.IndexOffset(range.indexOffset)), static_cast<GLint>(geometry.baseVertex));
+            Renderer::RenderStats::GetInstance().AddDraw(range.indexCount / 3, lods[0].indexCount / 3);
+        }
+
+        // 簇剔除后每帧重新填充的glMultiDrawElementsBaseVertex参数
+        std::vector<GLsizei> m_drawCounts;
+        std::vector<const void *> m_drawOffsets;
+        std::vector<GLint> m_drawBaseVertices;
+
+        // 选择材质槽位并绑定纹理，设置顶点格式uniform
+        void bindMaterial(Renderer::Shader &shader)
         {
             if (!usePBR)
             {
@@ -113,7 +461,7 @@ namespace ModelLoader
                     glActiveTexture(GL_TEXTURE0 + i); // 在绑定之前激活相应的纹理单元
                     // 获取纹理序号（diffuse_textureN 中的 N）
                     std::string number;
-                    std::string name = textures[i]->type;
+                    std::string name = textures[i].type;
                     if (name == "material.texture_diffuse")
                         number = std::to_string(diffuseNr++);
                     else if (name == "material.texture_specular")
@@ -124,9 +472,9 @@ namespace ModelLoader
                         number = std::to_string(heightNr++); // transfer unsigned int to string
 
                     // 给glsl里的采样器uniform设置纹理单元，采样器的名称相对固定(比如漫反射纹理就是texture_diffuse1,2,3...等)
-                    glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+                    shader.setInt(name + number, i);
                     // and finally bind the texture
-                    glBindTexture(GL_TEXTURE_2D, textures[i]->id);
+                    glBindTexture(GL_TEXTURE_2D, Renderer::TextureStreamer::GetInstance().GetBindID(*textures[i].texture, name));
                 }
             }
             else
@@ -142,122 +490,147 @@ namespace ModelLoader
                 // shader.setBool("material.useRoughnessMap", pbrmat.useRoughnessMap);
                 // shader.setBool("material.useAOMap", pbrmat.useAOMap);
                 // shader.setBool("material.useEmissiveMap", pbrmat.useEmissiveMap);
-                glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ubo);
-                glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-                // 映射ubo
-                ubo_ptr = (GLfloat *)glMapBufferRange(GL_UNIFORM_BUFFER, 0, 44, GL_MAP_WRITE_BIT);
-                // 检测是否映射成功
-                if (ubo_ptr == nullptr)
+                // 材质参数和贴图引用已经在MaterialBuffer里，只需要告诉着色器读哪个槽位
+                if (!texturesResolved)
+                    resolveTextures();
+                shader.setInt("materialIndex", static_cast<int>(materialSlot));
+                Renderer::MaterialTextures::GetInstance().BindArrays();
+                if (bindTextures)
+                    bindPBRTextures(shader);
+            }
+            // 顶点着色器据此选择法线的解码方式
+            shader.setBool("compactVertex", vertexFormat == VertexFormat::Compact);
+        }
+        // 逐次绑定PBR贴图到3~7号纹理单元，只在Bind方式或者纹理数组用完时使用
+        void bindPBRTextures(Renderer::Shader &shader)
+        {
+            // bind appropriate textures
+            for (unsigned int i = 0; i < textures.size(); i++)
+            {
+                // 获取纹理序号（diffuse_textureN 中的 N）
+                std::string number;
+                std::string name = textures[i].type;
+                if (name == "material.albedoMap")
                 {
-                    std::cout << "Failed to map uniform buffer object!" << std::endl;
-                    exit(-1);
+                    glActiveTexture(GL_TEXTURE3);
+                    shader.setInt(name, 3);
                 }
-                memcpy(&ubo_ptr[0], glm::value_ptr(pbrmat.albedo), 12);
-                ubo_ptr[3] = pbrmat.metallic;
-                ubo_ptr[4] = pbrmat.roughness;
-                // ubo_ptr[5] = pbrmat.useAlbedoMap;
-                glBufferSubData(GL_UNIFORM_BUFFER, 20, 4, &pbrmat.useAlbedoMap);
-                ubo_ptr[6] = pbrmat.useNormalMap;
-                ubo_ptr[7] = pbrmat.useMetallicMap;
-                ubo_ptr[8] = pbrmat.useRoughnessMap;
-                ubo_ptr[9] = pbrmat.useAOMap;
-                ubo_ptr[10] = pbrmat.useEmissiveMap;
-                glUnmapBuffer(GL_UNIFORM_BUFFER);
-
-                glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-                // bind appropriate textures
-                for (unsigned int i = 0; i < textures.size(); i++)
+                else if (name == "material.normalMap")
                 {
-                    // 获取纹理序号（diffuse_textureN 中的 N）
-                    std::string number;
-                    std::string name = textures[i]->type;
-                    if (name == "material.albedoMap")
-                    {
-                        glActiveTexture(GL_TEXTURE3);
-                        glUniform1i(glGetUniformLocation(shader.ID, (name).c_str()), 3);
-                    }
-                    else if (name == "material.normalMap")
-                    {
-                        glActiveTexture(GL_TEXTURE4);
-                        glUniform1i(glGetUniformLocation(shader.ID, (name).c_str()), 4);
-                    }
-                    else if (name == "material.metallicMap")
-                    {
-                        glActiveTexture(GL_TEXTURE5);
-                        glUniform1i(glGetUniformLocation(shader.ID, (name).c_str()), 5);
-                    }
-                    else if (name == "material.roughnessMap")
-                    {
-                        glActiveTexture(GL_TEXTURE6);
-                        glUniform1i(glGetUniformLocation(shader.ID, (name).c_str()), 6);
-                    }
-                    else if (name == "material.aoMap")
-                    {
-                        glActiveTexture(GL_TEXTURE7);
-                        glUniform1i(glGetUniformLocation(shader.ID, (name).c_str()), 7);
-                    }
-
-                    // and finally bind the texture
-                    glBindTexture(GL_TEXTURE_2D, textures[i]->id);
+                    glActiveTexture(GL_TEXTURE4);
+                    shader.setInt(name, 4);
+                }
+                else if (name == "material.metallicMap")
+                {
+                    glActiveTexture(GL_TEXTURE5);
+                    shader.setInt(name, 5);
+                }
+                else if (name == "material.roughnessMap")
+                {
+                    glActiveTexture(GL_TEXTURE6);
+                    shader.setInt(name, 6);
+                }
+                else if (name == "material.aoMap")
+                {
+                    glActiveTexture(GL_TEXTURE7);
+                    shader.setInt(name, 7);
                 }
-            }
-            // 绘制网格
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
 
+                // and finally bind the texture
+                glBindTexture(GL_TEXTURE_2D, Renderer::TextureStreamer::GetInstance().GetBindID(*textures[i].texture, name));
+            }
+        }
+        void resetState(Renderer::Shader &shader)
+        {
             // always good practice to set everything back to defaults once configured.
             glActiveTexture(GL_TEXTURE0);
+            // 着色器开关(compactVertex、Model的nodeTransform)画完后都要复位：同一个shader之后还会画不经过Mesh/Model的几何体(比如renderSphere)
+            if (vertexFormat == VertexFormat::Compact)
+                shader.setBool("compactVertex", false);
         }
 
-    private:
-        // render data
-        unsigned int VBO, EBO;
 
-        // initializes all the buffer objects/arrays
-        void setupMesh()
+        void initializeMaterial()
         {
-            // create buffers/arrays
-            glGenVertexArrays(1, &VAO);
-            glGenBuffers(1, &VBO);
-            glGenBuffers(1, &EBO);
-
-            glBindVertexArray(VAO);
-            // load data into vertex buffers
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            // A great thing about structs is that their memory layout is sequential for all its items.
-            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-            // again translates to 3/2 floats which translates to a byte array.
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-            // set the vertex attribute pointers
-            // vertex Positions
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-            // vertex normals
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
-            // vertex texture coords
-            glEnableVertexAttribArray(2);
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
-            // vertex tangent
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
-            // vertex bitangent
-            glEnableVertexAttribArray(4);
-            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
-            // ids
-            glEnableVertexAttribArray(5);
-            glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, m_BoneIDs));
+            if (!usePBR)
+                return;
+            MaterialRecord record;
+            record.params = pbrmat;
+            std::fill(std::begin(record.textures), std::end(record.textures), Renderer::kMaterialTextureBound);
+            materialSlot = Renderer::MaterialBuffer::GetInstance().Allocate(&record, sizeof(record));
+        }
+        // 把贴图引用写进材质：还没上传完的纹理先引用占位纹理，全部驻留之后不再检查
+        void resolveTextures()
+        {
+            auto &materialTextures = Renderer::MaterialTextures::GetInstance();
+            auto &streamer = Renderer::TextureStreamer::GetInstance();
+            glm::uvec2 refs[kMaterialTextureSlots];
+            std::fill(std::begin(refs), std::end(refs), Renderer::kMaterialTextureBound);
+            bool resident = true;
+            bindTextures = false;
+            for (const auto &texture : textures)
+            {
+                int slot = MaterialTextureSlot(texture.type);
+                if (slot < 0)
+                    continue;
+                resident = resident && texture.texture->IsResident();
+                refs[slot] = materialTextures.Resolve(streamer.GetBindID(*texture.texture, texture.type));
+                bindTextures = bindTextures || refs[slot] == Renderer::kMaterialTextureBound;
+            }
+            Renderer::MaterialBuffer::GetInstance().Write(materialSlot, refs, sizeof(refs), offsetof(MaterialRecord, textures));
+            texturesResolved = resident;
+        }
+        void releaseGL()
+        {
+            Renderer::GeometryArena::GetInstance().Free(geometry);
+            if (materialSlot != Renderer::MaterialBuffer::kInvalidSlot)
+                Renderer::MaterialBuffer::GetInstance().Free(materialSlot);
+            materialSlot = Renderer::MaterialBuffer::kInvalidSlot;
+        }
+        // GL资源的所有权转移给this，other析构时不再释放
+        void moveFrom(Mesh &other) noexcept
+        {
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            pbrmat = other.pbrmat;
+            geometry = std::exchange(other.geometry, Renderer::GeometryAllocation());
+            vertexFormat = other.vertexFormat;
+            indexCount = other.indexCount;
+            lods = std::move(other.lods);
+            boundsCenter = other.boundsCenter;
+            boundsRadius = other.boundsRadius;
+            meshlets = std::move(other.meshlets);
+            node = other.node;
+            boundsMin = other.boundsMin;
+            boundsMax = other.boundsMax;
+            collision = std::move(other.collision);
+            usePBR = other.usePBR;
+            transparent = other.transparent;
+            materialSlot = std::exchange(other.materialSlot, Renderer::MaterialBuffer::kInvalidSlot);
+            texturesResolved = other.texturesResolved;
+            bindTextures = other.bindTextures;
+            m_drawCounts = std::move(other.m_drawCounts);
+            m_drawOffsets = std::move(other.m_drawOffsets);
+            m_drawBaseVertices = std::move(other.m_drawBaseVertices);
+        }
 
-            // weights
-            glEnableVertexAttribArray(6);
-            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_Weights));
-            glBindVertexArray(0);
+        // 在全局GeometryArena中分配并上传顶点和索引，顶点属性由arena中该格式的VAO负责
+        // 顶点数不超过65536的网格即使传入32位索引也压成16位上传
+        void setupMesh(const void *vertexData, VertexFormat format, std::size_t vertexCount, const void *indexData, IndexType indexType, std::size_t indexCount)
+        {
+            this->vertexFormat = format;
+            this->indexCount = indexCount;
+            this->lods.assign(1, MeshLod{0, static_cast<std::uint32_t>(indexCount), 0.0f});
+            std::vector<std::uint16_t> shortIndices;
+            if (indexType == IndexType::UInt32 && ChooseIndexType(vertexCount) == IndexType::UInt16)
+            {
+                shortIndices.resize(indexCount);
+                NarrowIndices(static_cast<const unsigned int *>(indexData), indexCount, shortIndices.data());
+                indexData = shortIndices.data();
+                indexType = IndexType::UInt16;
+            }
+            geometry = Renderer::GeometryArena::GetInstance().Allocate(format, vertexData, vertexCount, indexData, indexType, indexCount);
         }
     };
 } // namespace Model
@@ -0,0 +1,470 @@
+#pragma once
+// 加载时的网格优化，在processMesh之后(工作线程上)执行，结果会写入网格缓存
+// 1. 按顶点字节内容哈希去重(焊接)
+// 2. 顶点缓存友好的三角形重排(Forsyth线性速度算法)
+// 3. 减少overdraw：按缓存未命中切分成簇，簇按朝外程度排序
+// 4. 顶点按首次使用的顺序重排，提高顶点读取的局部性
+#include "Mesh.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+namespace ModelLoader
+{
+    struct MeshOptimizeStats
+    {
+        std::size_t vertexCountBefore = 0;
+        std::size_t vertexCountAfter = 0;
+        std::size_t triangleCount = 0;
+        // ACMR = 顶点着色次数/三角形数，ATVR = 顶点着色次数/顶点数(理想值为1)
+        float acmrBefore = 0.0f;
+        float acmrAfter = 0.0f;
+        float atvrBefore = 0.0f;
+        float atvrAfter = 0.0f;
+    };
+
+    class MeshOptimizer
+    {
+    public:
+        // 统计ACMR/ATVR时模拟的FIFO顶点缓存大小
+        static constexpr std::size_t kAnalyzeCacheSize = 16;
+        // overdraw排序时允许簇的ACMR比原来变差的比例
+        static constexpr float kOverdrawThreshold = 1.05f;
+
+        static MeshOptimizeStats Optimize(MeshData &data)
+        {
+            if (data.format == VertexFormat::Compact)
+                return Optimize(data.compactVertices, data.indices);
+            return Optimize(data.vertices, data.indices);
+        }
+
+        template <typename VertexType>
+        static MeshOptimizeStats Optimize(std::vector<VertexType> &vertices, std::vector<unsigned int> &indices)
+        {
+            MeshOptimizeStats stats;
+            stats.vertexCountBefore = vertices.size();
+            stats.triangleCount = indices.size() / 3;
+            AnalyzeVertexCache(indices, vertices.size(), stats.acmrBefore, stats.atvrBefore);
+            if (indices.size() >= 3 && indices.size() % 3 == 0)
+            {
+                WeldVertices(vertices, indices);
+                OptimizeVertexCache(indices, vertices.size());
+                OptimizeOverdraw(indices, vertices);
+                OptimizeVertexFetch(vertices, indices);
+            }
+            stats.vertexCountAfter = vertices.size();
+            AnalyzeVertexCache(indices, vertices.size(), stats.acmrAfter, stats.atvrAfter);
+            return stats;
+        }
+
+        // 顶点数超过16位索引范围的网格按三角形顺序(已经是顶点缓存优化后的顺序)切成若干部分，每部分不超过kMaxShortIndexVertices个顶点
+        // 切分处的顶点会复制到相邻部分，复制超过kSplitVertexOverhead时不切分，网格保持32位索引
+        static constexpr float kSplitVertexOverhead = 0.1f;
+
+        static std::vector<MeshData> SplitForShortIndices(MeshData &&data)
+        {
+            std::vector<std::vector<unsigned int>> partIndices;
+            std::vector<std::vector<unsigned int>> partVertices;
+            if (data.VertexCount() > kMaxShortIndexVertices && !data.indices.empty() && data.indices.size() % 3 == 0 &&
+                PartitionTriangles(data.indices, data.VertexCount(), partIndices, partVertices))
+            {
+                std::vector<MeshData> parts(partIndices.size());
+                for (std::size_t part = 0; part < parts.size(); part++)
+                {
+                    auto &result = parts[part];
+                    result.format = data.format;
+                    result.textures = data.textures;
+                    result.material = data.material;
+                    result.node = data.node;
+                    result.indices = std::move(partIndices[part]);
+                    if (data.format == VertexFormat::Compact)
+                        GatherVertices(data.compactVertices, partVertices[part], result.compactVertices);
+                    else
+                        GatherVertices(data.vertices, partVertices[part], result.vertices);
+                }
+                return parts;
+            }
+            std::vector<MeshData> parts;
+            parts.push_back(std::move(data));
+            return parts;
+        }
+
+        // 模拟FIFO顶点缓存，统计ACMR和ATVR
+        static void AnalyzeVertexCache(const std::vector<unsigned int> &indices, std::size_t vertexCount, float &acmr, float &atvr)
+        {
+            acmr = atvr = 0.0f;
+            if (indices.empty() || vertexCount == 0)
+                return;
+            std::vector<std::size_t> timestamps(vertexCount, 0);
+            std::size_t time = kAnalyzeCacheSize + 1;
+            std::size_t misses = 0;
+            for (unsigned int index : indices)
+            {
+                // 时间戳在最近kAnalyzeCacheSize次未命中之内的顶点还在缓存里
+                if (time - timestamps[index] > kAnalyzeCacheSize)
+                {
+                    timestamps[index] = time++;
+                    misses++;
+                }
+            }
+            acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+            atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+        }
+
+        // 字节完全相同的顶点合并成一个(压缩格式量化之后相同的顶点也会被合并)
+        template <typename VertexType>
+        static void WeldVertices(std::vector<VertexType> &vertices, std::vector<unsigned int> &indices)
+        {
+            static_assert(std::is_trivially_copyable_v<VertexType>, "vertices are compared byte-wise");
+            std::size_t tableSize = 1;
+            while (tableSize < vertices.size() * 2)
+                tableSize <<= 1;
+            constexpr unsigned int kEmpty = ~0u;
+            std::vector<unsigned int> table(tableSize, kEmpty);
+            std::vector<unsigned int> remap(vertices.size());
+            std::vector<VertexType> unique;
+            unique.reserve(vertices.size());
+            for (std::size_t i = 0; i < vertices.size(); i++)
+            {
+                std::size_t slot = HashBytes(&vertices[i], sizeof(VertexType)) & (tableSize - 1);
+                // 线性探测
+                while (table[slot] != kEmpty && std::memcmp(&unique[table[slot]], &vertices[i], sizeof(VertexType)) != 0)
+                    slot = (slot + 1) & (tableSize - 1);
+                if (table[slot] == kEmpty)
+                {
+                    table[slot] = static_cast<unsigned int>(unique.size());
+                    unique.push_back(vertices[i]);
+                }
+                remap[i] = table[slot];
+            }
+            for (auto &index : indices)
+                index = remap[index];
+            vertices.swap(unique);
+        }
+
+        // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+        static void OptimizeVertexCache(std::vector<unsigned int> &indices, std::size_t vertexCount)
+        {
+            constexpr int kCacheSize = 32;
+            const std::size_t triangleCount = indices.size() / 3;
+
+            // 顶点 -> 使用它的三角形
+            std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+            for (unsigned int index : indices)
+                adjacencyOffsets[index + 1]++;
+            std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+            std::vector<unsigned int> adjacency(indices.size());
+            std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); i++)
+                adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+            std::vector<unsigned int> liveTriangles(vertexCount);
+            for (std::size_t v = 0; v < vertexCount; v++)
+                liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+            std::vector<int> cachePosition(vertexCount, -1);
+            std::vector<float> vertexScore(vertexCount);
+            for (std::size_t v = 0; v < vertexCount; v++)
+                vertexScore[v] = ForsythScore(-1, liveTriangles[v], kCacheSize);
+
+            std::vector<float> triangleScore(triangleCount);
+            std::vector<bool> emitted(triangleCount, false);
+            for (std::size_t t = 0; t < triangleCount; t++)
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+            std::vector<unsigned int> result;
+            result.reserve(indices.size());
+            std::vector<unsigned int> cache, nextCache;
+            cache.reserve(kCacheSize + 3);
+            nextCache.reserve(kCacheSize + 3);
+            std::size_t scanCursor = 0;
+            long best = static_cast<long>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+
+            while (best >= 0)
+            {
+                const unsigned int *tri = &indices[best * 3];
+                result.insert(result.end(), tri, tri + 3);
+                emitted[best] = true;
+
+                // 新三角形的顶点放到缓存最前面，其余顶点依次后移
+                nextCache.assign(tri, tri + 3);
+                for (unsigned int v : cache)
+                {
+                    if (v != tri[0] && v != tri[1] && v != tri[2])
+                        nextCache.push_back(v);
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = tri[k];
+                    liveTriangles[v]--;
+                    // 从邻接表里移除已经输出的三角形
+                    auto begin = adjacency.begin() + adjacencyOffsets[v];
+                    auto end = begin + liveTriangles[v] + 1;
+                    auto found = std::find(begin, end, static_cast<unsigned int>(best));
+                    if (found != end)
+                        std::iter_swap(found, end - 1);
+                }
+                for (std::size_t i = 0; i < nextCache.size(); i++)
+                {
+                    unsigned int v = nextCache[i];
+                    cachePosition[v] = i < kCacheSize ? static_cast<int>(i) : -1;
+                    vertexScore[v] = ForsythScore(cachePosition[v], liveTriangles[v], kCacheSize);
+                }
+                // 更新受影响的三角形分数，同时找出分数最高的候选
+                best = -1;
+                float bestScore = -1.0f;
+                for (unsigned int v : nextCache)
+                {
+                    for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + liveTriangles[v]; a++)
+                    {
+                        unsigned int t = adjacency[a];
+                        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                        if (triangleScore[t] > bestScore)
+                        {
+                            bestScore = triangleScore[t];
+                            best = t;
+                        }
+                    }
+                }
+                if (nextCache.size() > kCacheSize)
+                    nextCache.resize(kCacheSize);
+                cache.swap(nextCache);
+
+                // 缓存里的顶点都没有剩余三角形了，按顺序找下一个还没输出的三角形
+                if (best < 0)
+                {
+                    while (scanCursor < triangleCount && emitted[scanCursor])
+                        scanCursor++;
+                    if (scanCursor < triangleCount)
+                        best = static_cast<long>(scanCursor);
+                }
+            }
+            indices.swap(result);
+        }
+
+        // 参考Sander等人的"Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"：
+        // 在顶点缓存顺序上按缓存未命中切分成簇，再把朝外的簇排在前面，先画的簇更可能遮挡后画的簇
+        template <typename VertexType>
+        static void OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<VertexType> &vertices)
+        {
+            const std::size_t triangleCount = indices.size() / 3;
+            std::vector<std::size_t> clusters = SoftBoundaries(indices, vertices.size(), HardBoundaries(indices, vertices.size()));
+
+            glm::vec3 meshCenter(0.0f);
+            float meshArea = 0.0f;
+            std::vector<glm::vec3> clusterCenter(clusters.size(), glm::vec3(0.0f));
+            std::vector<glm::vec3> clusterNormal(clusters.size(), glm::vec3(0.0f));
+            std::vector<float> clusterArea(clusters.size(), 0.0f);
+            for (std::size_t c = 0; c < clusters.size(); c++)
+            {
+                std::size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+                for (std::size_t t = clusters[c]; t < end; t++)
+                {
+                    const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+                    const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+                    const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float area = glm::length(normal);
+                    glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+                    clusterCenter[c] += center * area;
+                    clusterNormal[c] += normal;
+                    clusterArea[c] += area;
+                }
+                meshCenter += clusterCenter[c];
+                meshArea += clusterArea[c];
+                if (clusterArea[c] > 0.0f)
+                    clusterCenter[c] = clusterCenter[c] / clusterArea[c];
+            }
+            if (meshArea > 0.0f)
+                meshCenter = meshCenter / meshArea;
+
+            std::vector<float> sortKey(clusters.size());
+            for (std::size_t c = 0; c < clusters.size(); c++)
+            {
+                float normalLength = glm::length(clusterNormal[c]);
+                sortKey[c] = normalLength > 0.0f ? glm::dot(clusterCenter[c] - meshCenter, clusterNormal[c] / normalLength) : 0.0f;
+            }
+            std::vector<std::size_t> order(clusters.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&sortKey](std::size_t a, std::size_t b)
+                             { return sortKey[a] > sortKey[b]; });
+
+            std::vector<unsigned int> result;
+            result.reserve(indices.size());
+            for (std::size_t c : order)
+            {
+                std::size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+                result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+            }
+            indices.swap(result);
+        }
+
+        // 顶点按在索引中第一次出现的顺序重新排列，未被引用的顶点被丢弃
+        template <typename VertexType>
+        static void OptimizeVertexFetch(std::vector<VertexType> &vertices, std::vector<unsigned int> &indices)
+        {
+            constexpr unsigned int kUnused = ~0u;
+            std::vector<unsigned int> remap(vertices.size(), kUnused);
+            std::vector<VertexType> result;
+            result.reserve(vertices.size());
+            for (auto &index : indices)
+            {
+                if (remap[index] == kUnused)
+                {
+                    remap[index] = static_cast<unsigned int>(result.size());
+                    result.push_back(vertices[index]);
+                }
+                index = remap[index];
+            }
+            vertices.swap(result);
+        }
+
+    private:
+        // 贪心地按顺序把三角形放进当前部分，放不下时开始新的部分；partVertices[i]是第i部分的局部顶点到原顶点的映射
+        static bool PartitionTriangles(const std::vector<unsigned int> &indices, std::size_t vertexCount,
+                                       std::vector<std::vector<unsigned int>> &partIndices, std::vector<std::vector<unsigned int>> &partVertices)
+        {
+            constexpr unsigned int kUnused = ~0u;
+            // remap只对stamp等于当前部分编号的顶点有效，避免每部分清空
+            std::vector<unsigned int> remap(vertexCount, kUnused);
+            std::vector<unsigned int> stamp(vertexCount, kUnused);
+            std::size_t totalVertices = 0;
+            const std::size_t limit = std::size_t(float(vertexCount) * (1.0f + kSplitVertexOverhead));
+            for (std::size_t i = 0; i < indices.size(); i += 3)
+            {
+                const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+                unsigned int part = static_cast<unsigned int>(partIndices.size()) - 1;
+                // 这个三角形会给当前部分新增的顶点数(退化三角形的重复顶点只算一次)
+                std::size_t added = 0;
+                if (!partIndices.empty())
+                    added = (stamp[a] != part ? 1 : 0) + (stamp[b] != part && b != a ? 1 : 0) + (stamp[c] != part && c != a && c != b ? 1 : 0);
+                if (partIndices.empty() || partVertices.back().size() + added > kMaxShortIndexVertices)
+                {
+                    partIndices.emplace_back();
+                    partVertices.emplace_back();
+                    part = static_cast<unsigned int>(partIndices.size()) - 1;
+                }
+                for (std::size_t k = 0; k < 3; k++)
+                {
+                    unsigned int index = indices[i + k];
+                    if (stamp[index] != part)
+                    {
+                        stamp[index] = part;
+                        remap[index] = static_cast<unsigned int>(partVertices.back().size());
+                        partVertices.back().push_back(index);
+                        if (++totalVertices > limit)
+                            return false;
+                    }
+                    partIndices.back().push_back(remap[index]);
+                }
+            }
+            return partIndices.size() > 1;
+        }
+
+        template <typename VertexType>
+        static void GatherVertices(const std::vector<VertexType> &vertices, const std::vector<unsigned int> &sourceIndices, std::vector<VertexType> &result)
+        {
+            result.reserve(sourceIndices.size());
+            for (auto index : sourceIndices)
+                result.push_back(vertices[index]);
+        }
+
+        static float ForsythScore(int cachePosition, unsigned int liveTriangles, int cacheSize)
+        {
+            if (liveTriangles == 0)
+                return -1.0f;
+            float score = 0.0f;
+            if (cachePosition >= 0)
+            {
+                // 最近一个三角形的三个顶点分数固定，避免偏向刚用过的三角形
+                if (cachePosition < 3)
+                    score = 0.75f;
+                else
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(cacheSize - 3), 1.5f);
+            }
+            // 剩余三角形越少的顶点越优先，尽快把它用完
+            score += 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+            return score;
+        }
+
+        // 三个顶点都未命中缓存的三角形作为簇的起点
+        static std::vector<std::size_t> HardBoundaries(const std::vector<unsigned int> &indices, std::size_t vertexCount)
+        {
+            std::vector<std::size_t> boundaries;
+            std::vector<std::size_t> timestamps(vertexCount, 0);
+            std::size_t time = kAnalyzeCacheSize + 1;
+            for (std::size_t t = 0; t < indices.size() / 3; t++)
+            {
+                std::size_t misses = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = indices[t * 3 + k];
+                    if (time - timestamps[v] > kAnalyzeCacheSize)
+                    {
+                        timestamps[v] = time++;
+                        misses++;
+                    }
+                }
+                if (t == 0 || misses == 3)
+                    boundaries.push_back(t);
+            }
+            return boundaries;
+        }
+
+        // 在硬边界切出的簇内部，累计ACMR不超过整簇ACMR*阈值的位置再切开，簇越小overdraw排序越有效
+        static std::vector<std::size_t> SoftBoundaries(const std::vector<unsigned int> &indices, std::size_t vertexCount, const std::vector<std::size_t> &hard)
+        {
+            const std::size_t triangleCount = indices.size() / 3;
+            std::vector<std::size_t> boundaries;
+            std::vector<std::size_t> timestamps(vertexCount, 0);
+            std::size_t time = 0;
+            auto resetCache = [&time]
+            { time += kAnalyzeCacheSize + 1; };
+            auto countMisses = [&](std::size_t t)
+            {
+                std::size_t misses = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = indices[t * 3 + k];
+                    if (time - timestamps[v] > kAnalyzeCacheSize)
+                    {
+                        timestamps[v] = time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            };
+            for (std::size_t c = 0; c < hard.size(); c++)
+            {
+                std::size_t start = hard[c];
+                std::size_t end = c + 1 < hard.size() ? hard[c + 1] : triangleCount;
+                resetCache();
+                std::size_t clusterMisses = 0;
+                for (std::size_t t = start; t < end; t++)
+                    clusterMisses += countMisses(t);
+                float threshold = kOverdrawThreshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+                boundaries.push_back(start);
+                resetCache();
+                std::size_t misses = 0;
+                std::size_t subStart = start;
+                for (std::size_t t = start; t < end; t++)
+                {
+                    misses += countMisses(t);
+                    if (t + 1 < end && static_cast<float>(misses) / static_cast<float>(t + 1 - subStart) <= threshold)
+                    {
+                        boundaries.push_back(t + 1);
+                        subStart = t + 1;
+                        misses = 0;
+                        resetCache();
+                    }
+                }
+            }
+            return boundaries;
+        }
+    };
+}
@@ -0,0 +1,348 @@
+#pragma once
+// 基于二次误差度量(QEM, Garland & Heckbert)的网格简化，用于导入时生成LOD链
+// 只做边折叠到已有顶点，所以各级LOD共用同一个顶点缓冲，每级LOD只是同一个索引缓冲里的一段
+// UV/法线接缝上的顶点(同一位置有多个顶点)和开放边界上的顶点不参与折叠，避免撕裂
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ModelLoader
+{
+    struct LodSettings
+    {
+        // 每级LOD相对LOD0的目标三角形比例(最多kMaxMeshLods - 1级)
+        std::vector<float> ratios = {0.5f, 0.25f, 0.125f};
+        // 允许的最大几何误差，相对网格包围球半径
+        float maxError = 0.02f;
+    };
+
+    class MeshSimplifier
+    {
+    public:
+        // 为data生成LOD链：各级索引依次追加在data.indices后面，data.lods记录每级的范围和误差
+        // 需要在MeshOptimizer之后调用(LOD0就是优化后的索引)
+        static void BuildLodChain(MeshData &data, const LodSettings &settings)
+        {
+            ComputeBounds(data);
+            data.lods.assign(1, MeshLod{0, static_cast<std::uint32_t>(data.indices.size()), 0.0f});
+            if (data.format == VertexFormat::Compact)
+                BuildLodChain(data.compactVertices, data, settings);
+            else
+                BuildLodChain(data.vertices, data, settings);
+        }
+
+        // 简化到targetIndexCount个索引以内，或者误差达到targetError(绝对距离)为止，resultError返回实际误差
+        template <typename VertexType>
+        static std::vector<unsigned int> Simplify(const std::vector<VertexType> &vertices, const std::vector<unsigned int> &indices,
+                                                  std::size_t targetIndexCount, float targetError, float &resultError)
+        {
+            const std::size_t vertexCount = vertices.size();
+            std::vector<unsigned int> result(indices);
+            resultError = 0.0f;
+            if (indices.size() <= targetIndexCount || vertexCount == 0)
+                return result;
+
+            std::vector<bool> locked = ClassifyLockedVertices(vertices, indices);
+            std::vector<Quadric> quadrics(vertexCount);
+            for (std::size_t t = 0; t < indices.size() / 3; t++)
+            {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                if (area <= 0.0f)
+                    continue;
+                Quadric plane = Quadric::FromPlane(normal / area, p0, area);
+                for (int k = 0; k < 3; k++)
+                    quadrics[indices[t * 3 + k]] += plane;
+            }
+
+            const float maxCost = targetError * targetError;
+            std::vector<unsigned int> remap(vertexCount);
+            std::vector<bool> touched(vertexCount);
+            std::vector<unsigned int> adjacencyOffsets, adjacency;
+            while (result.size() > targetIndexCount)
+            {
+                BuildAdjacency(result, vertexCount, adjacencyOffsets, adjacency);
+
+                // 每个可折叠顶点选代价最小的一条出边
+                std::vector<Collapse> collapses;
+                std::vector<int> bestCollapse(vertexCount, -1);
+                for (std::size_t i = 0; i < result.size(); i++)
+                {
+                    unsigned int from = result[i];
+                    unsigned int to = result[i - i % 3 + (i + 1) % 3];
+                    if (locked[from] || from == to)
+                        continue;
+                    Quadric combined = quadrics[from];
+                    combined += quadrics[to];
+                    float cost = combined.Error(vertices[to].Position);
+                    if (cost > maxCost)
+                        continue;
+                    if (bestCollapse[from] < 0)
+                    {
+                        bestCollapse[from] = static_cast<int>(collapses.size());
+                        collapses.push_back({from, to, cost});
+                    }
+                    else if (cost < collapses[bestCollapse[from]].cost)
+                        collapses[bestCollapse[from]] = {from, to, cost};
+                }
+                if (collapses.empty())
+                    break;
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                          { return a.cost < b.cost; });
+
+                for (std::size_t v = 0; v < vertexCount; v++)
+                    remap[v] = static_cast<unsigned int>(v);
+                std::fill(touched.begin(), touched.end(), false);
+                std::size_t triangleCount = result.size() / 3;
+                const std::size_t targetTriangles = targetIndexCount / 3;
+                std::size_t applied = 0;
+                for (const auto &collapse : collapses)
+                {
+                    if (triangleCount <= targetTriangles)
+                        break;
+                    if (touched[collapse.from] || touched[collapse.to])
+                        continue;
+                    if (FlipsTriangle(vertices, result, adjacencyOffsets, adjacency, collapse.from, collapse.to))
+                        continue;
+                    // 折叠之后会消失的是同时包含from和to的三角形
+                    std::size_t removed = 0;
+                    for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+                    {
+                        const unsigned int *tri = &result[adjacency[a] * 3];
+                        if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                            removed++;
+                        // 这一轮里from周围的顶点都不能再动，保证上面的翻转检查仍然有效
+                        for (int k = 0; k < 3; k++)
+                            touched[tri[k]] = true;
+                    }
+                    remap[collapse.from] = collapse.to;
+                    quadrics[collapse.to] += quadrics[collapse.from];
+                    triangleCount -= std::min(removed, triangleCount);
+                    resultError = std::max(resultError, collapse.cost);
+                    applied++;
+                }
+                if (applied == 0)
+                    break;
+
+                // 应用折叠并删除退化三角形
+                std::size_t write = 0;
+                for (std::size_t t = 0; t < result.size() / 3; t++)
+                {
+                    unsigned int a = remap[result[t * 3]], b = remap[result[t * 3 + 1]], c = remap[result[t * 3 + 2]];
+                    if (a == b || b == c || a == c)
+                        continue;
+                    result[write++] = a;
+                    result[write++] = b;
+                    result[write++] = c;
+                }
+                result.resize(write);
+            }
+            resultError = std::sqrt(resultError);
+            return result;
+        }
+
+    private:
+        // 对称4x4矩阵(10个系数)，Error返回加权平均的点到平面距离平方
+        struct Quadric
+        {
+            float a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+            float b0 = 0, b1 = 0, b2 = 0, c = 0;
+            float weight = 0;
+
+            static Quadric FromPlane(const glm::vec3 &n, const glm::vec3 &p, float weight)
+            {
+                float d = -glm::dot(n, p);
+                Quadric q;
+                q.a00 = n.x * n.x * weight;
+                q.a01 = n.x * n.y * weight;
+                q.a02 = n.x * n.z * weight;
+                q.a11 = n.y * n.y * weight;
+                q.a12 = n.y * n.z * weight;
+                q.a22 = n.z * n.z * weight;
+                q.b0 = n.x * d * weight;
+                q.b1 = n.y * d * weight;
+                q.b2 = n.z * d * weight;
+                q.c = d * d * weight;
+                q.weight = weight;
+                return q;
+            }
+            Quadric &operator+=(const Quadric &o)
+            {
+                a00 += o.a00, a01 += o.a01, a02 += o.a02, a11 += o.a11, a12 += o.a12, a22 += o.a22;
+                b0 += o.b0, b1 += o.b1, b2 += o.b2, c += o.c;
+                weight += o.weight;
+                return *this;
+            }
+            float Error(const glm::vec3 &p) const
+            {
+                float rx = a00 * p.x + a01 * p.y + a02 * p.z + b0;
+                float ry = a01 * p.x + a11 * p.y + a12 * p.z + b1;
+                float rz = a02 * p.x + a12 * p.y + a22 * p.z + b2;
+                float error = rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c;
+                return weight > 0.0f ? std::max(error / weight, 0.0f) : 0.0f;
+            }
+        };
+
+        struct Collapse
+        {
+            unsigned int from;
+            unsigned int to;
+            float cost;
+        };
+
+        // 按位哈希之前把-0.0f换成+0.0f，和PositionEqual的浮点比较保持一致(两者相等但位模式不同)
+        struct PositionHash
+        {
+            std::size_t operator()(const glm::vec3 &p) const noexcept
+            {
+                const glm::vec3 canonical(p.x == 0.0f ? 0.0f : p.x, p.y == 0.0f ? 0.0f : p.y, p.z == 0.0f ? 0.0f : p.z);
+                return static_cast<std::size_t>(HashBytes(&canonical, sizeof(canonical)));
+            }
+        };
+        struct PositionEqual
+        {
+            bool operator()(const glm::vec3 &a, const glm::vec3 &b) const noexcept
+            {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+
+        // 接缝顶点(位置和其他顶点重合)和开放边界上的顶点锁定不动
+        template <typename VertexType>
+        static std::vector<bool> ClassifyLockedVertices(const std::vector<VertexType> &vertices, const std::vector<unsigned int> &indices)
+        {
+            const std::size_t vertexCount = vertices.size();
+            std::vector<bool> locked(vertexCount, false);
+            std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstAtPosition;
+            firstAtPosition.reserve(vertexCount);
+            std::vector<unsigned int> positionId(vertexCount);
+            std::vector<unsigned int> siblings(vertexCount, 0);
+            for (std::size_t v = 0; v < vertexCount; v++)
+            {
+                auto [iter, inserted] = firstAtPosition.try_emplace(vertices[v].Position, static_cast<unsigned int>(v));
+                positionId[v] = iter->second;
+                siblings[iter->second]++;
+            }
+            for (std::size_t v = 0; v < vertexCount; v++)
+                locked[v] = siblings[positionId[v]] > 1;
+
+            // 有向边(a,b)没有对应的反向边(b,a)时是边界边
+            std::unordered_map<std::uint64_t, int> edges;
+            edges.reserve(indices.size());
+            auto edgeKey = [](unsigned int a, unsigned int b)
+            { return (std::uint64_t(a) << 32) | b; };
+            for (std::size_t i = 0; i < indices.size(); i++)
+            {
+                unsigned int a = positionId[indices[i]];
+                unsigned int b = positionId[indices[i - i % 3 + (i + 1) % 3]];
+                edges[edgeKey(a, b)]++;
+            }
+            for (std::size_t i = 0; i < indices.size(); i++)
+            {
+                unsigned int a = positionId[indices[i]];
+                unsigned int b = positionId[indices[i - i % 3 + (i + 1) % 3]];
+                if (edges.find(edgeKey(b, a)) == edges.end() || edges[edgeKey(a, b)] > 1)
+                {
+                    locked[indices[i]] = true;
+                    locked[indices[i - i % 3 + (i + 1) % 3]] = true;
+                }
+            }
+            return locked;
+        }
+
+        static void BuildAdjacency(const std::vector<unsigned int> &indices, std::size_t vertexCount,
+                                   std::vector<unsigned int> &offsets, std::vector<unsigned int> &adjacency)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices)
+                offsets[index + 1]++;
+            for (std::size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            adjacency.resize(indices.size());
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); i++)
+                adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // from移动到to之后，from周围剩下的三角形法线是否翻转
+        template <typename VertexType>
+        static bool FlipsTriangle(const std::vector<VertexType> &vertices, const std::vector<unsigned int> &indices,
+                                  const std::vector<unsigned int> &offsets, const std::vector<unsigned int> &adjacency,
+                                  unsigned int from, unsigned int to)
+        {
+            const glm::vec3 &target = vertices[to].Position;
+            for (unsigned int a = offsets[from]; a < offsets[from + 1]; a++)
+            {
+                const unsigned int *tri = &indices[adjacency[a] * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to)
+                    continue;
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = vertices[tri[k]].Position;
+                    q[k] = tri[k] == from ? target : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0f)
+                    return true;
+            }
+            return false;
+        }
+
+        static void ComputeBounds(MeshData &data)
+        {
+            auto compute = [&data](const auto &vertices)
+            {
+                if (vertices.empty())
+                    return;
+                glm::vec3 lo = vertices[0].Position, hi = vertices[0].Position;
+                for (const auto &vertex : vertices)
+                {
+                    lo = glm::min(lo, vertex.Position);
+                    hi = glm::max(hi, vertex.Position);
+                }
+                data.boundsCenter = (lo + hi) * 0.5f;
+                float radius = 0.0f;
+                for (const auto &vertex : vertices)
+                    radius = std::max(radius, glm::length(vertex.Position - data.boundsCenter));
+                data.boundsRadius = radius;
+            };
+            if (data.format == VertexFormat::Compact)
+                compute(data.compactVertices);
+            else
+                compute(data.vertices);
+        }
+
+        template <typename VertexType>
+        static void BuildLodChain(const std::vector<VertexType> &vertices, MeshData &data, const LodSettings &settings)
+        {
+            const std::vector<unsigned int> source(data.indices.begin(), data.indices.begin() + data.lods[0].indexCount);
+            std::size_t previousCount = source.size();
+            float errorLimit = settings.maxError * data.boundsRadius;
+            for (float ratio : settings.ratios)
+            {
+                if (data.lods.size() >= kMaxMeshLods)
+                    break;
+                std::size_t target = static_cast<std::size_t>(static_cast<float>(source.size() / 3) * ratio) * 3;
+                float error = 0.0f;
+                std::vector<unsigned int> lod = Simplify(vertices, source, target, errorLimit, error);
+                // 误差上限内已经简化不动了，再往下生成也只是重复
+                if (lod.empty() || lod.size() > previousCount * 9 / 10)
+                    break;
+                MeshOptimizer::OptimizeVertexCache(lod, vertices.size());
+                data.lods.push_back({static_cast<std::uint32_t>(data.indices.size()), static_cast<std::uint32_t>(lod.size()), error});
+                data.indices.insert(data.indices.end(), lod.begin(), lod.end());
+                previousCount = lod.size();
+            }
+        }
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+// meshlet(簇)：网格LOD0索引缓冲中连续的一段三角形(最多64个顶点、124个三角形)
+// 每个簇带包围球和法线锥，绘制前在CPU上做视锥剔除和背面锥剔除，只提交可见的簇
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+namespace ModelLoader
+{
+    constexpr std::uint32_t kMeshletMaxVertices = 64;
+    constexpr std::uint32_t kMeshletMaxTriangles = 124;
+
+    struct Meshlet
+    {
+        // 在网格索引缓冲中的起始位置(以索引计)和三角形数
+        std::uint32_t indexOffset;
+        std::uint32_t triangleCount;
+        std::uint32_t vertexCount;
+        // 模型空间的包围球
+        glm::vec3 center;
+        float radius;
+        // 法线锥：coneCutoff > 1表示法线太分散，不做背面剔除
+        glm::vec3 coneAxis;
+        float coneCutoff;
+    };
+
+    // 模型空间的视锥平面和相机位置，每个网格每帧计算一次
+    struct ClusterCuller
+    {
+        glm::vec4 planes[6];
+        glm::vec3 cameraPosition;
+
+        // clip = projection * view * model，从中提取出的平面直接在模型空间
+        ClusterCuller(const glm::mat4 &clip, const glm::vec3 &objectSpaceCamera) : cameraPosition(objectSpaceCamera)
+        {
+            auto row = [&clip](int i)
+            { return glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]); };
+            glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+            planes[0] = r3 + r0;
+            planes[1] = r3 - r0;
+            planes[2] = r3 + r1;
+            planes[3] = r3 - r1;
+            planes[4] = r3 + r2;
+            planes[5] = r3 - r2;
+            for (auto &plane : planes)
+            {
+                float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+                if (length > 0.0f)
+                    plane = plane / length;
+            }
+        }
+
+        bool IsVisible(const Meshlet &meshlet) const
+        {
+            for (const auto &plane : planes)
+            {
+                if (plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius)
+                    return false;
+            }
+            // 相机在法线锥的反向锥内时，簇里所有三角形都背对相机
+            glm::vec3 view = meshlet.center - cameraPosition;
+            return glm::dot(view, meshlet.coneAxis) < meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+        }
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+// 把网格LOD0切分成meshlet：按(已经过顶点缓存优化的)三角形顺序贪心装入，顶点数或三角形数超出上限就开始新簇
+// 三角形顺序不变，所以每个簇就是索引缓冲里连续的一段，可以直接用glMultiDrawElements绘制
+#include "Mesh.h"
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ModelLoader
+{
+    class MeshletBuilder
+    {
+    public:
+        static void Build(MeshData &data)
+        {
+            data.meshlets.clear();
+            if (data.format == VertexFormat::Compact)
+                Build(data.compactVertices, data);
+            else
+                Build(data.vertices, data);
+        }
+
+    private:
+        template <typename VertexType>
+        static void Build(const std::vector<VertexType> &vertices, MeshData &data)
+        {
+            const std::uint32_t indexCount = data.lods.empty() ? static_cast<std::uint32_t>(data.indices.size()) : data.lods[0].indexCount;
+            // 记录顶点最后一次被加入的簇，用来判断顶点是否已经在当前簇里
+            std::vector<std::uint32_t> owner(vertices.size(), ~0u);
+            std::uint32_t start = 0;
+            std::uint32_t vertexCount = 0;
+            for (std::uint32_t i = 0; i + 2 < indexCount; i += 3)
+            {
+                std::uint32_t meshletId = static_cast<std::uint32_t>(data.meshlets.size());
+                std::uint32_t newVertices = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = data.indices[i + k];
+                    if (owner[v] != meshletId && std::find(&data.indices[i], &data.indices[i] + k, v) == &data.indices[i] + k)
+                        newVertices++;
+                }
+                if (vertexCount + newVertices > kMeshletMaxVertices || (i - start) / 3 >= kMeshletMaxTriangles)
+                {
+                    data.meshlets.push_back(MakeMeshlet(vertices, data.indices, start, i, vertexCount));
+                    start = i;
+                    vertexCount = 0;
+                    meshletId++;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = data.indices[i + k];
+                    if (owner[v] != meshletId)
+                    {
+                        owner[v] = meshletId;
+                        vertexCount++;
+                    }
+                }
+            }
+            if (start < indexCount)
+                data.meshlets.push_back(MakeMeshlet(vertices, data.indices, start, indexCount, vertexCount));
+        }
+
+        template <typename VertexType>
+        static Meshlet MakeMeshlet(const std::vector<VertexType> &vertices, const std::vector<unsigned int> &indices,
+                                   std::uint32_t begin, std::uint32_t end, std::uint32_t vertexCount)
+        {
+            Meshlet meshlet{};
+            meshlet.indexOffset = begin;
+            meshlet.triangleCount = (end - begin) / 3;
+            meshlet.vertexCount = vertexCount;
+
+            glm::vec3 lo = vertices[indices[begin]].Position, hi = lo;
+            for (std::uint32_t i = begin; i < end; i++)
+            {
+                lo = glm::min(lo, vertices[indices[i]].Position);
+                hi = glm::max(hi, vertices[indices[i]].Position);
+            }
+            meshlet.center = (lo + hi) * 0.5f;
+            for (std::uint32_t i = begin; i < end; i++)
+                meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+
+            // 法线锥轴取面积加权的平均法线，张角由和轴夹角最大的三角形法线决定
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshlet.triangleCount);
+            glm::vec3 axis(0.0f);
+            for (std::uint32_t i = begin; i + 2 < end; i += 3)
+            {
+                glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - vertices[indices[i]].Position,
+                                              vertices[indices[i + 2]].Position - vertices[indices[i]].Position);
+                float area = glm::length(normal);
+                if (area <= 0.0f)
+                    continue;
+                axis += normal;
+                normals.push_back(normal / area);
+            }
+            float axisLength = glm::length(axis);
+            meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+            float minDot = normals.empty() ? -1.0f : 1.0f;
+            for (const auto &normal : normals)
+                minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+            // 锥的半张角超过90度时无法整体剔除；否则把法线锥转换成"相机落在反向锥内"的判断阈值sin(a)
+            meshlet.coneCutoff = minDot <= 0.0f ? 2.0f : std::sqrt(1.0f - minDot * minDot);
+            return meshlet;
+        }
+    };
+}
@@ -10,8 +10,21 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "GltfLoader.h"
+#include "IndirectDrawBuffer.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "ModelCache.h"
+#include "ProcessMemory.h"
+#include "Profiler.h"
+#include "RenderList.h"
 #include "Shader.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
 
 #include <string>
 #include <fstream>
@@ -21,31 +34,186 @@
 #include <vector>
 #include <ranges>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <functional>
+#include <future>
 #include <memory>
 namespace ModelLoader
 {
 
+    // 模型加载选项
+    struct ModelLoadOptions
+    {
+        // 使用二进制网格缓存(模型文件旁边的*.meshcache)，命中时跳过Assimp
+        bool useMeshCache = true;
+        // 每个aiMesh的CPU端转换作为一个任务并行执行(关闭后串行，方便对比耗时)
+        bool parallelConversion = true;
+        // 纹理在解码线程池中异步解码，由TextureStreamer在GL线程上传，上传完成前绑定占位纹理
+        bool asyncTextures = true;
+        // 纹理在CPU上编码成BC7/BC5并缓存到图片旁边的*.texcache，之后直接上传压缩数据
+        bool compressTextures = true;
+        // 导入后做顶点焊接、顶点缓存/overdraw优化和顶点读取重排，并打印每个网格优化前后的ACMR/ATVR
+        bool optimizeMeshes = true;
+        // 导入时用QEM简化生成LOD链，Draw(shader, LodContext)按投影误差选择LOD
+        bool generateLods = true;
+        LodSettings lod;
+        // 把LOD0切分成meshlet，Draw时按簇做视锥/背面剔除(LodContext::cullClusters)
+        bool buildMeshlets = true;
+        // .gltf/.glb用GltfLoader直接读取映射的缓冲，遇到不支持的特性时回退到Assimp
+        bool nativeGltf = true;
+        // 顶点数不超过65536的网格总是使用16位索引(网格缓存里也按16位保存)；打开时更大的网格在复制顶点不多时切分成几个这样的网格
+        bool shortIndices = true;
+        // 网格上传后在CPU端保留一份最粗LOD的位置和三角形(Mesh::collision)，给拾取/碰撞用；完整几何可以用Model::ReloadGeometry重新读取
+        bool keepCollision = false;
+    };
+
+    // 异步加载的进度和取消标志，由加载线程和GL线程共享
+    struct ModelLoadProgress
+    {
+        std::atomic<std::size_t> meshCount{0};
+        std::atomic<std::size_t> convertedMeshes{0};
+        std::atomic<std::size_t> uploadedMeshes{0};
+        std::atomic<bool> cancelled{false};
+    };
+
+    // Model::Prepare的结果：网格数据来自本次导入(meshData)或者映射的网格缓存(cache)，views统一描述每个网格
+    // 之后在GL线程上由BeginUpload/UploadNext逐个创建Mesh
+    struct PreparedModel
+    {
+        std::string path;
+        const char *importer = "";
+        std::vector<MeshData> meshData;
+        std::shared_ptr<ModelCache> cache;
+        std::vector<CachedMeshView> views;
+        // 节点层级，views[i].node是下标
+        std::vector<SceneNode> nodes;
+        // 每个网格的轴对齐包围盒(min, max)，加载期间绘制代理用
+        std::vector<std::pair<glm::vec3, glm::vec3>> bounds;
+        // 按下标取内嵌图片的数据(glTF的images或者aiScene::mTextures)，持有源文件直到网格全部创建完
+        std::function<Renderer::ImageSource(std::size_t)> embeddedImages;
+        std::size_t nextMesh = 0;
+        double importMs = 0.0;
+        double convertMs = 0.0;
+        double uploadMs = 0.0;
+    };
+
+    // 构造时不加载，由Renderer::AsyncModelLoader分阶段加载
+    struct DeferredLoad
+    {
+        explicit DeferredLoad() = default;
+    };
+    inline constexpr DeferredLoad deferredLoad{};
+
     class Model
     {
     public:
         // model data
         std::vector<std::shared_ptr<Mesh>> meshes;
-        std::vector<std::shared_ptr<Renderer::Texture>> textures_loaded; // stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+        std::vector<std::shared_ptr<Renderer::Texture>> textures_loaded; // textures referenced by this model, shared with other models through Renderer::TextureCache
         std::string directory;
         bool gammaCorrection;
         bool usePBR;
+        ModelLoadOptions options;
 
         // constructor, expects a filepath to a 3D model.
-        Model(std::string const &path, bool gamma = false, bool PBR = false) : gammaCorrection(gamma), usePBR(PBR)
+        Model(std::string const &path, bool gamma = false, bool PBR = false, ModelLoadOptions options = ModelLoadOptions()) : gammaCorrection(gamma), usePBR(PBR), options(options)
+        {
+            loadModel(path);
+        }
+        Model(DeferredLoad, bool gamma = false, bool PBR = false, ModelLoadOptions options = ModelLoadOptions()) : gammaCorrection(gamma), usePBR(PBR), options(options)
         {
-            loadModel(path, PBR);
         }
 
+        // 模型在世界中的变换(节点0的局部矩阵)，资源里的节点变换都在它之下
+        void SetTransform(const glm::mat4 &transform)
+        {
+            if (m_transforms.Size() > 0)
+                m_transforms.SetLocal(0, transform);
+            m_rootTransform = transform;
+        }
+        // 节点层级，可以修改单个节点的局部矩阵(比如做动画)，绘制前统一更新
+        Renderer::TransformHierarchy &GetTransforms() noexcept { return m_transforms; }
+
         // draws the model, and thus all its meshes
+        // 网格的模型矩阵和法线矩阵来自节点层级的SSBO(着色器按nodeIndex读取)，不再使用model/normalMatrix uniform
         void Draw(Renderer::Shader &shader)
         {
+            beginNodes(shader);
             for (unsigned int i = 0; i < meshes.size(); i++)
+            {
+                shader.setInt("nodeIndex", static_cast<int>(meshes[i]->node));
                 meshes[i]->Draw(shader);
+            }
+            drawProxies(shader);
+            endNodes(shader);
+        }
+        // 每个网格按相机距离选择投影误差足够小的最粗LOD，LOD0还会按meshlet剔除
+        void Draw(Renderer::Shader &shader, const LodContext &context)
+        {
+            beginNodes(shader);
+            LodContext meshContext = context;
+            for (unsigned int i = 0; i < meshes.size(); i++)
+            {
+                shader.setInt("nodeIndex", static_cast<int>(meshes[i]->node));
+                meshContext.model = m_transforms.World(meshes[i]->node);
+                meshes[i]->Draw(shader, meshContext);
+            }
+            drawProxies(shader);
+            endNodes(shader);
+        }
+        // 可以间接绘制的网格只加入draws，由调用方在收集完所有模型之后统一Submit；其余网格(需要逐次绑定贴图、加载中的代理)直接绘制
+        void DrawIndirect(Renderer::Shader &shader, Renderer::IndirectDrawBuffer &draws, const LodContext &context)
+        {
+            beginNodes(shader);
+            LodContext meshContext = context;
+            for (auto &mesh : meshes)
+            {
+                meshContext.model = m_transforms.World(mesh->node);
+                if (mesh->SupportsIndirect())
+                {
+                    draws.Add(*mesh, meshContext, m_transforms.Normal(mesh->node));
+                    continue;
+                }
+                shader.setInt("nodeIndex", static_cast<int>(mesh->node));
+                mesh->Draw(shader, meshContext);
+            }
+            drawProxies(shader);
+            endNodes(shader);
+        }
+        // 把网格(以及加载中的代理)加入排序提交列表，由调用方在收集完所有模型之后统一Submit
+        void Collect(Renderer::RenderList &list, Renderer::Shader &shader)
+        {
+            m_transforms.Update();
+            for (auto &mesh : meshes)
+                list.Add(shader, *mesh, m_transforms.World(mesh->node), m_transforms.Normal(mesh->node));
+            for (auto &proxy : m_proxies)
+            {
+                if (proxy)
+                    list.Add(shader, *proxy, m_transforms.World(proxy->node), m_transforms.Normal(proxy->node));
+            }
+        }
+        // 按instances中的每个变换各画一份(作用在整个模型上)，每个网格只有一次draw call，材质也只绑定一次
+        void DrawInstanced(Renderer::Shader &shader, Renderer::InstanceBuffer &instances, const LodContext &context)
+        {
+            beginNodes(shader);
+            LodContext meshContext = context;
+            for (unsigned int i = 0; i < meshes.size(); i++)
+            {
+                shader.setInt("nodeIndex", static_cast<int>(meshes[i]->node));
+                meshContext.model = m_transforms.World(meshes[i]->node);
+                meshes[i]->DrawInstanced(shader, instances, meshContext);
+            }
+            for (auto &proxy : m_proxies)
+            {
+                if (!proxy)
+                    continue;
+                shader.setInt("nodeIndex", static_cast<int>(proxy->node));
+                proxy->DrawInstanced(shader, instances);
+            }
+            endNodes(shader);
         }
         ~Model()
         {
@@ -59,55 +227,573 @@ namespace ModelLoader
             }
         }
 
+        // 分阶段加载，同步构造也走这三步：
+        // 1. Prepare：读网格缓存或者导入并转换网格，不调用GL，可以在任意线程执行(只读取构造参数)
+        bool Prepare(std::string const &path, PreparedModel &prepared, ModelLoadProgress *progress = nullptr) const
+        {
+            auto ms = [](auto begin, auto end)
+            { return std::chrono::duration<double, std::milli>(end - begin).count(); };
+            prepared.path = path;
+            auto importStart = std::chrono::steady_clock::now();
+            ModelCacheSource cacheSource;
+            if (options.useMeshCache)
+            {
+                cacheSource = describeCacheSource(path);
+                if (prepareFromCache(path, cacheSource, prepared))
+                {
+                    prepared.importer = "cache";
+                    prepared.importMs = ms(importStart, std::chrono::steady_clock::now());
+                    if (progress)
+                    {
+                        progress->meshCount = prepared.views.size();
+                        progress->convertedMeshes = prepared.views.size();
+                    }
+                    finishPrepare(prepared);
+                    return true;
+                }
+            }
+
+            // glTF优先走专用加载器，不支持的特性再回退到Assimp
+            std::vector<MeshOptimizeStats> optimizeStats;
+            auto convertStart = importStart;
+            if (options.nativeGltf && GltfLoader::IsGltf(path))
+            {
+                auto gltf = std::make_shared<GltfLoader>();
+                std::string error;
+                bool opened = false;
+                {
+                    Renderer::ProfileScope scope("import.gltf");
+                    opened = gltf->Open(path, error);
+                }
+                if (opened)
+                {
+                    convertStart = std::chrono::steady_clock::now();
+                    prepared.meshData = convertMeshes(gltf->PrimitiveCount(), [&gltf, this](std::size_t i)
+                                                      { return gltf->ProcessPrimitive(i, usePBR); }, optimizeStats, progress);
+                    prepared.nodes = gltf->Nodes();
+                    prepared.importer = "gltf";
+                    prepared.embeddedImages = [gltf](std::size_t index)
+                    { return gltf->Image(index); };
+                }
+                else
+                    std::cout << "GltfLoader: " << path << ": " << error << ", falling back to Assimp" << std::endl;
+            }
+            if (prepared.importer[0] == '\0')
+            {
+                // read file via ASSIMP
+                auto importer = std::make_shared<Assimp::Importer>();
+                const aiScene *scene = nullptr;
+                {
+                    Renderer::ProfileScope scope("import.assimp");
+                    scene = importer->ReadFile(path, kImportFlags);
+                }
+                // check for errors
+                if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+                {
+                    std::cout << "ERROR::ASSIMP:: " << importer->GetErrorString() << std::endl;
+                    return false;
+                }
+
+                // process ASSIMP's root node recursively
+                convertStart = std::chrono::steady_clock::now();
+                std::vector<aiMesh *> sceneMeshes;
+                std::vector<std::uint32_t> meshNodes;
+                prepared.nodes.assign(1, SceneNode());
+                processNode(scene->mRootNode, scene, sceneMeshes, meshNodes, prepared.nodes, 0);
+                prepared.meshData = convertMeshes(sceneMeshes.size(), [this, &sceneMeshes, &meshNodes, scene](std::size_t i)
+                                                  {
+                                                      MeshData data = processMesh(sceneMeshes[i], scene, usePBR);
+                                                      data.node = meshNodes[i];
+                                                      return data; }, optimizeStats, progress);
+                prepared.importer = "assimp";
+                // 只有带内嵌纹理的场景才需要一直持有importer
+                if (scene->mNumTextures > 0)
+                {
+                    prepared.embeddedImages = [importer, scene](std::size_t index)
+                    { return embeddedImage(scene, index); };
+                }
+            }
+            // 取消时转换结果不完整，不能写入缓存
+            if (progress && progress->cancelled)
+                return false;
+            prepared.importMs = ms(importStart, convertStart);
+            prepared.convertMs = ms(convertStart, std::chrono::steady_clock::now());
+
+            printConvertStats(prepared.meshData, optimizeStats);
+            if (options.useMeshCache && cacheSource.stamp != 0)
+            {
+                Renderer::ProfileScope scope("mesh.cache_write");
+                ModelCache::Write(ModelCache::CachePathFor(path), cacheSource, cacheImportFlags(usePBR), prepared.meshData, prepared.nodes, collectEmbeddedImages(prepared));
+            }
+            prepared.views.reserve(prepared.meshData.size());
+            for (auto &data : prepared.meshData)
+            {
+                prepared.views.push_back({data.VertexData(), data.format, data.VertexCount(), data.indices.data(), IndexType::UInt32, data.indices.size(), data.material,
+                                          std::move(data.textures), std::move(data.lods), data.boundsCenter, data.boundsRadius, std::move(data.meshlets), data.node});
+            }
+            finishPrepare(prepared);
+            return true;
+        }
+        // 2. BeginUpload(GL线程)：withProxies时先为每个网格创建包围盒代理，真正的网格创建之前绘制代理
+        void BeginUpload(PreparedModel &prepared, bool withProxies)
+        {
+            // retrieve the directory path of the filepath
+            directory = prepared.path.substr(0, prepared.path.find_last_of('/'));
+            m_path = prepared.path;
+            meshes.reserve(meshes.size() + prepared.views.size());
+            m_transforms.Assign(prepared.nodes);
+            m_transforms.SetLocal(0, m_rootTransform);
+            m_proxies.clear();
+            if (!withProxies)
+                return;
+            for (std::size_t i = 0; i < prepared.views.size(); i++)
+            {
+                m_proxies.push_back(makeProxy(prepared.bounds[i], prepared.views[i].material));
+                m_proxies.back()->node = prepared.views[i].node;
+            }
+        }
+        // 3. UploadNext(GL线程)：创建下一个Mesh并换掉它的代理，还有剩下的网格时返回true
+        bool UploadNext(PreparedModel &prepared)
+        {
+            if (prepared.nextMesh >= prepared.views.size())
+                return false;
+            auto uploadStart = std::chrono::steady_clock::now();
+            auto &view = prepared.views[prepared.nextMesh];
+            auto textures = loadTextures(view.textures, prepared);
+            {
+                Renderer::ProfileScope scope("mesh.upload", true);
+                auto &mesh = meshes.emplace_back(std::make_shared<Mesh>(view.vertices, view.format, view.vertexCount, view.indices, view.indexType, view.indexCount, std::move(textures), usePBR, view.material));
+                mesh->SetLods(view.lods, view.boundsCenter, view.boundsRadius);
+                mesh->SetMeshlets(std::move(view.meshlets));
+                mesh->node = view.node;
+                if (prepared.nextMesh < prepared.bounds.size())
+                    mesh->SetBounds(prepared.bounds[prepared.nextMesh].first, prepared.bounds[prepared.nextMesh].second);
+                if (options.keepCollision)
+                    mesh->collision = makeCollision(view);
+            }
+            // 导入得到的CPU端几何已经上传，马上释放，不用等整个模型创建完
+            if (prepared.nextMesh < prepared.meshData.size())
+            {
+                auto &data = prepared.meshData[prepared.nextMesh];
+                std::vector<Vertex>().swap(data.vertices);
+                std::vector<CompactVertex>().swap(data.compactVertices);
+                std::vector<unsigned int>().swap(data.indices);
+            }
+            if (prepared.nextMesh < m_proxies.size())
+                m_proxies[prepared.nextMesh].reset();
+            prepared.nextMesh++;
+            prepared.uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+            if (prepared.nextMesh < prepared.views.size())
+                return true;
+
+            m_proxies.clear();
+            std::cout << "Model: " << prepared.path << " (" << prepared.views.size() << " meshes) import(" << prepared.importer << ") " << prepared.importMs
+                      << " ms, convert " << prepared.convertMs << " ms (" << (options.parallelConversion ? "parallel" : "serial")
+                      << "), upload " << prepared.uploadMs << " ms, peak RSS " << Renderer::PeakResidentBytes() / (1024 * 1024) << " MB" << std::endl;
+            Renderer::GeometryArena::GetInstance().PrintStats();
+            return false;
+        }
+        // 取消加载：释放已经创建的网格、代理和纹理引用
+        void Unload()
+        {
+            meshes.clear();
+            m_proxies.clear();
+            textures_loaded.clear();
+        }
+        // 还有网格没有创建(正在绘制代理)
+        bool IsLoading() const noexcept { return !m_proxies.empty(); }
+
+        // 网格上传后CPU端不保留几何，需要时(比如重新烘焙、精确拾取)从网格缓存读回第meshIndex个网格的顶点和索引
+        // 缓存不存在或者已经失效时返回false
+        bool ReloadGeometry(std::size_t meshIndex, MeshData &data) const
+        {
+            if (!options.useMeshCache || m_path.empty())
+                return false;
+            ModelCache cache;
+            if (!cache.Open(ModelCache::CachePathFor(m_path), describeCacheSource(m_path), cacheImportFlags(usePBR)) || meshIndex >= cache.MeshCount())
+                return false;
+            CachedMeshView view = cache.GetMesh(meshIndex);
+            data = MeshData();
+            data.format = view.format;
+            const auto *vertices = static_cast<const std::uint8_t *>(view.vertices);
+            if (view.format == VertexFormat::Compact)
+                data.compactVertices.assign(reinterpret_cast<const CompactVertex *>(vertices), reinterpret_cast<const CompactVertex *>(vertices) + view.vertexCount);
+            else
+                data.vertices.assign(reinterpret_cast<const Vertex *>(vertices), reinterpret_cast<const Vertex *>(vertices) + view.vertexCount);
+            data.indices.resize(view.indexCount);
+            WidenIndices(view.indices, view.indexType, view.indexCount, data.indices.data());
+            data.textures = std::move(view.textures);
+            data.material = view.material;
+            data.lods = std::move(view.lods);
+            data.boundsCenter = view.boundsCenter;
+            data.boundsRadius = view.boundsRadius;
+            data.meshlets = std::move(view.meshlets);
+            data.node = view.node;
+            return true;
+        }
+
     private:
-        // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-        void loadModel(std::string const &path, bool usePBR)
+        std::string m_path;
+        // 分阶段加载期间代替还没创建的网格，下标和PreparedModel::views一致
+        std::vector<std::shared_ptr<Mesh>> m_proxies;
+        Renderer::TransformHierarchy m_transforms;
+        glm::mat4 m_rootTransform = glm::mat4(1.0f);
+
+        void drawProxies(Renderer::Shader &shader)
         {
-            // read file via ASSIMP
-            Assimp::Importer importer;
-            const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-            // check for errors
-            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            for (auto &proxy : m_proxies)
             {
-                std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+                if (!proxy)
+                    continue;
+                shader.setInt("nodeIndex", static_cast<int>(proxy->node));
+                proxy->Draw(shader);
+            }
+        }
+        // 节点矩阵有变化时重新计算并上传(每个模型每帧最多一次)，绑定到着色器的SSBO上
+        void beginNodes(Renderer::Shader &shader)
+        {
+            m_transforms.Upload();
+            m_transforms.Bind();
+            shader.setBool("nodeTransform", m_transforms.Size() > 0);
+        }
+        void endNodes(Renderer::Shader &shader)
+        {
+            // 恢复成model uniform，原因见Mesh::resetState
+            shader.setBool("nodeTransform", false);
+        }
+        void finishPrepare(PreparedModel &prepared) const
+        {
+            prepared.bounds.reserve(prepared.views.size());
+            for (const auto &view : prepared.views)
+                prepared.bounds.push_back(computeBounds(view));
+        }
+
+        static constexpr unsigned int kImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+        // 缓存键里的导入标志：Assimp后处理标志加上会影响processMesh结果的加载参数
+        std::uint32_t cacheImportFlags(bool usePBR) const
+        {
+            return kImportFlags | (usePBR ? 0x80000000u : 0u) | (options.optimizeMeshes ? 0x40000000u : 0u) | (options.generateLods ? 0x20000000u : 0u) |
+                   (options.buildMeshlets ? 0x10000000u : 0u) | (options.nativeGltf ? 0x08000000u : 0u) |
+                   (options.shortIndices ? 0x04000000u : 0u);
+        }
+        // 缓存键再混入LOD参数，参数改变时缓存失效
+        ModelCacheSource describeCacheSource(std::string const &path) const
+        {
+            std::uint64_t salt = 0;
+            if (options.generateLods)
+            {
+                salt = HashBytes(options.lod.ratios.data(), options.lod.ratios.size() * sizeof(float));
+                salt = HashBytes(&options.lod.maxError, sizeof(options.lod.maxError), salt);
+            }
+            return ModelCache::DescribeSource(path, salt);
+        }
+
+        // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+        void loadModel(std::string const &path)
+        {
+            PreparedModel prepared;
+            if (!Prepare(path, prepared))
                 return;
+            BeginUpload(prepared, false);
+            while (UploadNext(prepared))
+            {
+            }
+        }
+
+        // 命中缓存时网格和内嵌图片直接指向映射内存，不经过Assimp，也不在CPU端逐顶点复制
+        bool prepareFromCache(std::string const &path, const ModelCacheSource &cacheSource, PreparedModel &prepared) const
+        {
+            if (cacheSource.stamp == 0)
+                return false;
+            Renderer::ProfileScope scope("mesh.cache_read");
+            auto cache = std::make_shared<ModelCache>();
+            if (!cache->Open(ModelCache::CachePathFor(path), cacheSource, cacheImportFlags(usePBR)))
+                return false;
+            bool hasEmbedded = false;
+            prepared.views.reserve(cache->MeshCount());
+            for (std::size_t i = 0; i < cache->MeshCount(); i++)
+            {
+                auto &view = prepared.views.emplace_back(cache->GetMesh(i));
+                hasEmbedded |= std::ranges::any_of(view.textures, [](const TextureRef &ref)
+                                                   { return !ref.path.empty() && ref.path[0] == '*'; });
+            }
+            prepared.nodes = cache->Nodes();
+            // 内嵌图片引用缓存的映射内存，ImageSource::owner持有缓存直到异步解码结束
+            if (hasEmbedded)
+            {
+                prepared.embeddedImages = [cache](std::size_t index)
+                {
+                    Renderer::ImageSource source = cache->Image(index);
+                    source.owner = std::shared_ptr<const void>(cache, source.data);
+                    return source;
+                };
+            }
+            prepared.cache = std::move(cache);
+            return true;
+        }
+
+        // 两条导入路径共用：打印优化/LOD/meshlet统计
+        void printConvertStats(const std::vector<MeshData> &meshData, const std::vector<MeshOptimizeStats> &optimizeStats) const
+        {
+            if (options.optimizeMeshes)
+            {
+                for (std::size_t i = 0; i < optimizeStats.size(); i++)
+                {
+                    const auto &stats = optimizeStats[i];
+                    std::cout << "MeshOptimizer: mesh " << i << " (" << stats.triangleCount << " triangles) vertices " << stats.vertexCountBefore
+                              << " -> " << stats.vertexCountAfter << ", ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+                              << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+                }
             }
-            // retrieve the directory path of the filepath
-            directory = path.substr(0, path.find_last_of('/'));
 
-            // process ASSIMP's root node recursively
-            processNode(scene->mRootNode, scene, usePBR);
+            if (options.generateLods)
+            {
+                for (std::size_t i = 0; i < meshData.size(); i++)
+                {
+                    std::cout << "LOD: mesh " << i << " triangles";
+                    for (const auto &lod : meshData[i].lods)
+                        std::cout << ' ' << lod.indexCount / 3 << " (error " << lod.error << ")";
+                    std::cout << std::endl;
+                }
+            }
+            if (options.buildMeshlets)
+            {
+                std::size_t meshletCount = 0;
+                for (const auto &data : meshData)
+                    meshletCount += data.meshlets.size();
+                std::cout << "Meshlet: " << meshletCount << " clusters" << std::endl;
+            }
         }
 
-        // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-        void processNode(aiNode *node, const aiScene *scene, bool usePBR)
+        // 把count个源网格(aiMesh或glTF图元)转换成MeshData(并做网格优化)，每个网格一个任务，结果顺序和源网格一致
+        // 顶点数超过16位索引范围的网格可能被切成几个连续的MeshData，所以结果数量可以多于count
+        // produce(i)只做CPU端的转换，会在工作线程上执行；progress不为空时记录进度，取消后剩下的网格不再转换
+        template <typename Produce>
+        std::vector<MeshData> convertMeshes(std::size_t count, const Produce &produce, std::vector<MeshOptimizeStats> &optimizeStats, ModelLoadProgress *progress) const
         {
-            // process each mesh located at the current node
+            std::vector<std::vector<MeshData>> parts(count);
+            optimizeStats.assign(count, MeshOptimizeStats());
+            if (progress)
+                progress->meshCount = count;
+            auto convert = [this, &parts, &produce, &optimizeStats, progress](std::size_t i)
+            {
+                if (progress && progress->cancelled)
+                    return;
+                MeshData data;
+                {
+                    Renderer::ProfileScope scope("mesh.convert");
+                    data = produce(i);
+                }
+                if (options.optimizeMeshes)
+                {
+                    Renderer::ProfileScope scope("mesh.optimize");
+                    optimizeStats[i] = MeshOptimizer::Optimize(data);
+                }
+                // 在LOD和meshlet之前切分：切口是开放边界，简化时会被锁定，不会产生裂缝
+                if (options.shortIndices)
+                    parts[i] = MeshOptimizer::SplitForShortIndices(std::move(data));
+                else
+                    parts[i].push_back(std::move(data));
+                for (auto &part : parts[i])
+                {
+                    if (options.generateLods)
+                    {
+                        Renderer::ProfileScope scope("mesh.lod");
+                        MeshSimplifier::BuildLodChain(part, options.lod);
+                    }
+                    if (options.buildMeshlets)
+                    {
+                        Renderer::ProfileScope scope("mesh.meshlets");
+                        MeshletBuilder::Build(part);
+                    }
+                }
+                if (progress)
+                    progress->convertedMeshes++;
+            };
+            if (!options.parallelConversion || count < 2)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                    convert(i);
+            }
+            else
+            {
+                std::vector<std::future<void>> tasks;
+                tasks.reserve(count);
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    tasks.push_back(Renderer::ThreadPool::GetInstance().Submit([&convert, i]
+                                                                              { convert(i); }));
+                }
+                for (auto &task : tasks)
+                    task.get();
+            }
+
+            std::vector<MeshData> meshData;
+            meshData.reserve(count);
+            for (auto &meshParts : parts)
+                for (auto &part : meshParts)
+                    meshData.push_back(std::move(part));
+            // 上传进度按切分后的网格数计算
+            if (progress && !progress->cancelled)
+            {
+                progress->meshCount = meshData.size();
+                progress->convertedMeshes = meshData.size();
+            }
+            return meshData;
+        }
+
+        // 最粗一级LOD用到的顶点位置和三角形，顶点按首次引用的顺序重新编号
+        static std::shared_ptr<const MeshCollision> makeCollision(const CachedMeshView &view)
+        {
+            auto collision = std::make_unique<MeshCollision>();
+            MeshLod range = view.lods.empty() ? MeshLod{0, static_cast<std::uint32_t>(view.indexCount), 0.0f} : view.lods.back();
+            std::vector<unsigned int> indices(range.indexCount);
+            const std::size_t indexSize = IndexSize(view.indexType);
+            WidenIndices(static_cast<const std::uint8_t *>(view.indices) + std::size_t(range.indexOffset) * indexSize, view.indexType, range.indexCount, indices.data());
+            const std::size_t stride = VertexStride(view.format);
+            const auto *bytes = static_cast<const std::uint8_t *>(view.vertices);
+            constexpr unsigned int kUnused = ~0u;
+            std::vector<unsigned int> remap(view.vertexCount, kUnused);
+            collision->indices.reserve(indices.size());
+            for (std::size_t i = 0; i + 3 <= indices.size(); i += 3)
+            {
+                if (indices[i] >= view.vertexCount || indices[i + 1] >= view.vertexCount || indices[i + 2] >= view.vertexCount)
+                    continue;
+                for (std::size_t k = 0; k < 3; k++)
+                {
+                    unsigned int index = indices[i + k];
+                    if (remap[index] == kUnused)
+                    {
+                        remap[index] = static_cast<unsigned int>(collision->positions.size());
+                        glm::vec3 position;
+                        std::memcpy(&position, bytes + index * stride, sizeof(position));
+                        collision->positions.push_back(position);
+                    }
+                    collision->indices.push_back(remap[index]);
+                }
+            }
+            // 碰撞几何一直留在内存里，登记到HostGeometry，最后一个引用释放时注销
+            const std::uint64_t hostBytes = collision->positions.capacity() * sizeof(glm::vec3) + collision->indices.capacity() * sizeof(unsigned int);
+            Renderer::ResourceTracker::GetInstance().TrackHost(collision.get(), Renderer::ResourceCategory::HostGeometry, "Mesh.collision", hostBytes);
+            return std::shared_ptr<const MeshCollision>(collision.release(), [](const MeshCollision *pointer)
+                                                        {
+                                                            Renderer::ResourceTracker::GetInstance().ReleaseHost(pointer);
+                                                            delete pointer; });
+        }
+
+        // 从顶点数据中读出位置求包围盒，两种顶点格式的位置都在偏移0
+        static std::pair<glm::vec3, glm::vec3> computeBounds(const CachedMeshView &view)
+        {
+            if (view.vertexCount == 0)
+                return {glm::vec3(0.0f), glm::vec3(0.0f)};
+            const std::size_t stride = VertexStride(view.format);
+            const auto *bytes = static_cast<const std::uint8_t *>(view.vertices);
+            glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+            for (std::size_t i = 0; i < view.vertexCount; i++)
+            {
+                glm::vec3 position;
+                std::memcpy(&position, bytes + i * stride, sizeof(position));
+                boundsMin = glm::min(boundsMin, position);
+                boundsMax = glm::max(boundsMax, position);
+            }
+            return {boundsMin, boundsMax};
+        }
+
+        // 包围盒代理：每个面4个顶点，法线朝外，逆时针
+        static MeshData makeBoxData(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+        {
+            MeshData data;
+            data.format = VertexFormat::Compact;
+            const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+            const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (float sign : {1.0f, -1.0f})
+                {
+                    glm::vec3 normal(0.0f), u(0.0f), v(0.0f);
+                    normal[axis] = sign;
+                    u[(axis + 1) % 3] = 1.0f;
+                    v[(axis + 2) % 3] = 1.0f;
+                    // 保证cross(u, v) == normal
+                    if (sign < 0.0f)
+                        std::swap(u, v);
+                    const auto base = static_cast<unsigned int>(data.compactVertices.size());
+                    const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+                    for (const auto &corner : corners)
+                    {
+                        Vertex vertex{};
+                        vertex.Position = center + (normal + u * corner[0] + v * corner[1]) * extent;
+                        vertex.Normal = normal;
+                        vertex.TexCoords = glm::vec2(corner[0] * 0.5f + 0.5f, corner[1] * 0.5f + 0.5f);
+                        vertex.Tangent = u;
+                        vertex.Bitangent = v;
+                        data.compactVertices.push_back(PackVertex(vertex));
+                    }
+                    data.indices.insert(data.indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+                }
+            }
+            return data;
+        }
+
+        // 代理只用材质的常量参数，用贴图的属性换成中性的灰色非金属
+        std::shared_ptr<Mesh> makeProxy(const std::pair<glm::vec3, glm::vec3> &bounds, PBRMaterial material) const
+        {
+            if (material.useAlbedoMap)
+                material.albedo = glm::vec3(0.5f);
+            if (material.useMetallicMap)
+                material.metallic = 0.0f;
+            if (material.useRoughnessMap)
+                material.roughness = 1.0f;
+            material.useAlbedoMap = material.useNormalMap = material.useMetallicMap = GL_FALSE;
+            material.useRoughnessMap = material.useAOMap = material.useEmissiveMap = GL_FALSE;
+            MeshData box = makeBoxData(bounds.first, bounds.second);
+            return std::make_shared<Mesh>(box.VertexData(), box.format, box.VertexCount(), box.indices.data(), IndexType::UInt32, box.indices.size(), std::vector<MeshTexture>(), usePBR, material);
+        }
+
+        // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+        // 节点按深度优先先序加入nodes(父节点在前)，局部变换保留下来，meshNodes记录每个网格所在的节点
+        void processNode(aiNode *node, const aiScene *scene, std::vector<aiMesh *> &sceneMeshes, std::vector<std::uint32_t> &meshNodes,
+                         std::vector<SceneNode> &nodes, std::int32_t parent) const
+        {
+            auto index = static_cast<std::uint32_t>(nodes.size());
+            SceneNode &sceneNode = nodes.emplace_back();
+            sceneNode.parent = parent;
+            // aiMatrix4x4是行主序
+            for (int row = 0; row < 4; row++)
+                for (int column = 0; column < 4; column++)
+                    sceneNode.local[column][row] = node->mTransformation[row][column];
+            // collect each mesh located at the current node
             for (unsigned int i = 0; i < node->mNumMeshes; i++)
             {
                 // the node object only contains indices to index the actual objects in the scene.
                 // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-                aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-                meshes.push_back(processMesh(mesh, scene, usePBR));
+                sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+                meshNodes.push_back(index);
             }
             // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
             for (unsigned int i = 0; i < node->mNumChildren; i++)
             {
-                processNode(node->mChildren[i], scene, usePBR);
+                processNode(node->mChildren[i], scene, sceneMeshes, meshNodes, nodes, static_cast<std::int32_t>(index));
             }
         }
 
-        std::shared_ptr<Mesh> processMesh(aiMesh *mesh, const aiScene *scene, bool usePBR)
+        // 只做CPU端的转换，会在工作线程上执行，不能调用GL
+        MeshData processMesh(const aiMesh *mesh, const aiScene *scene, bool usePBR) const
         {
             // data to fill
-            std::vector<Vertex> vertices;
-            std::vector<unsigned int> indices;
-            std::vector<std::shared_ptr<Renderer::Texture>> textures;
+            MeshData data;
+            std::vector<Vertex> &vertices = data.vertices;
+            std::vector<unsigned int> &indices = data.indices;
+            std::vector<TextureRef> &textures = data.textures;
+            // 预先分配好顶点和索引的空间
+            vertices.resize(mesh->mNumVertices);
+            indices.reserve(static_cast<std::size_t>(mesh->mNumFaces) * 3);
 
             // walk through each of the mesh's vertices
             for (unsigned int i = 0; i < mesh->mNumVertices; i++)
             {
-                Vertex vertex;
+                Vertex &vertex = vertices[i];
                 glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
                 // positions
                 vector.x = mesh->mVertices[i].x;
@@ -144,13 +830,19 @@ namespace ModelLoader
                 }
                 else
                     vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-                vertices.push_back(vertex);
+            }
+            // 没有骨骼的静态网格转换成压缩顶点格式(shader不读骨骼数据，也不需要完整精度的法线/切线)
+            if (!mesh->HasBones())
+            {
+                data.format = VertexFormat::Compact;
+                data.compactVertices.resize(vertices.size());
+                std::transform(vertices.begin(), vertices.end(), data.compactVertices.begin(), PackVertex);
+                std::vector<Vertex>().swap(vertices);
             }
             // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
             for (unsigned int i = 0; i < mesh->mNumFaces; i++)
             {
-                aiFace face = mesh->mFaces[i];
+                const aiFace &face = mesh->mFaces[i];
                 // retrieve all indices of the face and store them in the indices vector
                 for (unsigned int j = 0; j < face.mNumIndices; j++)
                     indices.push_back(face.mIndices[j]);
@@ -169,30 +861,22 @@ namespace ModelLoader
                 // normal: texture_normalN
 
                 // 1. diffuse maps
-                std::vector<std::shared_ptr<Renderer::Texture>> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "material.texture_diffuse");
-                textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+                collectMaterialTextures(scene, material, aiTextureType_DIFFUSE, "material.texture_diffuse", textures);
                 // 2. specular maps
-                std::vector<std::shared_ptr<Renderer::Texture>> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "material.texture_specular");
-                textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+                collectMaterialTextures(scene, material, aiTextureType_SPECULAR, "material.texture_specular", textures);
                 // 3. normal maps
-                std::vector<std::shared_ptr<Renderer::Texture>> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "material.texture_normal");
-                textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+                collectMaterialTextures(scene, material, aiTextureType_HEIGHT, "material.texture_normal", textures);
                 // 4. height maps
-                std::vector<std::shared_ptr<Renderer::Texture>> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "material.texture_height");
-                textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-                // return a mesh object created from the extracted mesh data
-                return std::make_shared<Mesh>(vertices, indices, textures, usePBR);
+                collectMaterialTextures(scene, material, aiTextureType_AMBIENT, "material.texture_height", textures);
             }
             else
             {
-                PBRMaterial pbrMat;
+                PBRMaterial &pbrMat = data.material;
                 // 这里有个麻烦就是如果是gltf材质的话，金属度和粗糙度贴图是合并在一张贴图的，所以实际上读取的时候是读取的金属度贴图，然后把金属度贴图的b通道作为金属度，g通道作为粗糙度(所以pbr.frag里面的metallic和roughness是用的同一张贴图，但是分别用的不同通道)，算是特殊处理
                 //  1. albedo
                 if (material->GetTextureCount(aiTextureType_BASE_COLOR) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> albedoMaps = loadMaterialTextures(material, aiTextureType_BASE_COLOR, "material.albedoMap", true);
-                    textures.insert(textures.end(), albedoMaps.begin(), albedoMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType_BASE_COLOR, "material.albedoMap", textures, true);
                     pbrMat.useAlbedoMap = GL_TRUE;
                 }
                 else
@@ -206,8 +890,7 @@ namespace ModelLoader
                 // 2. normal maps
                 if (material->GetTextureCount(aiTextureType_NORMALS) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> normalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, "material.normalMap");
-                    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType_NORMALS, "material.normalMap", textures);
                     pbrMat.useNormalMap = GL_TRUE;
                 }
                 else
@@ -217,8 +900,7 @@ namespace ModelLoader
                 // 3. metallic maps
                 if (material->GetTextureCount(aiTextureType_METALNESS) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> metallicMaps = loadMaterialTextures(material, aiTextureType_METALNESS, "material.metallicMap");
-                    textures.insert(textures.end(), metallicMaps.begin(), metallicMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType_METALNESS, "material.metallicMap", textures);
                     pbrMat.useMetallicMap = GL_TRUE;
                 }
                 else
@@ -229,8 +911,7 @@ namespace ModelLoader
                 // 4. roughness maps
                 if (material->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> roughnessMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE_ROUGHNESS, "material.roughnessMap");
-                    textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType_DIFFUSE_ROUGHNESS, "material.roughnessMap", textures);
                     pbrMat.useRoughnessMap = GL_TRUE;
                 }
                 else
@@ -241,8 +922,7 @@ namespace ModelLoader
                 // 5. ao maps
                 if (material->GetTextureCount(aiTextureType::aiTextureType_AMBIENT_OCCLUSION) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> aoMaps = loadMaterialTextures(material, aiTextureType::aiTextureType_AMBIENT_OCCLUSION, "material.aoMap");
-                    textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType::aiTextureType_AMBIENT_OCCLUSION, "material.aoMap", textures);
                     pbrMat.useAOMap = GL_TRUE;
                 }
                 else
@@ -252,52 +932,128 @@ namespace ModelLoader
                 // 6. emissive maps
                 if (material->GetTextureCount(aiTextureType_EMISSIVE) > 0)
                 {
-                    std::vector<std::shared_ptr<Renderer::Texture>> emissiveMaps = loadMaterialTextures(material, aiTextureType_EMISSIVE, "material.emissiveMap");
-                    textures.insert(textures.end(), emissiveMaps.begin(), emissiveMaps.end());
+                    collectMaterialTextures(scene, material, aiTextureType_EMISSIVE, "material.emissiveMap", textures, true);
                     pbrMat.useEmissiveMap = GL_TRUE;
                 }
                 else
                 {
                     pbrMat.useEmissiveMap = GL_FALSE;
                 }
-
-                // return a mesh object created from the extracted mesh data
-                return std::make_shared<Mesh>(vertices, indices, textures, usePBR, pbrMat);
             }
+            // return the extracted mesh data
+            return data;
         }
 
-        // checks all material textures of a given type and loads the textures if they're not loaded yet.
-        // the required info is returned as a Texture struct.
-        std::vector<std::shared_ptr<Renderer::Texture>> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName, bool gammaCorrection = false)
+        // 记录材质中某一类型的所有纹理，真正的加载放到loadTextures里(网格缓存中保存的也是这些记录)
+        // 内嵌纹理(包括FBX里按文件名引用的内嵌纹理)统一记成"*下标"
+        void collectMaterialTextures(const aiScene *scene, aiMaterial *mat, aiTextureType type, const std::string &typeName, std::vector<TextureRef> &textures, bool gammaCorrection = false) const
         {
-            std::vector<std::shared_ptr<Renderer::Texture>> textures;
-
             for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
             {
                 aiString str;
                 mat->GetTexture(type, i, &str);
+                std::string path = str.C_Str();
+                auto [embedded, index] = scene->GetEmbeddedTextureAndIndex(str.C_Str());
+                if (embedded && index >= 0)
+                    path = '*' + std::to_string(index);
+                textures.push_back({typeName, path, gammaCorrection});
+            }
+        }
 
-                bool skip = false;
-                std::string filepath = directory + '/' + str.C_Str();
-                // 先遍历textures_loaded，看看是否已经加载过了
-                for (auto &texture : textures_loaded)
+        // Assimp的内嵌纹理：mHeight为0时是压缩的文件内容，否则是BGRA像素
+        // importer在加载结束后会释放场景，所以这里复制一份，由ImageSource持有
+        static Renderer::ImageSource embeddedImage(const aiScene *scene, std::size_t index)
+        {
+            Renderer::ImageSource source;
+            if (index >= scene->mNumTextures)
+                return source;
+            const aiTexture *texture = scene->mTextures[index];
+            auto bytes = std::make_shared<std::vector<std::uint8_t>>();
+            if (texture->mHeight == 0)
+            {
+                const auto *data = reinterpret_cast<const std::uint8_t *>(texture->pcData);
+                bytes->assign(data, data + texture->mWidth);
+            }
+            else
+            {
+                bytes->resize(static_cast<std::size_t>(texture->mWidth) * texture->mHeight * 4);
+                for (std::size_t i = 0; i < static_cast<std::size_t>(texture->mWidth) * texture->mHeight; i++)
                 {
-                    // 如果已经加载过了，那么直接把这个纹理加入到textures中
-                    if (std::strcmp(texture->path.c_str(), filepath.c_str()) == 0 && texture->type == typeName)
-                    {
-                        textures.push_back(texture);
-                        skip = true;
-                        break;
-                    }
+                    const aiTexel &texel = texture->pcData[i];
+                    std::uint8_t *rgba = bytes->data() + i * 4;
+                    rgba[0] = texel.r;
+                    rgba[1] = texel.g;
+                    rgba[2] = texel.b;
+                    rgba[3] = texel.a;
                 }
-                // 如果纹理还没有被加载过，那么加载它
-                if (!skip)
+                source.width = static_cast<int>(texture->mWidth);
+                source.height = static_cast<int>(texture->mHeight);
+            }
+            source.data = bytes->data();
+            source.size = bytes->size();
+            source.owner = bytes;
+            return source;
+        }
+
+        // 写缓存时取出网格引用到的内嵌图片，下标和纹理路径"*N"一致
+        static std::vector<Renderer::ImageSource> collectEmbeddedImages(const PreparedModel &prepared)
+        {
+            std::vector<Renderer::ImageSource> images;
+            if (!prepared.embeddedImages)
+                return images;
+            for (const auto &data : prepared.meshData)
+            {
+                for (const auto &ref : data.textures)
                 {
-                    auto &tex = textures.emplace_back(std::make_shared<Renderer::Texture>(str.C_Str(), this->directory, gammaCorrection));
-                    tex->SetTextureType(typeName);
-                    textures_loaded.push_back(tex);
+                    if (ref.path.empty() || ref.path[0] != '*')
+                        continue;
+                    std::size_t index = std::strtoul(ref.path.c_str() + 1, nullptr, 10);
+                    if (index >= images.size())
+                        images.resize(index + 1);
+                    if (images[index].Empty())
+                        images[index] = prepared.embeddedImages(index);
                 }
             }
+            return images;
+        }
+
+        // 颜色贴图用sRGB BC7，PBR法线贴图用BC5(pbr.fs/g_buffer.fs从xy重建z)，其余线性数据(ORM等)用BC7
+        // 非PBR的texture_normal仍然在shader里直接读xyz，所以不压成BC5
+        Renderer::TextureCodec chooseCodec(const TextureRef &ref) const
+        {
+            if (!options.compressTextures)
+                return Renderer::TextureCodec::None;
+            if (ref.type == "material.normalMap")
+                return Renderer::TextureCodec::BC5;
+            return ref.gammaCorrection ? Renderer::TextureCodec::BC7_sRGB : Renderer::TextureCodec::BC7;
+        }
+
+        // loads the textures referenced by a mesh through the process-wide TextureCache,
+        // so textures shared between meshes and between Models are only decoded and uploaded once.
+        std::vector<MeshTexture> loadTextures(const std::vector<TextureRef> &refs, const PreparedModel &prepared)
+        {
+            std::vector<MeshTexture> textures;
+            textures.reserve(refs.size());
+            auto &cache = Renderer::TextureCache::GetInstance();
+            for (const auto &ref : refs)
+            {
+                auto colorSpace = ref.gammaCorrection ? Renderer::ColorSpace::sRGB : Renderer::ColorSpace::Linear;
+                std::shared_ptr<Renderer::Texture> texture;
+                if (!ref.path.empty() && ref.path[0] == '*')
+                {
+                    // 内嵌纹理直接从模型的内存中解码，走同样的异步解码/上传路径
+                    std::size_t index = std::strtoul(ref.path.c_str() + 1, nullptr, 10);
+                    Renderer::ImageSource source = prepared.embeddedImages ? prepared.embeddedImages(index) : Renderer::ImageSource();
+                    source.name = m_path + "#image" + std::to_string(index);
+                    texture = cache.Acquire(source, colorSpace, options.asyncTextures, chooseCodec(ref));
+                }
+                else
+                    texture = cache.Acquire(ref.path, this->directory, colorSpace, options.asyncTextures, chooseCodec(ref));
+                // textures_loaded保存本模型持有的纹理(每个只存一份)，模型析构时释放引用
+                if (std::find(textures_loaded.begin(), textures_loaded.end(), texture) == textures_loaded.end())
+                    textures_loaded.push_back(texture);
+                textures.push_back({ref.type, std::move(texture)});
+            }
             return textures;
         }
     };
@@ -0,0 +1,478 @@
+#pragma once
+// 模型的二进制网格缓存(*.meshcache)
+// 缓存里保存的是processMesh之后最终的Vertex/index数组以及PBRMaterial，命中缓存时直接把映射内存交给GL上传，不再调用Assimp
+// 模型的内嵌图片(glb的images、Assimp的mTextures)也原样存进缓存，命中时不需要再打开源文件
+// 缓存以源文件内容的哈希和导入标志为键，任意一项不匹配(或版本号变化)都视为未命中并重新生成
+// 头里同时记录源文件(以及gltf的外部缓冲)的大小和修改时间，没有变化时不再读取和哈希源文件
+#include "GltfLoader.h"
+#include "ImageSource.h"
+#include "Mesh.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ModelLoader
+{
+    static_assert(std::is_trivially_copyable_v<Vertex>, "Vertex must be trivially copyable to be cached");
+    static_assert(std::is_trivially_copyable_v<CompactVertex>, "CompactVertex must be trivially copyable to be cached");
+    static_assert(std::is_trivially_copyable_v<PBRMaterial>, "PBRMaterial must be trivially copyable to be cached");
+    static_assert(std::is_trivially_copyable_v<Meshlet>, "Meshlet must be trivially copyable to be cached");
+    static_assert(std::is_trivially_copyable_v<SceneNode>, "SceneNode must be trivially copyable to be cached");
+
+    // 修改Vertex/PBRMaterial布局或者文件格式时要增加版本号，使旧缓存失效
+    constexpr std::uint32_t kModelCacheMagic = 0x434D4250; // "PBMC"
+    constexpr std::uint32_t kModelCacheVersion = 9;
+    constexpr std::uint64_t kModelCacheAlignment = 16;
+
+    struct ModelCacheHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint64_t sourceStamp;
+        std::uint32_t importFlags;
+        std::uint32_t vertexStride;
+        std::uint32_t compactVertexStride;
+        std::uint32_t materialSize;
+        std::uint32_t meshCount;
+        std::uint32_t textureCount;
+        std::uint32_t stringTableSize;
+        std::uint32_t meshletCount;
+        std::uint32_t nodeCount;
+        std::uint32_t imageCount;
+        std::uint64_t meshTableOffset;
+        std::uint64_t textureTableOffset;
+        std::uint64_t stringTableOffset;
+        std::uint64_t meshletTableOffset;
+        std::uint64_t nodeTableOffset;
+        std::uint64_t imageTableOffset;
+    };
+
+    struct ModelCacheMeshRecord
+    {
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t firstTexture;
+        std::uint32_t textureCount;
+        std::uint32_t vertexFormat;
+        std::uint32_t lodCount;
+        std::uint32_t firstMeshlet;
+        std::uint32_t meshletCount;
+        // 索引按网格的顶点数选择宽度保存(IndexType)，上传时不需要再转换
+        std::uint32_t indexType;
+        std::uint32_t node;
+        MeshLod lods[kMaxMeshLods];
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        PBRMaterial material;
+    };
+
+    struct ModelCacheTextureRecord
+    {
+        std::uint32_t typeOffset;
+        std::uint32_t typeLength;
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+        std::uint32_t gammaCorrection;
+    };
+
+    // 内嵌图片：size为0表示没有被网格引用；width > 0时是未压缩的RGBA8像素(同ImageSource)
+    struct ModelCacheImageRecord
+    {
+        std::uint64_t dataOffset;
+        std::uint64_t size;
+        std::uint32_t width;
+        std::uint32_t height;
+    };
+
+    // 缓存中一个网格的只读视图，指针直接指向映射内存，在ModelCache关闭之前有效
+    struct CachedMeshView
+    {
+        const void *vertices;
+        VertexFormat format;
+        std::size_t vertexCount;
+        const void *indices;
+        IndexType indexType;
+        std::size_t indexCount;
+        PBRMaterial material;
+        std::vector<TextureRef> textures;
+        std::vector<MeshLod> lods;
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        std::vector<Meshlet> meshlets;
+        std::uint32_t node;
+    };
+
+    // 缓存对应的源文件：模型文件和gltf引用的外部缓冲
+    // stamp只由各文件的大小和修改时间得到(只需要stat)，内容哈希只在stamp对不上或者写缓存时才计算
+    struct ModelCacheSource
+    {
+        std::vector<std::string> files;
+        // 0表示有文件不存在
+        std::uint64_t stamp = 0;
+        // 调用方混入两个键的参数(比如LOD参数)
+        std::uint64_t salt = 0;
+
+        std::uint64_t Hash() const
+        {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (const auto &file : files)
+            {
+                MappedFile mapped(file);
+                if (!mapped.IsOpen())
+                    return 0;
+                hash = HashBytes(mapped.Data(), mapped.Size(), hash);
+            }
+            return HashBytes(&salt, sizeof(salt), hash);
+        }
+    };
+
+    class ModelCache
+    {
+    public:
+        static std::string CachePathFor(const std::string &sourcePath)
+        {
+            return sourcePath + ".meshcache";
+        }
+
+        // 收集源文件并计算stamp，gltf/glb还要包括加载时映射的外部缓冲，否则只改了缓冲文件的模型会命中旧缓存
+        static ModelCacheSource DescribeSource(const std::string &sourcePath, std::uint64_t salt = 0)
+        {
+            ModelCacheSource source;
+            source.salt = salt;
+            source.files.push_back(sourcePath);
+            if (GltfLoader::IsGltf(sourcePath))
+            {
+                auto buffers = GltfLoader::ExternalBufferPaths(sourcePath);
+                source.files.insert(source.files.end(), buffers.begin(), buffers.end());
+            }
+            std::uint64_t stamp = 14695981039346656037ull;
+            for (const auto &file : source.files)
+            {
+                std::error_code ec;
+                std::uint64_t size = std::filesystem::file_size(file, ec);
+                if (ec)
+                    return source;
+                auto time = std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+                if (ec)
+                    return source;
+                stamp = HashBytes(file.data(), file.size(), stamp);
+                stamp = HashBytes(&size, sizeof(size), stamp);
+                stamp = HashBytes(&time, sizeof(time), stamp);
+            }
+            source.stamp = HashBytes(&salt, sizeof(salt), stamp);
+            return source;
+        }
+
+        // 打开并校验缓存文件，源文件、导入标志或版本不一致时返回false
+        // stamp一致时直接认为源文件没有变化；不一致时(比如只是touch过)再比较内容哈希
+        bool Open(const std::string &cachePath, const ModelCacheSource &source, std::uint32_t importFlags)
+        {
+            if (!m_file.Open(cachePath))
+                return false;
+            if (m_file.Size() < sizeof(ModelCacheHeader))
+                return Reject();
+            std::memcpy(&m_header, m_file.Data(), sizeof(ModelCacheHeader));
+            if (m_header.magic != kModelCacheMagic || m_header.version != kModelCacheVersion ||
+                m_header.importFlags != importFlags ||
+                m_header.vertexStride != sizeof(Vertex) || m_header.compactVertexStride != sizeof(CompactVertex) ||
+                m_header.materialSize != sizeof(PBRMaterial))
+                return Reject();
+            if (source.stamp == 0 || (m_header.sourceStamp != source.stamp && m_header.sourceHash != source.Hash()))
+                return Reject();
+            if (!InRange(m_header.meshTableOffset, std::uint64_t(m_header.meshCount) * sizeof(ModelCacheMeshRecord)) ||
+                !InRange(m_header.textureTableOffset, std::uint64_t(m_header.textureCount) * sizeof(ModelCacheTextureRecord)) ||
+                !InRange(m_header.stringTableOffset, m_header.stringTableSize) ||
+                !InRange(m_header.meshletTableOffset, std::uint64_t(m_header.meshletCount) * sizeof(Meshlet)) ||
+                !InRange(m_header.nodeTableOffset, std::uint64_t(m_header.nodeCount) * sizeof(SceneNode)) || m_header.nodeCount == 0 ||
+                !InRange(m_header.imageTableOffset, std::uint64_t(m_header.imageCount) * sizeof(ModelCacheImageRecord)))
+                return Reject();
+            for (std::uint32_t i = 0; i < m_header.imageCount; i++)
+            {
+                if (!InRange(ImageTable()[i].dataOffset, ImageTable()[i].size))
+                    return Reject();
+            }
+            for (std::uint32_t i = 0; i < m_header.nodeCount; i++)
+            {
+                if (NodeTable()[i].parent >= static_cast<std::int32_t>(i))
+                    return Reject();
+            }
+            for (std::uint32_t i = 0; i < m_header.meshCount; i++)
+            {
+                const auto &record = MeshRecord(i);
+                if (record.vertexFormat > static_cast<std::uint32_t>(VertexFormat::Compact) ||
+                    record.indexType > static_cast<std::uint32_t>(IndexType::UInt16) ||
+                    (record.indexType == static_cast<std::uint32_t>(IndexType::UInt16) && record.vertexCount > kMaxShortIndexVertices) ||
+                    !InRange(record.vertexOffset, std::uint64_t(record.vertexCount) * VertexStride(static_cast<VertexFormat>(record.vertexFormat))) ||
+                    !InRange(record.indexOffset, std::uint64_t(record.indexCount) * IndexSize(static_cast<IndexType>(record.indexType))) ||
+                    std::uint64_t(record.firstTexture) + record.textureCount > m_header.textureCount ||
+                    record.lodCount == 0 || record.lodCount > kMaxMeshLods || record.node >= m_header.nodeCount ||
+                    std::uint64_t(record.firstMeshlet) + record.meshletCount > m_header.meshletCount)
+                    return Reject();
+                for (std::uint32_t lod = 0; lod < record.lodCount; lod++)
+                {
+                    if (std::uint64_t(record.lods[lod].indexOffset) + record.lods[lod].indexCount > record.indexCount)
+                        return Reject();
+                }
+                // meshlet只能引用LOD0的索引范围
+                for (std::uint32_t m = 0; m < record.meshletCount; m++)
+                {
+                    const auto &meshlet = MeshletTable()[record.firstMeshlet + m];
+                    if (std::uint64_t(meshlet.indexOffset) + std::uint64_t(meshlet.triangleCount) * 3 > record.lods[0].indexOffset + record.lods[0].indexCount)
+                        return Reject();
+                }
+            }
+            return true;
+        }
+        void Close() { m_file.Close(); }
+
+        std::size_t MeshCount() const noexcept { return m_file.IsOpen() ? m_header.meshCount : 0; }
+        std::vector<SceneNode> Nodes() const
+        {
+            if (!m_file.IsOpen())
+                return {};
+            return std::vector<SceneNode>(NodeTable(), NodeTable() + m_header.nodeCount);
+        }
+        std::size_t ImageCount() const noexcept { return m_file.IsOpen() ? m_header.imageCount : 0; }
+        // 第index张内嵌图片，data直接指向映射内存(owner为空)，由调用方保证ModelCache在使用期间不被关闭
+        Renderer::ImageSource Image(std::size_t index) const
+        {
+            Renderer::ImageSource source;
+            if (index >= ImageCount() || ImageTable()[index].size == 0)
+                return source;
+            const auto &record = ImageTable()[index];
+            source.data = m_file.Data() + record.dataOffset;
+            source.size = static_cast<std::size_t>(record.size);
+            source.width = static_cast<int>(record.width);
+            source.height = static_cast<int>(record.height);
+            return source;
+        }
+        CachedMeshView GetMesh(std::size_t index) const
+        {
+            const auto &record = MeshRecord(index);
+            CachedMeshView view{};
+            view.vertices = m_file.Data() + record.vertexOffset;
+            view.format = static_cast<VertexFormat>(record.vertexFormat);
+            view.vertexCount = record.vertexCount;
+            view.indices = m_file.Data() + record.indexOffset;
+            view.indexType = static_cast<IndexType>(record.indexType);
+            view.indexCount = record.indexCount;
+            view.material = record.material;
+            view.lods.assign(record.lods, record.lods + record.lodCount);
+            view.boundsCenter = record.boundsCenter;
+            view.boundsRadius = record.boundsRadius;
+            view.meshlets.assign(MeshletTable() + record.firstMeshlet, MeshletTable() + record.firstMeshlet + record.meshletCount);
+            view.node = record.node;
+            for (std::uint32_t i = 0; i < record.textureCount; i++)
+            {
+                const auto *texture = reinterpret_cast<const ModelCacheTextureRecord *>(m_file.Data() + m_header.textureTableOffset) + record.firstTexture + i;
+                view.textures.push_back({String(texture->typeOffset, texture->typeLength), String(texture->pathOffset, texture->pathLength), texture->gammaCorrection != 0});
+            }
+            return view;
+        }
+
+        // 写入缓存，先写临时文件再重命名，避免进程中途退出留下半个缓存文件
+        // images[i]是纹理路径"*i"对应的内嵌图片，没有被引用的可以为空
+        static bool Write(const std::string &cachePath, const ModelCacheSource &source, std::uint32_t importFlags, const std::vector<MeshData> &meshes, const std::vector<SceneNode> &nodes,
+                          const std::vector<Renderer::ImageSource> &images = {})
+        {
+            std::vector<ModelCacheMeshRecord> meshRecords(meshes.size());
+            std::vector<ModelCacheTextureRecord> textureRecords;
+            std::vector<Meshlet> meshlets;
+            std::string strings;
+            auto addString = [&strings](const std::string &str)
+            {
+                auto offset = static_cast<std::uint32_t>(strings.size());
+                strings += str;
+                return offset;
+            };
+
+            ModelCacheHeader header{};
+            header.magic = kModelCacheMagic;
+            header.version = kModelCacheVersion;
+            header.sourceHash = source.Hash();
+            header.sourceStamp = source.stamp;
+            header.importFlags = importFlags;
+            header.vertexStride = sizeof(Vertex);
+            header.compactVertexStride = sizeof(CompactVertex);
+            header.materialSize = sizeof(PBRMaterial);
+            header.meshCount = static_cast<std::uint32_t>(meshes.size());
+
+            // 先排好各段的偏移：header | mesh表 | texture表 | 字符串表 | meshlet表 | 节点表 | 图片表 | 各网格的顶点和索引 | 各图片的数据
+            std::uint64_t offset = Align(sizeof(ModelCacheHeader));
+            header.meshTableOffset = offset;
+            offset = Align(offset + meshes.size() * sizeof(ModelCacheMeshRecord));
+            for (std::size_t i = 0; i < meshes.size(); i++)
+            {
+                auto &record = meshRecords[i];
+                record.firstTexture = static_cast<std::uint32_t>(textureRecords.size());
+                record.textureCount = static_cast<std::uint32_t>(meshes[i].textures.size());
+                record.vertexCount = static_cast<std::uint32_t>(meshes[i].VertexCount());
+                record.vertexFormat = static_cast<std::uint32_t>(meshes[i].format);
+                record.indexCount = static_cast<std::uint32_t>(meshes[i].indices.size());
+                record.indexType = static_cast<std::uint32_t>(ChooseIndexType(meshes[i].VertexCount()));
+                record.material = meshes[i].material;
+                record.lodCount = static_cast<std::uint32_t>(std::min(meshes[i].lods.size(), kMaxMeshLods));
+                std::copy_n(meshes[i].lods.begin(), record.lodCount, record.lods);
+                if (record.lodCount == 0)
+                {
+                    record.lodCount = 1;
+                    record.lods[0] = {0, record.indexCount, 0.0f};
+                }
+                record.boundsCenter = meshes[i].boundsCenter;
+                record.boundsRadius = meshes[i].boundsRadius;
+                record.node = meshes[i].node;
+                record.firstMeshlet = static_cast<std::uint32_t>(meshlets.size());
+                record.meshletCount = static_cast<std::uint32_t>(meshes[i].meshlets.size());
+                meshlets.insert(meshlets.end(), meshes[i].meshlets.begin(), meshes[i].meshlets.end());
+                for (const auto &texture : meshes[i].textures)
+                {
+                    ModelCacheTextureRecord textureRecord{};
+                    textureRecord.typeOffset = addString(texture.type);
+                    textureRecord.typeLength = static_cast<std::uint32_t>(texture.type.size());
+                    textureRecord.pathOffset = addString(texture.path);
+                    textureRecord.pathLength = static_cast<std::uint32_t>(texture.path.size());
+                    textureRecord.gammaCorrection = texture.gammaCorrection;
+                    textureRecords.push_back(textureRecord);
+                }
+            }
+            header.textureCount = static_cast<std::uint32_t>(textureRecords.size());
+            header.textureTableOffset = offset;
+            offset = Align(offset + textureRecords.size() * sizeof(ModelCacheTextureRecord));
+            header.stringTableSize = static_cast<std::uint32_t>(strings.size());
+            header.stringTableOffset = offset;
+            offset = Align(offset + strings.size());
+            header.meshletCount = static_cast<std::uint32_t>(meshlets.size());
+            header.meshletTableOffset = offset;
+            offset = Align(offset + meshlets.size() * sizeof(Meshlet));
+            header.nodeCount = static_cast<std::uint32_t>(nodes.size());
+            header.nodeTableOffset = offset;
+            offset = Align(offset + nodes.size() * sizeof(SceneNode));
+            header.imageCount = static_cast<std::uint32_t>(images.size());
+            header.imageTableOffset = offset;
+            offset = Align(offset + images.size() * sizeof(ModelCacheImageRecord));
+            for (std::size_t i = 0; i < meshes.size(); i++)
+            {
+                meshRecords[i].vertexOffset = offset;
+                offset = Align(offset + meshes[i].VertexCount() * VertexStride(meshes[i].format));
+                meshRecords[i].indexOffset = offset;
+                offset = Align(offset + meshes[i].indices.size() * IndexSize(static_cast<IndexType>(meshRecords[i].indexType)));
+            }
+            std::vector<ModelCacheImageRecord> imageRecords(images.size());
+            for (std::size_t i = 0; i < images.size(); i++)
+            {
+                auto &record = imageRecords[i];
+                record.dataOffset = offset;
+                record.size = images[i].Empty() ? 0 : images[i].size;
+                record.width = static_cast<std::uint32_t>(std::max(images[i].width, 0));
+                record.height = static_cast<std::uint32_t>(std::max(images[i].height, 0));
+                offset = Align(offset + record.size);
+            }
+
+            std::string tmpPath = cachePath + ".tmp";
+            {
+                std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+                if (!out)
+                {
+                    std::cout << "ModelCache: failed to write " << tmpPath << std::endl;
+                    return false;
+                }
+                auto writeAt = [&out](std::uint64_t at, const void *data, std::size_t size)
+                {
+                    static const char zeros[kModelCacheAlignment] = {};
+                    // 补齐到对齐位置
+                    while (static_cast<std::uint64_t>(out.tellp()) < at)
+                        out.write(zeros, std::min<std::uint64_t>(kModelCacheAlignment, at - static_cast<std::uint64_t>(out.tellp())));
+                    if (size > 0)
+                        out.write(static_cast<const char *>(data), size);
+                };
+                writeAt(0, &header, sizeof(header));
+                writeAt(header.meshTableOffset, meshRecords.data(), meshRecords.size() * sizeof(ModelCacheMeshRecord));
+                writeAt(header.textureTableOffset, textureRecords.data(), textureRecords.size() * sizeof(ModelCacheTextureRecord));
+                writeAt(header.stringTableOffset, strings.data(), strings.size());
+                writeAt(header.meshletTableOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+                writeAt(header.nodeTableOffset, nodes.data(), nodes.size() * sizeof(SceneNode));
+                writeAt(header.imageTableOffset, imageRecords.data(), imageRecords.size() * sizeof(ModelCacheImageRecord));
+                std::vector<std::uint16_t> shortIndices;
+                for (std::size_t i = 0; i < meshes.size(); i++)
+                {
+                    writeAt(meshRecords[i].vertexOffset, meshes[i].VertexData(), meshes[i].VertexCount() * VertexStride(meshes[i].format));
+                    if (meshRecords[i].indexType == static_cast<std::uint32_t>(IndexType::UInt16))
+                    {
+                        shortIndices.resize(meshes[i].indices.size());
+                        NarrowIndices(meshes[i].indices.data(), meshes[i].indices.size(), shortIndices.data());
+                        writeAt(meshRecords[i].indexOffset, shortIndices.data(), shortIndices.size() * sizeof(std::uint16_t));
+                    }
+                    else
+                        writeAt(meshRecords[i].indexOffset, meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+                }
+                for (std::size_t i = 0; i < images.size(); i++)
+                    writeAt(imageRecords[i].dataOffset, images[i].data, static_cast<std::size_t>(imageRecords[i].size));
+                if (!out)
+                {
+                    std::cout << "ModelCache: failed to write " << tmpPath << std::endl;
+                    return false;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmpPath, cachePath, ec);
+            if (ec)
+            {
+                std::cout << "ModelCache: failed to rename " << tmpPath << ": " << ec.message() << std::endl;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static std::uint64_t Align(std::uint64_t offset)
+        {
+            return (offset + kModelCacheAlignment - 1) & ~(kModelCacheAlignment - 1);
+        }
+        bool InRange(std::uint64_t offset, std::uint64_t size) const
+        {
+            return offset <= m_file.Size() && size <= m_file.Size() - offset;
+        }
+        bool Reject()
+        {
+            m_file.Close();
+            return false;
+        }
+        const ModelCacheMeshRecord &MeshRecord(std::size_t index) const
+        {
+            return reinterpret_cast<const ModelCacheMeshRecord *>(m_file.Data() + m_header.meshTableOffset)[index];
+        }
+        const Meshlet *MeshletTable() const
+        {
+            return reinterpret_cast<const Meshlet *>(m_file.Data() + m_header.meshletTableOffset);
+        }
+        const SceneNode *NodeTable() const
+        {
+            return reinterpret_cast<const SceneNode *>(m_file.Data() + m_header.nodeTableOffset);
+        }
+        const ModelCacheImageRecord *ImageTable() const
+        {
+            return reinterpret_cast<const ModelCacheImageRecord *>(m_file.Data() + m_header.imageTableOffset);
+        }
+        std::string String(std::uint32_t offset, std::uint32_t length) const
+        {
+            if (std::uint64_t(offset) + length > m_header.stringTableSize)
+                return {};
+            return std::string(reinterpret_cast<const char *>(m_file.Data() + m_header.stringTableOffset + offset), length);
+        }
+
+        MappedFile m_file;
+        ModelCacheHeader m_header{};
+    };
+}
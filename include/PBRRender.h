@@ -3,6 +3,9 @@
 #include "glad/glad.h"
 #include "RenderQueue.h"
 #include "GBuffer.h"
+#include "FrameDataBuffer.h"
+#include "RenderStats.h"
+#include "TextureStreamer.h"
 #include <pybind11/numpy.h>
 namespace Renderer
 {
@@ -19,12 +22,7 @@ namespace Renderer
         shader->setInt("material.aoMap", 7);
         shader->setVec3("albedo", 0.5f, 0.0f, 0.0f);
         shader->setFloat("ao", 1.0f);
-
-        auto resolution = window->GetFramebufferDims();
-        glm::mat4 projection = glm::perspective(glm::radians(cam->Zoom), (float)resolution.first / (float)resolution.second, 0.1f, 100.0f);
-        shader->setMat4("projection", projection);
         shader->unuse();
-        scene->SetSkybox(projection);
         scene->Bake(window->GetWindow());
     }
     // PBRRender类
@@ -58,10 +56,13 @@ namespace Renderer
             // 渲染指令
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            RenderStats::GetInstance().BeginFrame();
 
             m_camera->Update(deltaTime);
             m_window.Update();
             Input::GetInstance().Update();
+            // 上传解码完成的纹理
+            TextureStreamer::GetInstance().Update();
             // 交换缓冲
             m_window.SwapBuffers();
             // 检查是否有触发事件（键盘输入、鼠标移动等）
@@ -147,6 +148,15 @@ namespace Renderer
         auto *GetCurrentWindow() { return m_window.GetWindow(); }
 
     private:
+        void beginFrameData(float time)
+        {
+            auto resolution = m_window.GetFramebufferDims();
+            const float aspect = (float)resolution.first / (float)std::max(resolution.second, 1);
+            glm::mat4 projection = glm::perspective(glm::radians(m_camera->Zoom), aspect, m_nearPlane, m_farPlane);
+            FrameDataBuffer::GetInstance().BeginFrame(m_camera->GetViewMatrix(), projection, m_camera->Position, glm::vec2(resolution.first, resolution.second), time, deltaTime,
+                                                      m_nearPlane, m_farPlane);
+        }
+
         GLuint readPBO;
         WindowSystem m_window;
         Camera *m_camera;
@@ -154,6 +164,9 @@ namespace Renderer
         // timing
         float deltaTime = 0.0f; // time between current frame and last frame
         float lastFrame = 0.0f;
+        // 所有pass共用的投影参数
+        float m_nearPlane = 0.1f;
+        float m_farPlane = 1000.0f;
         // 初始化计数器和计时器
         int frameCount = 0;
         double timer = 0;
@@ -183,6 +196,8 @@ namespace Renderer
         else
         {
             std::cout << "glad init success" << std::endl;
+            // 材质贴图的绑定方式决定着色器的宏，必须在加载着色器之前选择
+            MaterialTextures::GetInstance().Initialize();
         }
         glViewport(0, 0, width, height);
 
@@ -246,9 +261,16 @@ namespace Renderer
             // 渲染指令
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            RenderStats::GetInstance().BeginFrame();
+            // 相机矩阵、相机位置、时间和分辨率每帧写一次FrameData，所有着色器从uniform块读取
+            beginFrameData(currentFrame);
+            // 换入异步加载的网格、上传解码完成的纹理，再渲染场景
+            m_scene->UpdateStreaming();
+            TextureStreamer::GetInstance().Update();
             // 渲染场景
             // m_scene->Update(pbrShader, *m_camera);
             m_renderQueue.Update(this->m_camera, &this->m_window, this->m_scene);
+            FrameDataBuffer::GetInstance().EndFrame();
             // 摄像机系统，窗口系统，输入控制系统更新
             m_camera->Update(deltaTime);
             m_window.Update();
@@ -263,8 +285,12 @@ namespace Renderer
             // 当达到一秒时，打印帧数并重置计数器和计时器
             if (glfwGetTime() - timer >= 1.0)
             {
+                const auto &stats = RenderStats::GetInstance().LastFrame();
                 std::cout << "\rfps: " << std::setw(6) << std::setprecision(2) << frameCount
-                          << "    currentFrame: " << std::setw(8) << std::setprecision(5) << std::fixed << currentFrame << std::flush;
+                          << "    currentFrame: " << std::setw(8) << std::setprecision(5) << std::fixed << currentFrame
+                          << "    draws: " << stats.drawCalls << " (" << stats.indirectCommands << " indirect)    triangles: " << stats.triangles << "/" << stats.fullDetailTriangles
+                          << "    clusters: " << stats.clustersVisible << "/" << stats.clustersTested
+                          << "    state changes: " << stats.TotalStateChanges() << " (" << stats.TotalStateChangesAvoided() << " avoided)" << std::flush;
                 frameCount = 0;
                 timer = glfwGetTime();
             }
@@ -0,0 +1,70 @@
+#pragma once
+// 进程内存统计：当前常驻内存(RSS / working set)以及整个进程生命周期内的峰值，用来对比不同加载路径的内存开销
+// 峰值是进程级的高水位，只会增长；要统计某一段时间内的峰值需要在这段时间里采样CurrentResidentBytes(见Profiler)
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#endif
+
+#include <cstdint>
+#include <cstdio>
+
+namespace Renderer
+{
+    inline std::uint64_t PeakResidentBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+        // Linux上ru_maxrss以KB为单位
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    // 当前的常驻内存，失败时返回0
+    inline std::uint64_t CurrentResidentBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+        mach_task_basic_info info{};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+            return 0;
+        return static_cast<std::uint64_t>(info.resident_size);
+#else
+        // /proc/self/statm的第二列是常驻页数
+        std::FILE *file = std::fopen("/proc/self/statm", "r");
+        if (!file)
+            return 0;
+        unsigned long long size = 0, resident = 0;
+        int fields = std::fscanf(file, "%llu %llu", &size, &resident);
+        std::fclose(file);
+        if (fields != 2)
+            return 0;
+        return static_cast<std::uint64_t>(resident) * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+}
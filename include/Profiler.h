@@ -0,0 +1,232 @@
+#pragma once
+// 加载流程的分阶段统计：每个阶段累计调用次数、耗时、调用线程的CPU时间，以及阶段进行期间的常驻内存峰值
+// 默认关闭，关闭时ProfileScope只读一次原子变量；loadBenchmark打开它，按阶段输出JSON/CSV
+// 打开时后台线程每毫秒采样一次当前常驻内存，更新所有正在进行的阶段的峰值(进程级的peak RSS只增不减，没法按阶段区分)
+// 并行阶段(网格转换、纹理解码)的耗时是各线程之和，可能超过整体加载时间
+#include <glad/glad.h>
+
+#include "ProcessMemory.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Renderer
+{
+    // 当前线程/整个进程已经消耗的CPU时间(用户态+内核态)
+    inline double ThreadCpuMs()
+    {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+            return 0.0;
+        auto ticks = [](const FILETIME &time)
+        { return (std::uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+        // FILETIME以100ns为单位
+        return double(ticks(kernel) + ticks(user)) / 1e4;
+#else
+        timespec time{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return double(time.tv_sec) * 1e3 + double(time.tv_nsec) / 1e6;
+#endif
+    }
+    inline double ProcessCpuMs()
+    {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+            return 0.0;
+        auto ticks = [](const FILETIME &time)
+        { return (std::uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+        return double(ticks(kernel) + ticks(user)) / 1e4;
+#else
+        timespec time{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+        return double(time.tv_sec) * 1e3 + double(time.tv_nsec) / 1e6;
+#endif
+    }
+
+    struct ProfileStage
+    {
+        std::string name;
+        std::uint64_t calls = 0;
+        double wallMs = 0.0;
+        double cpuMs = 0.0;
+        // 阶段进行期间采样到的最大常驻内存，以及相对阶段开始时的最大增长(多次调用取最大值)
+        std::uint64_t peakResidentBytes = 0;
+        std::uint64_t peakGrowthBytes = 0;
+    };
+
+    class Profiler
+    {
+        Profiler() = default;
+        ~Profiler() { stopSampler(); }
+
+    public:
+        static auto &GetInstance()
+        {
+            static Profiler instance{};
+            return instance;
+        }
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        void SetEnabled(bool enabled)
+        {
+            m_enabled = enabled;
+            if (enabled)
+                startSampler();
+            else
+                stopSampler();
+        }
+        bool Enabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+        // GL阶段结束时调用glFinish，让耗时包含驱动真正执行命令的时间(只在基准测试里打开，会让渲染循环变慢)
+        void SetGpuSync(bool sync) noexcept { m_gpuSync = sync; }
+        bool GpuSync() const noexcept { return m_gpuSync.load(std::memory_order_relaxed); }
+
+        // residentStart是阶段开始时的常驻内存，residentPeak是阶段期间采样到的最大值
+        void Record(const char *stage, double wallMs, double cpuMs, std::uint64_t residentStart, std::uint64_t residentPeak)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = std::find_if(m_stages.begin(), m_stages.end(), [stage](const ProfileStage &entry)
+                                     { return entry.name == stage; });
+            if (iter == m_stages.end())
+            {
+                m_stages.push_back(ProfileStage());
+                iter = std::prev(m_stages.end());
+                iter->name = stage;
+            }
+            iter->calls++;
+            iter->wallMs += wallMs;
+            iter->cpuMs += cpuMs;
+            iter->peakResidentBytes = std::max(iter->peakResidentBytes, residentPeak);
+            iter->peakGrowthBytes = std::max(iter->peakGrowthBytes, residentPeak > residentStart ? residentPeak - residentStart : 0);
+        }
+        // ProfileScope在阶段开始/结束时登记和注销自己的峰值，采样线程持续更新
+        void Track(std::atomic<std::uint64_t> *peak)
+        {
+            std::lock_guard<std::mutex> lock(m_trackedMutex);
+            m_tracked.push_back(peak);
+        }
+        void Untrack(std::atomic<std::uint64_t> *peak)
+        {
+            std::lock_guard<std::mutex> lock(m_trackedMutex);
+            auto iter = std::find(m_tracked.begin(), m_tracked.end(), peak);
+            if (iter != m_tracked.end())
+            {
+                *iter = m_tracked.back();
+                m_tracked.pop_back();
+            }
+        }
+        static void UpdatePeak(std::atomic<std::uint64_t> &peak, std::uint64_t value) noexcept
+        {
+            std::uint64_t current = peak.load(std::memory_order_relaxed);
+            while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+        // 按阶段第一次出现的顺序返回
+        std::vector<ProfileStage> Snapshot() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stages;
+        }
+        void Reset()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stages.clear();
+        }
+
+    private:
+        void startSampler()
+        {
+            std::lock_guard<std::mutex> lock(m_samplerMutex);
+            if (m_sampler.joinable())
+                return;
+            m_sampling = true;
+            m_sampler = std::thread([this]
+                                    {
+                                        while (m_sampling.load(std::memory_order_relaxed))
+                                        {
+                                            const std::uint64_t resident = CurrentResidentBytes();
+                                            {
+                                                std::lock_guard<std::mutex> lock(m_trackedMutex);
+                                                for (auto *peak : m_tracked)
+                                                    UpdatePeak(*peak, resident);
+                                            }
+                                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                                        } });
+        }
+        void stopSampler()
+        {
+            std::lock_guard<std::mutex> lock(m_samplerMutex);
+            if (!m_sampler.joinable())
+                return;
+            m_sampling = false;
+            m_sampler.join();
+        }
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<bool> m_gpuSync{false};
+        mutable std::mutex m_mutex;
+        std::vector<ProfileStage> m_stages;
+        std::mutex m_samplerMutex;
+        std::thread m_sampler;
+        std::atomic<bool> m_sampling{false};
+        std::mutex m_trackedMutex;
+        std::vector<std::atomic<std::uint64_t> *> m_tracked;
+    };
+
+    // 作用域计时：构造时开始，析构时记录到Profiler，stage必须是字符串常量
+    // gpu为true的阶段在GpuSync打开时先glFinish再停止计时(只能在GL线程使用)
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char *stage, bool gpu = false) : m_stage(stage), m_gpu(gpu)
+        {
+            if (!Profiler::GetInstance().Enabled())
+            {
+                m_stage = nullptr;
+                return;
+            }
+            m_residentStart = CurrentResidentBytes();
+            m_residentPeak = m_residentStart;
+            Profiler::GetInstance().Track(&m_residentPeak);
+            m_cpuStart = ThreadCpuMs();
+            m_start = std::chrono::steady_clock::now();
+        }
+        ~ProfileScope()
+        {
+            if (!m_stage)
+                return;
+            auto &profiler = Profiler::GetInstance();
+            if (m_gpu && profiler.GpuSync())
+                glFinish();
+            double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+            double cpuMs = ThreadCpuMs() - m_cpuStart;
+            profiler.Untrack(&m_residentPeak);
+            // 比采样间隔还短的阶段至少有开始和结束两个样本
+            Profiler::UpdatePeak(m_residentPeak, CurrentResidentBytes());
+            profiler.Record(m_stage, wallMs, cpuMs, m_residentStart, m_residentPeak.load(std::memory_order_relaxed));
+        }
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        const char *m_stage;
+        bool m_gpu;
+        std::uint64_t m_residentStart = 0;
+        std::atomic<std::uint64_t> m_residentPeak{0};
+        double m_cpuStart = 0.0;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
@@ -0,0 +1,285 @@
+#pragma once
+// 按绘制排序的提交列表：每个pass每帧把要画的网格加进来，每个绘制生成一个64位排序键，基数排序后按顺序提交
+// 排序键的布局(从高位到低位)：
+//   不透明: pass(2) | program(8) | path(1) | geometry(7) | textures(14) | material(16) | depth(16)，状态相同的绘制从前往后
+//   透明:   pass(2) | ~depth(24) | program(8) | path(1) | geometry(7) | textures(10) | material(12)，严格从后往前
+// path为0表示间接绘制(IndirectDrawBuffer)，它的材质和贴图已经在绘制数据里，这两段填0，同一批内完全按深度排序
+// geometry是顶点格式、索引宽度和arena页(决定VAO，页号在键里饱和到31)；提交时着色器、VAO、材质槽位、贴图只在和上一个绘制不同时才切换，省掉的次数记在RenderStats里
+#include <glad/glad.h>
+
+#include "GeometryArena.h"
+#include "IndirectDrawBuffer.h"
+#include "MaterialTextures.h"
+#include "Mesh.h"
+#include "RenderStats.h"
+#include "Shader.h"
+#include "TextureStreamer.h"
+#include "TransformHierarchy.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Renderer
+{
+    enum class RenderPass : std::uint8_t
+    {
+        Opaque = 0,
+        Transparent = 1
+    };
+
+    struct RenderItem
+    {
+        ModelLoader::Mesh *mesh = nullptr;
+        Shader *shader = nullptr;
+        glm::mat4 world = glm::mat4(1.0f);
+        NormalMatrix normal;
+        // 逐次绑定的贴图组合，0表示不需要绑定
+        std::uint32_t textureSet = 0;
+        bool indirect = false;
+    };
+    struct RenderKey
+    {
+        std::uint64_t key = 0;
+        std::uint32_t item = 0;
+    };
+
+    // 按key从小到大的LSD基数排序，每趟8位；所有key在某个字节上都相同时跳过这一趟(同一帧里高位大多相同)
+    // 稳定排序，key相同的绘制保持加入顺序
+    inline void RadixSort(std::vector<RenderKey> &keys, std::vector<RenderKey> &scratch)
+    {
+        const std::size_t count = keys.size();
+        if (count <= 1)
+            return;
+        scratch.resize(count);
+        // 一次扫描得到8趟的直方图
+        std::uint32_t histograms[8][256] = {};
+        for (const auto &key : keys)
+        {
+            for (int pass = 0; pass < 8; pass++)
+                histograms[pass][(key.key >> (pass * 8)) & 0xFF]++;
+        }
+        RenderKey *source = keys.data();
+        RenderKey *target = scratch.data();
+        for (int pass = 0; pass < 8; pass++)
+        {
+            const int shift = pass * 8;
+            auto &histogram = histograms[pass];
+            if (histogram[(source[0].key >> shift) & 0xFF] == count)
+                continue;
+            std::uint32_t offset = 0;
+            for (auto &bucket : histogram)
+            {
+                std::uint32_t size = bucket;
+                bucket = offset;
+                offset += size;
+            }
+            for (std::size_t i = 0; i < count; i++)
+                target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+            std::swap(source, target);
+        }
+        if (source != keys.data())
+            std::copy(source, source + count, keys.data());
+    }
+
+    class RenderList
+    {
+    public:
+        RenderList() = default;
+        RenderList(const RenderList &) = delete;
+        RenderList &operator=(const RenderList &) = delete;
+
+        // 每帧收集之前调用，context是这一帧的相机参数(其中的model由每个绘制自己的世界矩阵代替)
+        void Begin(const ModelLoader::LodContext &context)
+        {
+            m_context = context;
+            m_items.clear();
+            m_keys.clear();
+            m_programs.clear();
+            m_textureSets.clear();
+        }
+        // world是网格的世界矩阵，normal是对应的法线矩阵；深度取包围球中心在裁剪空间的w(即观察空间深度)
+        void Add(Shader &shader, ModelLoader::Mesh &mesh, const glm::mat4 &world, const NormalMatrix &normal)
+        {
+            if (!mesh.geometry.Valid())
+                return;
+            RenderItem item;
+            item.mesh = &mesh;
+            item.shader = &shader;
+            item.world = world;
+            item.normal = normal;
+            item.indirect = !mesh.transparent && mesh.SupportsIndirect();
+            item.textureSet = !item.indirect && mesh.NeedsTextureBinding() ? textureSetIndex(mesh) : 0;
+
+            const float depth = std::max((m_context.viewProjection * world * glm::vec4(mesh.boundsCenter, 1.0f)).w, 0.0f);
+            // 非负浮点数的位模式和数值的大小顺序一致，取高位就是对数分布的量化深度
+            const std::uint32_t depthBits = std::bit_cast<std::uint32_t>(depth);
+            const std::uint64_t program = programIndex(shader.ID);
+            const std::uint64_t path = item.indirect ? 0 : 1;
+            const std::uint64_t geometry = geometryKey(mesh.geometry);
+            const std::uint64_t textures = item.textureSet;
+            const std::uint64_t material = item.indirect || !mesh.usePBR ? 0 : mesh.materialSlot + 1;
+            RenderKey key;
+            key.item = static_cast<std::uint32_t>(m_items.size());
+            if (!mesh.transparent)
+            {
+                key.key = (std::uint64_t(RenderPass::Opaque) << 62) | (program << 54) | (path << 53) | (geometry << 46) | ((textures & 0x3FFF) << 32) |
+                          ((material & 0xFFFF) << 16) | (depthBits >> 16);
+            }
+            else
+            {
+                key.key = (std::uint64_t(RenderPass::Transparent) << 62) | (std::uint64_t(~depthBits >> 8) << 38) | (program << 30) | (path << 29) |
+                          (geometry << 22) | ((textures & 0x3FF) << 12) | (material & 0xFFF);
+            }
+            m_items.push_back(item);
+            m_keys.push_back(key);
+        }
+
+        // 排序并提交：不透明的间接绘制攒到同一着色器的直接绘制之前一次提交，透明绘制开启混合、关闭深度写入
+        void Submit()
+        {
+            if (m_keys.empty())
+                return;
+            RadixSort(m_keys, m_scratch);
+            auto &stats = RenderStats::GetInstance();
+            auto &arena = GeometryArena::GetInstance();
+            constexpr std::uint64_t kNone = ~0ull;
+            Shader *program = nullptr;
+            std::uint64_t geometry = kNone, material = kNone, textures = kNone;
+            bool blending = false;
+            m_indirect.Clear();
+            auto flushIndirect = [&]()
+            {
+                if (m_indirect.CommandCount() == 0)
+                    return;
+                m_indirect.Submit(*program);
+                m_indirect.Clear();
+                // Submit绑定了自己的VAO
+                geometry = kNone;
+            };
+            MaterialTextures::GetInstance().BindArrays();
+            ModelLoader::LodContext context = m_context;
+            for (const auto &key : m_keys)
+            {
+                RenderItem &item = m_items[key.item];
+                ModelLoader::Mesh &mesh = *item.mesh;
+                context.model = item.world;
+                if (item.shader != program)
+                {
+                    flushIndirect();
+                    item.shader->use();
+                    // uniform属于着色器，切换后材质和贴图都要重新设置
+                    item.shader->setBool("nodeTransform", false);
+                    program = item.shader;
+                    geometry = material = textures = kNone;
+                    stats.AddStateChange(StateChange::Program, false);
+                }
+                else
+                    stats.AddStateChange(StateChange::Program, true);
+
+                const std::uint64_t itemGeometry = vertexArrayState(mesh.geometry);
+                if (item.indirect)
+                {
+                    stats.AddStateChange(StateChange::VertexArray, itemGeometry == geometry);
+                    geometry = itemGeometry;
+                    stats.AddStateChange(StateChange::Material, true);
+                    stats.AddStateChange(StateChange::Textures, true);
+                    m_indirect.Add(mesh, context, item.normal);
+                    continue;
+                }
+                flushIndirect();
+                if (mesh.transparent && !blending)
+                {
+                    glEnable(GL_BLEND);
+                    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                    glDepthMask(GL_FALSE);
+                    blending = true;
+                }
+                if (itemGeometry != geometry)
+                {
+                    arena.Bind(mesh.geometry);
+                    program->setBool("compactVertex", mesh.vertexFormat == ModelLoader::VertexFormat::Compact);
+                    geometry = itemGeometry;
+                    stats.AddStateChange(StateChange::VertexArray, false);
+                }
+                else
+                    stats.AddStateChange(StateChange::VertexArray, true);
+                const std::uint64_t itemMaterial = mesh.usePBR ? mesh.materialSlot : kNone - 1;
+                if (itemMaterial != material)
+                {
+                    mesh.BindMaterialSlot(*program);
+                    material = itemMaterial;
+                    stats.AddStateChange(StateChange::Material, false);
+                }
+                else
+                    stats.AddStateChange(StateChange::Material, true);
+                // 不需要绑定贴图的网格不会采样3~7号单元，保留之前绑定的贴图
+                if (item.textureSet != 0 && item.textureSet != textures)
+                {
+                    mesh.BindTextures(*program);
+                    textures = item.textureSet;
+                    stats.AddStateChange(StateChange::Textures, false);
+                }
+                else
+                    stats.AddStateChange(StateChange::Textures, true);
+                program->setMat4("model", item.world);
+                program->setMat3("normalMatrix", glm::mat3(glm::vec3(item.normal.columns[0]), glm::vec3(item.normal.columns[1]), glm::vec3(item.normal.columns[2])));
+                mesh.DrawGeometry(context);
+            }
+            flushIndirect();
+            if (blending)
+            {
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+            }
+            program->setBool("compactVertex", false);
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        std::size_t Size() const noexcept { return m_items.size(); }
+
+    private:
+        // 排序键里的7位geometry只用来把同一VAO的绘制排在一起，页号超过31的都归到31(不回绕)；是否切换VAO由vertexArrayState判断
+        static std::uint64_t geometryKey(const GeometryAllocation &geometry)
+        {
+            const std::uint64_t page = static_cast<std::uint64_t>(std::clamp(geometry.page, 0, 0x1F));
+            return (std::uint64_t(geometry.format) << 6) | (std::uint64_t(geometry.indexType) << 5) | page;
+        }
+        // 完整的(顶点格式, 索引宽度, 页)，作为提交时"当前VAO"的状态
+        static std::uint64_t vertexArrayState(const GeometryAllocation &geometry)
+        {
+            return (std::uint64_t(geometry.format) << 40) | (std::uint64_t(geometry.indexType) << 32) | static_cast<std::uint32_t>(geometry.page);
+        }
+        // 着色器按这一帧第一次出现的顺序编号
+        std::uint64_t programIndex(GLuint id)
+        {
+            auto iter = std::find(m_programs.begin(), m_programs.end(), id);
+            if (iter != m_programs.end())
+                return static_cast<std::uint64_t>(iter - m_programs.begin()) & 0xFF;
+            m_programs.push_back(id);
+            return (m_programs.size() - 1) & 0xFF;
+        }
+        // 按实际绑定的纹理(异步上传完成前是占位纹理)组合编号，从1开始
+        std::uint32_t textureSetIndex(const ModelLoader::Mesh &mesh)
+        {
+            auto &streamer = TextureStreamer::GetInstance();
+            std::uint64_t hash = 1469598103934665603ull;
+            for (const auto &texture : mesh.textures)
+                hash = (hash ^ streamer.GetBindID(*texture.texture, texture.type)) * 1099511628211ull;
+            auto [iter, inserted] = m_textureSets.try_emplace(hash, static_cast<std::uint32_t>(m_textureSets.size() + 1));
+            return iter->second;
+        }
+
+        ModelLoader::LodContext m_context;
+        std::vector<RenderItem> m_items;
+        std::vector<RenderKey> m_keys;
+        std::vector<RenderKey> m_scratch;
+        std::vector<GLuint> m_programs;
+        std::unordered_map<std::uint64_t, std::uint32_t> m_textureSets;
+        IndirectDrawBuffer m_indirect;
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "Shader.h"
 #include "Camera.h"
+#include "RenderList.h"
 #include "Scene.h"
 #include "Windowsystem.h"
 #include <functional>
@@ -52,7 +53,7 @@ namespace Renderer
                 m_renderCommands.erase(iter);
             }
         }
-        // 根据深度排序
+        // 根据深度排序(命令之间的顺序)，命令内部各个绘制的顺序由RenderList按排序键决定
         void Sort()
         {
             std::sort(m_renderCommands.begin(), m_renderCommands.end(), [](const RenderCommand &a, const RenderCommand &b)
@@ -0,0 +1,110 @@
+#pragma once
+// 每帧的渲染统计：draw call数(以及间接绘制的命令数)、实际提交的三角形数，以及全部用LOD0时本应提交的三角形数，还有meshlet剔除的结果和排序提交省掉的状态切换
+// 渲染循环每帧开始时调用BeginFrame，上一帧的结果通过LastFrame读取
+#include <cstddef>
+#include <cstdint>
+
+namespace Renderer
+{
+    // RenderList排序提交时统计的状态类别
+    enum class StateChange : std::uint8_t
+    {
+        Program,
+        VertexArray,
+        Material,
+        Textures,
+        Count
+    };
+    constexpr std::size_t kStateChangeCount = static_cast<std::size_t>(StateChange::Count);
+
+    struct FrameStats
+    {
+        std::uint64_t drawCalls = 0;
+        std::uint64_t triangles = 0;
+        std::uint64_t fullDetailTriangles = 0;
+        std::uint64_t clustersTested = 0;
+        std::uint64_t clustersVisible = 0;
+        // glMultiDrawElementsIndirect提交的命令数(每次MDI只算一个draw call)
+        std::uint64_t indirectCommands = 0;
+        // 按StateChange分类：实际切换的次数，以及和上一个绘制相同(或者已经在间接绘制数据里)而省掉的次数
+        std::uint64_t stateChanges[kStateChangeCount] = {};
+        std::uint64_t stateChangesAvoided[kStateChangeCount] = {};
+
+        std::uint64_t TotalStateChanges() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (auto count : stateChanges)
+                total += count;
+            return total;
+        }
+        std::uint64_t TotalStateChangesAvoided() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (auto count : stateChangesAvoided)
+                total += count;
+            return total;
+        }
+    };
+
+    class RenderStats
+    {
+        RenderStats() = default;
+        ~RenderStats() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static RenderStats instance{};
+            return instance;
+        }
+        RenderStats(const RenderStats &) = delete;
+        RenderStats &operator=(const RenderStats &) = delete;
+
+        void BeginFrame()
+        {
+            m_lastFrame = m_currentFrame;
+            m_currentFrame = FrameStats();
+        }
+        void AddDraw(std::uint64_t triangles, std::uint64_t fullDetailTriangles)
+        {
+            m_currentFrame.drawCalls++;
+            m_currentFrame.triangles += triangles;
+            m_currentFrame.fullDetailTriangles += fullDetailTriangles;
+        }
+
+        // 间接绘制：每个网格只累计命令数和三角形，draw call在提交时按glMultiDrawElementsIndirect的次数用AddMultiDraw计
+        void AddIndirect(std::uint64_t commands, std::uint64_t triangles, std::uint64_t fullDetailTriangles)
+        {
+            m_currentFrame.indirectCommands += commands;
+            m_currentFrame.triangles += triangles;
+            m_currentFrame.fullDetailTriangles += fullDetailTriangles;
+        }
+        void AddMultiDraw()
+        {
+            m_currentFrame.drawCalls++;
+        }
+
+        // 整个网格都被剔除时没有draw call，只记录本应提交的三角形数
+        void AddCulled(std::uint64_t fullDetailTriangles)
+        {
+            m_currentFrame.fullDetailTriangles += fullDetailTriangles;
+        }
+        void AddStateChange(StateChange kind, bool avoided)
+        {
+            auto &counts = avoided ? m_currentFrame.stateChangesAvoided : m_currentFrame.stateChanges;
+            counts[static_cast<std::size_t>(kind)]++;
+        }
+        void AddClusters(std::uint64_t tested, std::uint64_t visible)
+        {
+            m_currentFrame.clustersTested += tested;
+            m_currentFrame.clustersVisible += visible;
+        }
+
+        const FrameStats &CurrentFrame() const noexcept { return m_currentFrame; }
+        const FrameStats &LastFrame() const noexcept { return m_lastFrame; }
+
+    private:
+        FrameStats m_currentFrame;
+        FrameStats m_lastFrame;
+    };
+}
@@ -0,0 +1,291 @@
+#pragma once
+// 显存/内存占用统计：每个GL对象(纹理、缓冲、渲染缓冲)分配或重新分配存储时登记类别、所有者和字节数，删除时注销
+// 按类别累计当前字节数、峰值字节数、当前对象数和累计分配次数，C++用Snapshot/Owners读取，Python模块导出了同样的接口
+// CPU端较大的临时数据(解码后的图片、碰撞几何)用指针作为名字登记在Host类别里
+// 纹理字节数按内部格式估算(RGB按驱动补齐成RGBA计算)，不包含驱动的对齐和额外开销
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Renderer
+{
+    enum class ResourceCategory : std::uint8_t
+    {
+        Texture,     // 材质纹理和占位纹理
+        MeshBuffer,  // GeometryArena的顶点/索引页以及内置几何体
+        DrawData,    // 材质SSBO、实例缓冲、节点变换SSBO、间接绘制命令
+        GBuffer,     // G-buffer的颜色附件和深度缓冲
+        IBL,         // HDR贴图、环境/辐照度/预过滤立方体贴图、BRDF LUT
+        Framebuffer, // 捕获用Framebuffer的附件
+        Staging,     // 纹理上传用的PBO
+        HostImage,   // CPU端等待上传的解码图片
+        HostGeometry, // CPU端保留的碰撞几何
+        Count
+    };
+    constexpr std::size_t kResourceCategoryCount = static_cast<std::size_t>(ResourceCategory::Count);
+
+    inline const char *ResourceCategoryName(ResourceCategory category)
+    {
+        switch (category)
+        {
+        case ResourceCategory::Texture:
+            return "texture";
+        case ResourceCategory::MeshBuffer:
+            return "mesh_buffer";
+        case ResourceCategory::DrawData:
+            return "draw_data";
+        case ResourceCategory::GBuffer:
+            return "gbuffer";
+        case ResourceCategory::IBL:
+            return "ibl";
+        case ResourceCategory::Framebuffer:
+            return "framebuffer";
+        case ResourceCategory::Staging:
+            return "staging";
+        case ResourceCategory::HostImage:
+            return "host_image";
+        case ResourceCategory::HostGeometry:
+            return "host_geometry";
+        default:
+            return "unknown";
+        }
+    }
+    inline bool IsHostCategory(ResourceCategory category)
+    {
+        return category == ResourceCategory::HostImage || category == ResourceCategory::HostGeometry;
+    }
+
+    // GL对象名只在同一种对象之间唯一，Host用指针地址作为名字
+    enum class ResourceKind : std::uint8_t
+    {
+        Texture,
+        Buffer,
+        Renderbuffer,
+        Host
+    };
+
+    struct ResourceStats
+    {
+        ResourceCategory category = ResourceCategory::Texture;
+        std::uint64_t liveBytes = 0;
+        std::uint64_t peakBytes = 0;
+        // 当前存活的对象数，以及累计的分配次数(重新分配存储也算一次)
+        std::uint64_t liveCount = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    struct ResourceOwnerStats
+    {
+        ResourceCategory category = ResourceCategory::Texture;
+        std::string owner;
+        std::uint64_t liveBytes = 0;
+        std::uint64_t liveCount = 0;
+    };
+
+    // 内部格式每个像素的字节数(BC7/BC5每4x4块16字节，即每像素1字节)
+    inline std::uint64_t TexelBytes(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RED:
+        case GL_R8:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RG_RGTC2:
+            return 1;
+        case GL_RG:
+        case GL_RG8:
+            return 2;
+        case GL_RG16F:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+        case GL_RGBA16F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            // GL_RGB/GL_RGBA/GL_SRGB/GL_SRGB_ALPHA，RGB一般补齐成4字节
+            return 4;
+        }
+    }
+    // 一张2D纹理(faces为6时是立方体贴图)的估算大小，mipmapped时包含完整的mip链
+    inline std::uint64_t TextureBytes(GLenum internalFormat, std::uint64_t width, std::uint64_t height, bool mipmapped = false, std::uint64_t faces = 1)
+    {
+        std::uint64_t texels = 0;
+        while (true)
+        {
+            texels += width * height;
+            if (!mipmapped || (width <= 1 && height <= 1))
+                break;
+            width = std::max<std::uint64_t>(width / 2, 1);
+            height = std::max<std::uint64_t>(height / 2, 1);
+        }
+        return texels * TexelBytes(internalFormat) * faces;
+    }
+
+    class ResourceTracker
+    {
+        ResourceTracker() = default;
+        ~ResourceTracker() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static ResourceTracker instance{};
+            return instance;
+        }
+        ResourceTracker(const ResourceTracker &) = delete;
+        ResourceTracker &operator=(const ResourceTracker &) = delete;
+
+        // 登记一次存储分配；同一个对象重新分配(glTexImage2D/glBufferData/glRenderbufferStorage)时替换原来的大小
+        void Track(ResourceKind kind, std::uint64_t name, ResourceCategory category, std::string owner, std::uint64_t bytes)
+        {
+            if (name == 0)
+                return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto [iter, inserted] = m_records.try_emplace(Key{kind, name});
+            Record &record = iter->second;
+            if (!inserted)
+                subtract(record);
+            record.category = category;
+            record.owner = std::move(owner);
+            record.bytes = bytes;
+            auto &stats = m_stats[static_cast<std::size_t>(category)];
+            stats.liveBytes += bytes;
+            stats.liveCount++;
+            stats.allocations++;
+            stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+            auto &total = IsHostCategory(category) ? m_hostTotal : m_gpuTotal;
+            total.liveBytes += bytes;
+            total.liveCount++;
+            total.allocations++;
+            total.peakBytes = std::max(total.peakBytes, total.liveBytes);
+        }
+        // 对象删除时调用，没有登记过的对象直接忽略
+        void Release(ResourceKind kind, std::uint64_t name)
+        {
+            if (name == 0)
+                return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_records.find(Key{kind, name});
+            if (iter == m_records.end())
+                return;
+            subtract(iter->second);
+            m_records.erase(iter);
+        }
+        template <typename T>
+        void TrackHost(const T *pointer, ResourceCategory category, std::string owner, std::uint64_t bytes)
+        {
+            Track(ResourceKind::Host, reinterpret_cast<std::uintptr_t>(pointer), category, std::move(owner), bytes);
+        }
+        template <typename T>
+        void ReleaseHost(const T *pointer)
+        {
+            Release(ResourceKind::Host, reinterpret_cast<std::uintptr_t>(pointer));
+        }
+
+        // 按ResourceCategory的顺序返回每个类别的统计
+        std::vector<ResourceStats> Snapshot() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<ResourceStats> stats(m_stats, m_stats + kResourceCategoryCount);
+            for (std::size_t i = 0; i < stats.size(); i++)
+                stats[i].category = static_cast<ResourceCategory>(i);
+            return stats;
+        }
+        ResourceStats Stats(ResourceCategory category) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ResourceStats stats = m_stats[static_cast<std::size_t>(category)];
+            stats.category = category;
+            return stats;
+        }
+        // 所有GPU类别/所有Host类别的合计，峰值是合计值的峰值而不是各类别峰值之和
+        ResourceStats GpuTotal() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_gpuTotal;
+        }
+        ResourceStats HostTotal() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_hostTotal;
+        }
+        // 按(类别, 所有者)汇总当前存活的对象，按字节数从大到小排序
+        std::vector<ResourceOwnerStats> Owners() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::map<std::pair<ResourceCategory, std::string>, ResourceOwnerStats> owners;
+            for (const auto &[key, record] : m_records)
+            {
+                auto &entry = owners[{record.category, record.owner}];
+                entry.category = record.category;
+                entry.owner = record.owner;
+                entry.liveBytes += record.bytes;
+                entry.liveCount++;
+            }
+            std::vector<ResourceOwnerStats> result;
+            result.reserve(owners.size());
+            for (auto &[key, entry] : owners)
+                result.push_back(std::move(entry));
+            std::sort(result.begin(), result.end(), [](const ResourceOwnerStats &a, const ResourceOwnerStats &b)
+                      { return a.liveBytes > b.liveBytes; });
+            return result;
+        }
+        // 峰值重新从当前值开始统计，累计分配次数清零(存活对象不受影响)
+        void ResetPeaks()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto &stats : m_stats)
+            {
+                stats.peakBytes = stats.liveBytes;
+                stats.allocations = 0;
+            }
+            for (auto *total : {&m_gpuTotal, &m_hostTotal})
+            {
+                total->peakBytes = total->liveBytes;
+                total->allocations = 0;
+            }
+        }
+
+    private:
+        struct Key
+        {
+            ResourceKind kind;
+            std::uint64_t name;
+            bool operator<(const Key &other) const
+            {
+                return kind != other.kind ? kind < other.kind : name < other.name;
+            }
+        };
+        struct Record
+        {
+            ResourceCategory category = ResourceCategory::Texture;
+            std::string owner;
+            std::uint64_t bytes = 0;
+        };
+        void subtract(const Record &record)
+        {
+            auto &stats = m_stats[static_cast<std::size_t>(record.category)];
+            stats.liveBytes -= record.bytes;
+            stats.liveCount--;
+            auto &total = IsHostCategory(record.category) ? m_hostTotal : m_gpuTotal;
+            total.liveBytes -= record.bytes;
+            total.liveCount--;
+        }
+
+        mutable std::mutex m_mutex;
+        std::map<Key, Record> m_records;
+        ResourceStats m_stats[kResourceCategoryCount];
+        ResourceStats m_gpuTotal;
+        ResourceStats m_hostTotal;
+    };
+}
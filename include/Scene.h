@@ -1,10 +1,19 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "AsyncModelLoader.h"
+#include "InstanceBuffer.h"
 #include "Model.h"
 #include "Skybox.h"
 namespace Renderer
 {
+    // 同一个模型的多个实例，绘制时每个网格一次实例化draw call
+    struct InstancedModel
+    {
+        std::shared_ptr<ModelLoader::Model> model;
+        std::shared_ptr<InstanceBuffer> instances;
+    };
+
     class Scene
     {
     public:
@@ -26,13 +35,59 @@ namespace Renderer
         {
             m_models.push_back(model);
         }
-        void LoadSkybox(const char *hdrPath, const std::size_t resolution, GLFWwindow *window)
+        // 异步加载：模型立即加入场景，加载期间绘制包围盒代理，网格由UpdateStreaming分帧换入
+        // 返回的句柄可以查询进度和取消，取消或失败的模型会从场景中移除
+        std::shared_ptr<ModelLoadHandle> AddModelAsync(const std::string &path, bool gamma = false, bool PBR = false, ModelLoader::ModelLoadOptions options = ModelLoader::ModelLoadOptions())
         {
-            m_skybox->Load(hdrPath, resolution, window);
+            auto handle = AsyncModelLoader::GetInstance().Load(path, gamma, PBR, options);
+            m_models.push_back(handle->GetModel());
+            m_loading.push_back(handle);
+            return handle;
+        }
+        // 把模型放置在transform处：同一个模型的所有实例共用一个InstanceBuffer，模型只加载一份
+        // 模型不需要再AddModel(否则会按普通模型多画一次)，异步加载时用AddInstancesAsync
+        std::size_t AddInstance(const std::shared_ptr<ModelLoader::Model> &model, const glm::mat4 &transform)
+        {
+            return GetInstances(model).Add(transform);
         }
-        void SetSkybox(glm::mat4 projection)
+        InstanceBuffer &GetInstances(const std::shared_ptr<ModelLoader::Model> &model)
         {
-            m_skybox->setProjection(projection);
+            for (auto &instanced : m_instanced)
+            {
+                if (instanced.model == model)
+                    return *instanced.instances;
+            }
+            m_instanced.push_back({model, std::make_shared<InstanceBuffer>()});
+            return *m_instanced.back().instances;
+        }
+        // 异步加载一个模型并按transforms放置多份
+        std::shared_ptr<ModelLoadHandle> AddInstancesAsync(const std::string &path, const std::vector<glm::mat4> &transforms, bool gamma = false, bool PBR = false,
+                                                           ModelLoader::ModelLoadOptions options = ModelLoader::ModelLoadOptions())
+        {
+            auto handle = AsyncModelLoader::GetInstance().Load(path, gamma, PBR, options);
+            m_instanced.push_back({handle->GetModel(), std::make_shared<InstanceBuffer>(transforms)});
+            m_loading.push_back(handle);
+            return handle;
+        }
+        // 在GL线程每帧调用，单帧创建网格的耗时不超过budgetMs
+        void UpdateStreaming(double budgetMs = 4.0)
+        {
+            AsyncModelLoader::GetInstance().Update(budgetMs);
+            std::erase_if(m_loading, [this](const std::shared_ptr<ModelLoadHandle> &handle)
+                          {
+                              if (!handle->IsDone())
+                                  return false;
+                              if (handle->GetState() != ModelLoadState::Ready)
+                              {
+                                  std::erase(m_models, handle->GetModel());
+                                  std::erase_if(m_instanced, [&handle](const InstancedModel &instanced)
+                                                { return instanced.model == handle->GetModel(); });
+                              }
+                              return true; });
+        }
+        void LoadSkybox(const char *hdrPath, const std::size_t resolution, GLFWwindow *window)
+        {
+            m_skybox->Load(hdrPath, resolution, window);
         }
         void Bake(GLFWwindow *window)
         {
@@ -42,6 +97,7 @@ namespace Renderer
         {
         }
         auto GetModels() { return m_models; }
+        auto &GetInstancedModels() { return m_instanced; }
         auto GetSkybox() { return m_skybox; }
         void renderSphere();
         glm::vec3 lightPositions[8] = {
@@ -68,6 +124,8 @@ namespace Renderer
         std::shared_ptr<Skybox> m_skybox;
         std::string m_sceneName;
         std::vector<std::shared_ptr<ModelLoader::Model>> m_models;
+        std::vector<InstancedModel> m_instanced;
+        std::vector<std::shared_ptr<ModelLoadHandle>> m_loading;
     };
 
 }
\ No newline at end of file
@@ -4,7 +4,12 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -12,6 +17,28 @@ namespace Renderer
 {
     size_t Typesize(GLenum type);
 
+    // uniform名字的64位FNV-1a哈希，0留给哈希表的空槽位
+    constexpr std::uint64_t UniformHash(std::string_view name) noexcept
+    {
+        std::uint64_t hash = 1469598103934665603ull;
+        for (char c : name)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        return hash ? hash : 1;
+    }
+    // Shader::setXxx的名字参数：字符串字面量在编译期算好哈希，运行时拼出来的std::string在调用时计算
+    class UniformName
+    {
+    public:
+        template <std::size_t N>
+        consteval UniformName(const char (&name)[N]) : m_hash(UniformHash(std::string_view(name, N - 1))) {}
+        UniformName(const std::string &name) noexcept : m_hash(UniformHash(name)) {}
+
+        std::uint64_t Hash() const noexcept { return m_hash; }
+
+    private:
+        std::uint64_t m_hash;
+    };
+
     class Shader
     {
     public:
@@ -75,8 +102,8 @@ namespace Renderer
                 vShaderFile.close();
                 fShaderFile.close();
                 // convert stream into string
-                vertexCode = vShaderStream.str();
-                fragmentCode = fShaderStream.str();
+                vertexCode = insertGlobalDefines(expandIncludes(vShaderStream.str(), vertexPath));
+                fragmentCode = insertGlobalDefines(expandIncludes(fShaderStream.str(), fragmentPath));
                 // if geometry shader path is present, also load a geometry shader
                 if (geometryPath != nullptr)
                 {
@@ -84,7 +111,7 @@ namespace Renderer
                     std::stringstream gShaderStream;
                     gShaderStream << gShaderFile.rdbuf();
                     gShaderFile.close();
-                    geometryCode = gShaderStream.str();
+                    geometryCode = insertGlobalDefines(expandIncludes(gShaderStream.str(), geometryPath));
                 }
             }
             catch (std::ifstream::failure &e)
@@ -128,11 +155,17 @@ namespace Renderer
             glDeleteShader(fragment);
             if (geometryPath != nullptr)
                 glDeleteShader(geometry);
+            reflectUniforms();
         }
         ~Shader()
         {
             glDeleteProgram(ID);
         }
+        // 之后加载的所有着色器都在#version之后插入这一行宏定义(比如按驱动能力选择的材质纹理路径)
+        static void AddGlobalDefine(const std::string &define)
+        {
+            s_globalDefines += "#define " + define + "\n";
+        }
         // activate the shader
         // ------------------------------------------------------------------------
         void use() const
@@ -145,62 +178,95 @@ namespace Renderer
             glUseProgram(0);
         }
         // utility uniform functions
+        // 位置来自链接时反射出来的哈希表，不再调用glGetUniformLocation；着色器里不存在(或被优化掉)的uniform位置是-1，GL会忽略
         // ------------------------------------------------------------------------
-        void setBool(const std::string &name, bool value) const
+        GLint Location(UniformName name) const noexcept
+        {
+            const UniformSlot *slot = findUniform(name.Hash());
+            return slot ? slot->location : -1;
+        }
+        void setBool(UniformName name, bool value) const
         {
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+            glUniform1i(Location(name), (int)value);
         }
         // ------------------------------------------------------------------------
-        void setInt(const std::string &name, int value) const
+        void setInt(UniformName name, int value) const
         {
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+            glUniform1i(Location(name), value);
         }
         // ------------------------------------------------------------------------
-        void setFloat(const std::string &name, float value) const
+        void setFloat(UniformName name, float value) const
         {
-            glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+            glUniform1f(Location(name), value);
         }
         // ------------------------------------------------------------------------
-        void setVec2(const std::string &name, const glm::vec2 &value) const
+        void setVec2(UniformName name, const glm::vec2 &value) const
         {
-            glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+            glUniform2fv(Location(name), 1, &value[0]);
         }
-        void setVec2(const std::string &name, float x, float y) const
+        void setVec2(UniformName name, float x, float y) const
         {
-            glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+            glUniform2f(Location(name), x, y);
         }
         // ------------------------------------------------------------------------
-        void setVec3(const std::string &name, const glm::vec3 &value) const
+        void setVec3(UniformName name, const glm::vec3 &value) const
         {
-            glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+            glUniform3fv(Location(name), 1, &value[0]);
         }
-        void setVec3(const std::string &name, float x, float y, float z) const
+        void setVec3(UniformName name, float x, float y, float z) const
         {
-            glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+            glUniform3f(Location(name), x, y, z);
         }
         // ------------------------------------------------------------------------
-        void setVec4(const std::string &name, const glm::vec4 &value) const
+        void setVec4(UniformName name, const glm::vec4 &value) const
         {
-            glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+            glUniform4fv(Location(name), 1, &value[0]);
         }
-        void setVec4(const std::string &name, float x, float y, float z, float w) const
+        void setVec4(UniformName name, float x, float y, float z, float w) const
         {
-            glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+            glUniform4f(Location(name), x, y, z, w);
         }
         // ------------------------------------------------------------------------
-        void setMat2(const std::string &name, const glm::mat2 &mat) const
+        void setMat2(UniformName name, const glm::mat2 &mat) const
         {
-            glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            glUniformMatrix2fv(Location(name), 1, GL_FALSE, &mat[0][0]);
         }
         // ------------------------------------------------------------------------
-        void setMat3(const std::string &name, const glm::mat3 &mat) const
+        void setMat3(UniformName name, const glm::mat3 &mat) const
         {
-            glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            glUniformMatrix3fv(Location(name), 1, GL_FALSE, &mat[0][0]);
         }
         // ------------------------------------------------------------------------
-        void setMat4(const std::string &name, const glm::mat4 &mat) const
+        void setMat4(UniformName name, const glm::mat4 &mat) const
         {
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            glUniformMatrix4fv(Location(name), 1, GL_FALSE, &mat[0][0]);
+        }
+        // 数组uniform一次上传，name是数组名(或者某个元素，从它开始写)；超出着色器中数组长度的部分不上传
+        // ------------------------------------------------------------------------
+        void setIntArray(UniformName name, const int *values, std::size_t count) const
+        {
+            if (const UniformSlot *slot = findUniform(name.Hash()))
+                glUniform1iv(slot->location, slot->clamp(count), values);
+        }
+        void setFloatArray(UniformName name, const float *values, std::size_t count) const
+        {
+            if (const UniformSlot *slot = findUniform(name.Hash()))
+                glUniform1fv(slot->location, slot->clamp(count), values);
+        }
+        void setVec3Array(UniformName name, const glm::vec3 *values, std::size_t count) const
+        {
+            if (const UniformSlot *slot = findUniform(name.Hash()))
+                glUniform3fv(slot->location, slot->clamp(count), &values[0][0]);
+        }
+        void setVec4Array(UniformName name, const glm::vec4 *values, std::size_t count) const
+        {
+            if (const UniformSlot *slot = findUniform(name.Hash()))
+                glUniform4fv(slot->location, slot->clamp(count), &values[0][0]);
+        }
+        void setMat4Array(UniformName name, const glm::mat4 *values, std::size_t count) const
+        {
+            if (const UniformSlot *slot = findUniform(name.Hash()))
+                glUniformMatrix4fv(slot->location, slot->clamp(count), GL_FALSE, &values[0][0][0]);
         }
 
     private:
@@ -231,6 +297,131 @@ namespace Renderer
                 }
             }
         }
+        // 把单独一行的 #include "file" 替换成文件内容，路径相对于当前着色器文件(GLSL本身不支持#include)
+        // 被包含的文件里不再展开#include
+        static std::string expandIncludes(std::string code, const char *path)
+        {
+            const std::string file = path;
+            const std::size_t slash = file.find_last_of("/\\");
+            const std::string directory = slash == std::string::npos ? std::string() : file.substr(0, slash + 1);
+            for (std::size_t start = code.find("#include"); start != std::string::npos; start = code.find("#include", start))
+            {
+                std::size_t lineEnd = code.find('\n', start);
+                if (lineEnd == std::string::npos)
+                    lineEnd = code.size();
+                // 只处理行首的#include，注释里出现的不算
+                if (start != 0 && code[start - 1] != '\n')
+                {
+                    start = lineEnd;
+                    continue;
+                }
+                const std::size_t open = code.find('"', start);
+                const std::size_t close = open < lineEnd ? code.find('"', open + 1) : std::string::npos;
+                if (close == std::string::npos || close >= lineEnd)
+                {
+                    start = lineEnd;
+                    continue;
+                }
+                const std::string includePath = directory + code.substr(open + 1, close - open - 1);
+                std::ifstream includeFile(includePath);
+                if (!includeFile)
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << includePath << " (included from " << file << ")" << std::endl;
+                    start = lineEnd;
+                    continue;
+                }
+                std::stringstream includeStream;
+                includeStream << includeFile.rdbuf();
+                std::string included = includeStream.str();
+                if (!included.empty() && included.back() != '\n')
+                    included += '\n';
+                code.replace(start, lineEnd == code.size() ? lineEnd - start : lineEnd + 1 - start, included);
+                start += included.size();
+            }
+            return code;
+        }
+        // #version必须是第一行，宏定义插在它后面
+        static std::string insertGlobalDefines(std::string code)
+        {
+            if (s_globalDefines.empty())
+                return code;
+            std::size_t version = code.find("#version");
+            std::size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+            if (lineEnd == std::string::npos)
+                return s_globalDefines + code;
+            code.insert(lineEnd + 1, s_globalDefines);
+            return code;
+        }
+        // 链接后把所有活动的uniform(不含uniform块里的)反射到开放寻址的哈希表里，容量是2的幂且至少是条目数的两倍
+        // 数组同时登记数组名、name[0]和每个元素name[i]，size是从该位置开始剩余的元素个数
+        void reflectUniforms()
+        {
+            m_uniforms.clear();
+            GLint count = 0, maxLength = 0;
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+            std::vector<UniformSlot> entries;
+            std::vector<GLchar> buffer(std::max(maxLength, 1));
+            for (GLint i = 0; i < count; i++)
+            {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+                std::string name(buffer.data(), length);
+                const GLint location = glGetUniformLocation(ID, name.c_str());
+                if (location < 0)
+                    continue;
+                entries.push_back({UniformHash(name), location, size});
+                if (name.size() < 3 || name.compare(name.size() - 3, 3, "[0]") != 0)
+                    continue;
+                const std::string base = name.substr(0, name.size() - 3);
+                entries.push_back({UniformHash(base), location, size});
+                for (GLint element = 1; element < size; element++)
+                {
+                    const std::string elementName = base + "[" + std::to_string(element) + "]";
+                    const GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                    if (elementLocation >= 0)
+                        entries.push_back({UniformHash(elementName), elementLocation, size - element});
+                }
+            }
+            std::size_t capacity = 16;
+            while (capacity < entries.size() * 2)
+                capacity *= 2;
+            m_uniforms.assign(capacity, UniformSlot{});
+            const std::size_t mask = capacity - 1;
+            for (const auto &entry : entries)
+            {
+                std::size_t index = entry.hash & mask;
+                while (m_uniforms[index].hash != 0 && m_uniforms[index].hash != entry.hash)
+                    index = (index + 1) & mask;
+                m_uniforms[index] = entry;
+            }
+        }
+        struct UniformSlot
+        {
+            std::uint64_t hash = 0;
+            GLint location = -1;
+            GLint size = 0;
+
+            GLsizei clamp(std::size_t count) const noexcept { return static_cast<GLsizei>(std::min<std::size_t>(count, static_cast<std::size_t>(size))); }
+        };
+        const UniformSlot *findUniform(std::uint64_t hash) const noexcept
+        {
+            if (m_uniforms.empty())
+                return nullptr;
+            const std::size_t mask = m_uniforms.size() - 1;
+            for (std::size_t index = hash & mask;; index = (index + 1) & mask)
+            {
+                const UniformSlot &slot = m_uniforms[index];
+                if (slot.hash == hash)
+                    return &slot;
+                if (slot.hash == 0)
+                    return nullptr;
+            }
+        }
+        static inline std::string s_globalDefines;
+        std::vector<UniformSlot> m_uniforms;
     };
 
     inline size_t Typesize(GLenum type)
@@ -8,6 +8,7 @@
 #include "Shader.h"
 #include "filesystem.h"
 #include "Framebuffer.h"
+#include "ResourceTracker.h"
 namespace Renderer
 {
     class Skybox
@@ -20,27 +21,43 @@ namespace Renderer
         ~Skybox()
         {
             std::cout << "Skybox destructor called" << std::endl;
+            auto &tracker = ResourceTracker::GetInstance();
             // 删除hdr纹理
             if (m_isHdrTexture)
+            {
                 glDeleteTextures(1, &m_hdrTexture);
+                tracker.Release(ResourceKind::Texture, m_hdrTexture);
+            }
             // 删除环境贴图
             if (m_isEnvCubemap)
+            {
                 glDeleteTextures(1, &m_envCubeMap);
+                tracker.Release(ResourceKind::Texture, m_envCubeMap);
+            }
             // 删除辐照度贴图
             if (m_isIrradianceMap)
+            {
                 glDeleteTextures(1, &m_irradianceMap);
+                tracker.Release(ResourceKind::Texture, m_irradianceMap);
+            }
             // 删除预过滤贴图
             if (m_isPrefilterMap)
+            {
                 glDeleteTextures(1, &m_prefilterMap);
+                tracker.Release(ResourceKind::Texture, m_prefilterMap);
+            }
             // 删除BRDF LUT贴图
             if (m_isBrdfLUT)
+            {
                 glDeleteTextures(1, &m_brdfLUT);
+                tracker.Release(ResourceKind::Texture, m_brdfLUT);
+            }
         }
         void Load(const char *hdrPath, const std::size_t resolution, GLFWwindow *window);
-        void DrawSkybox(const glm::mat4 &view)
+        // view和projection来自FrameData uniform块
+        void DrawSkybox()
         {
             m_backgroundShader.use();
-            m_backgroundShader.setMat4("view", view);
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubeMap);
             // glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap); // display irradiance map
@@ -60,13 +77,6 @@ namespace Renderer
         GLuint createIrradiancemap(unsigned int size, GLFWwindow *window);
         GLuint createPrefilterMap(unsigned int baseMipSize, unsigned int maxMipLevel, GLFWwindow *window);
         GLuint createBrdfLUTMap(unsigned int size, GLFWwindow *window);
-        // 设置
-        void setProjection(glm::mat4 projection)
-        {
-            m_backgroundShader.use();
-            m_backgroundShader.setMat4("projection", projection);
-            m_backgroundShader.unuse();
-        }
         void setCubeMap(unsigned int size);
         void loadCubeMapFromHDR(unsigned int hdrTexture, unsigned int size, GLFWwindow *window);
         void loadCubemap(std::vector<std::string> faces);
@@ -87,6 +97,8 @@ namespace Renderer
 
         GLuint m_envCubeMap = 0;
         bool m_isEnvCubemap = false;
+        // 环境贴图的边长，生成mipmap之后重新登记显存占用时用
+        unsigned int m_envCubeSize = 0;
         GLuint m_irradianceMap = 0;
         bool m_isIrradianceMap = false;
         GLuint m_prefilterMap = 0;
@@ -134,6 +146,7 @@ namespace Renderer
     { // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
         glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubeMap);
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, m_envCubeMap, ResourceCategory::IBL, "Skybox.envCubeMap", TextureBytes(GL_RGB16F, m_envCubeSize, m_envCubeSize, true, 6));
         // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
         // --------------------------------------------------------------------------------
         unsigned int irradianceMap;
@@ -143,6 +156,7 @@ namespace Renderer
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, nullptr);
         }
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, irradianceMap, ResourceCategory::IBL, "Skybox.irradianceMap", TextureBytes(GL_RGB16F, size, size, false, 6));
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -212,6 +226,7 @@ namespace Renderer
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, prefilterMap, ResourceCategory::IBL, "Skybox.prefilterMap", TextureBytes(GL_RGB16F, baseMipSize, baseMipSize, true, 6));
 
         // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
         // ----------------------------------------------------------------------------------------------------
@@ -278,6 +293,7 @@ namespace Renderer
         // pre-allocate enough memory for the LUT texture.
         glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, size, size, 0, GL_RG, GL_FLOAT, 0);
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, brdfLUTTexture, ResourceCategory::IBL, "Skybox.brdfLUT", TextureBytes(GL_RG16F, size, size));
         // be sure to set wrapping mode to GL_CLAMP_TO_EDGE
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -317,6 +333,8 @@ namespace Renderer
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, nullptr);
         }
+        m_envCubeSize = size;
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, m_envCubeMap, ResourceCategory::IBL, "Skybox.envCubeMap", TextureBytes(GL_RGB16F, size, size, false, 6));
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -379,12 +397,14 @@ namespace Renderer
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
         int width, height, nrChannels;
+        std::uint64_t faceBytes = 0;
         for (unsigned int i = 0; i < faces.size(); i++)
         {
             unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
             if (data)
             {
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+                faceBytes += TextureBytes(GL_RGB, width, height);
                 stbi_image_free(data);
             }
             else
@@ -400,7 +420,9 @@ namespace Renderer
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
         glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, textureID, ResourceCategory::IBL, "Skybox.envCubeMap", faceBytes);
         m_envCubeMap = textureID;
+        m_envCubeSize = static_cast<unsigned int>(width);
         //
         std::cout << "envCubeMap:" << m_envCubeMap << std::endl;
         m_isEnvCubemap = true;
@@ -417,6 +439,7 @@ namespace Renderer
             glGenTextures(1, &hdrTexture);
             glBindTexture(GL_TEXTURE_2D, hdrTexture);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+            ResourceTracker::GetInstance().Track(ResourceKind::Texture, hdrTexture, ResourceCategory::IBL, std::string("Skybox.hdr:") + path, TextureBytes(GL_RGB16F, width, height));
 
             // 设置纹理环绕方式以及过滤方式
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -487,6 +510,7 @@ namespace Renderer
             // fill buffer
             glBindBuffer(GL_ARRAY_BUFFER, m_cubeVBO);
             glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_cubeVBO, ResourceCategory::MeshBuffer, "Skybox.cube", sizeof(vertices));
             // link vertex attributes
             glBindVertexArray(m_cubeVAO);
             glEnableVertexAttribArray(0);
@@ -539,6 +563,7 @@ namespace Renderer
             glBindVertexArray(quadVAO);
             glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
             glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, quadVBO, ResourceCategory::MeshBuffer, "Skybox.quad", sizeof(quadVertices));
             glEnableVertexAttribArray(0);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
             glEnableVertexAttribArray(1);
@@ -1,6 +1,11 @@
 #pragma once
 #include <glad/glad.h>
 #include <stb_image.h>
+
+#include "MaterialTextures.h"
+#include "Profiler.h"
+#include "ResourceTracker.h"
+#include "TextureCompressor.h"
 namespace Renderer
 {
     // 纹理类，一个纹理对象包含了一个纹理ID，一个纹理类型，一个纹理格式，宽高度，以及纹理数据
@@ -29,9 +34,11 @@ namespace Renderer
 
         ~Texture()
         {
-            if (loaded)
+            if (id != 0)
             {
+                MaterialTextures::GetInstance().Release(id);
                 glDeleteTextures(1, &id);
+                ResourceTracker::GetInstance().Release(ResourceKind::Texture, id);
                 std::cout << "Texture: " << path << " deleted" << std::endl;
             }
         };
@@ -41,6 +48,15 @@ namespace Renderer
         void TextureFromFile(const char *filepath, const std::string &directory, bool gammaCorrection = false);
 
     public:
+        // 上传解码后的图片并生成mipmap，pixels可以是内存指针，也可以是当前绑定的GL_PIXEL_UNPACK_BUFFER中的偏移
+        void UploadImage(int width, int height, int nrComponents, const void *pixels, bool gammaCorrection);
+        // 上传块压缩的mip链，base为nullptr时从当前绑定的GL_PIXEL_UNPACK_BUFFER读取(偏移即level.offset)
+        void UploadCompressed(const CompressedImage &image, const std::uint8_t *base);
+        // 同步读取(或生成)压缩缓存并上传
+        void LoadCompressed(const std::string &filepath, TextureCodec codec);
+        void LoadCompressed(const ImageSource &source, TextureCodec codec);
+        // 同步解码内存中的图片(内嵌纹理)并上传
+        void LoadFromMemory(const ImageSource &source, bool gammaCorrection = false);
         void SetTextureType(const std::string &type) { this->type = type; }
         unsigned int GetTextureID() const
         {
@@ -49,108 +65,161 @@ namespace Renderer
 #endif
             return id;
         }
-        unsigned int id;
+        // 纹理数据是否已经上传到显存(异步加载的纹理在此之前应该绑定占位纹理)
+        bool IsResident() const noexcept { return loaded; }
+        unsigned int id = 0;
         std::string type;
         std::string path;
         bool loaded = false;
+        // 估算的显存占用(包含mipmap链)，供TextureCache统计
+        std::size_t gpuBytes = 0;
     };
 
-    inline void Texture::LoadTexture(char const *filepath, bool gammaCorrection)
+    inline void Texture::UploadImage(int width, int height, int nrComponents, const void *pixels, bool gammaCorrection)
     {
-        this->path = filepath;
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char *data = stbi_load(filepath, &width, &height, &nrComponents, 0);
-        if (data)
+        GLenum internalFormat = GL_RGBA;
+        GLenum dataFormat = GL_RGBA;
+        if (nrComponents == 1)
         {
-            GLenum internalFormat;
-            GLenum dataFormat;
-            if (nrComponents == 1)
-            {
-                internalFormat = dataFormat = GL_RED;
-            }
-            else if (nrComponents == 3)
-            {
-                internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
-                dataFormat = GL_RGB;
-            }
-            else if (nrComponents == 4)
-            {
-                internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
-                dataFormat = GL_RGBA;
-            }
+            internalFormat = dataFormat = GL_RED;
+        }
+        else if (nrComponents == 2)
+        {
+            internalFormat = dataFormat = GL_RG;
+        }
+        else if (nrComponents == 3)
+        {
+            internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
+            dataFormat = GL_RGB;
+        }
+        else if (nrComponents == 4)
+        {
+            internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
+            dataFormat = GL_RGBA;
+        }
+        if (id == 0)
+            glGenTextures(1, &id);
 
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+        glBindTexture(GL_TEXTURE_2D, id);
+        // RGB图片每行不一定是4字节对齐的
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        {
+            ProfileScope scope("texture.upload", true);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        {
+            ProfileScope scope("texture.mipmap", true);
             glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
-            loaded = true;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // 驱动一般把RGB补齐成RGBA存储，包含完整的mipmap链
+        gpuBytes = static_cast<std::size_t>(TextureBytes(internalFormat, width, height, true));
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, id, ResourceCategory::Texture, path, gpuBytes);
+        loaded = true;
+    }
+    inline void Texture::UploadCompressed(const CompressedImage &image, const std::uint8_t *base)
+    {
+        ProfileScope scope("texture.upload", true);
+        if (id == 0)
+            glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+        GLenum internalFormat = TextureCompressor::InternalFormat(image.codec);
+        for (std::size_t level = 0; level < image.levels.size(); level++)
+        {
+            const auto &info = image.levels[level];
+            const void *data = base ? static_cast<const void *>(base + info.offset) : reinterpret_cast<const void *>(static_cast<std::uintptr_t>(info.offset));
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, info.width, info.height, 0, static_cast<GLsizei>(info.size), data);
         }
-        else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        gpuBytes = image.data.size();
+        ResourceTracker::GetInstance().Track(ResourceKind::Texture, id, ResourceCategory::Texture, path, gpuBytes);
+        loaded = true;
+    }
+    inline void Texture::LoadCompressed(const std::string &filepath, TextureCodec codec)
+    {
+        this->path = filepath;
+        CompressedImage image = TextureCompressor::LoadOrEncode(filepath, codec);
+        if (image.Empty())
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return;
+        }
+        UploadCompressed(image, image.data.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        std::cout << "Texture: " << path << " created (" << TextureCompressor::CodecName(codec) << ")" << std::endl;
+    }
+    inline void Texture::LoadCompressed(const ImageSource &source, TextureCodec codec)
+    {
+        this->path = source.name;
+        CompressedImage image = TextureCompressor::LoadOrEncode(source, codec);
+        if (image.Empty())
         {
             std::cout << "Texture failed to load at path: " << path << std::endl;
+            return;
+        }
+        UploadCompressed(image, image.data.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        std::cout << "Texture: " << path << " created (" << TextureCompressor::CodecName(codec) << ")" << std::endl;
+    }
+    inline void Texture::LoadFromMemory(const ImageSource &source, bool gammaCorrection)
+    {
+        this->path = source.name;
+        if (source.IsRaw())
+        {
+            UploadImage(source.width, source.height, 4, source.data, gammaCorrection);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return;
+        }
+        int width, height, nrComponents;
+        unsigned char *data = nullptr;
+        if (!source.Empty())
+        {
+            ProfileScope scope("texture.decode");
+            data = stbi_load_from_memory(source.data, static_cast<int>(source.size), &width, &height, &nrComponents, 0);
+        }
+        if (data)
+        {
+            UploadImage(width, height, nrComponents, data, gammaCorrection);
+            glBindTexture(GL_TEXTURE_2D, 0);
             stbi_image_free(data);
-            glDeleteTextures(1, &textureID);
         }
-
-        id = textureID;
+        else
+            std::cout << "Texture failed to load from memory: " << path << std::endl;
     }
-    inline void Texture::TextureFromFile(const char *filepath, const std::string &directory, bool gammaCorrection)
+    inline void Texture::LoadTexture(char const *filepath, bool gammaCorrection)
     {
-        std::string filename = std::string(filepath);
-        filename = directory + '/' + filename;
-        path = filename;
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
+        this->path = filepath;
 
         int width, height, nrComponents;
-        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+        unsigned char *data = nullptr;
+        {
+            ProfileScope scope("texture.decode");
+            data = stbi_load(filepath, &width, &height, &nrComponents, 0);
+        }
         if (data)
         {
-            GLenum internalFormat;
-            GLenum dataFormat;
-            if (nrComponents == 1)
-            {
-                internalFormat = dataFormat = GL_RED;
-            }
-            else if (nrComponents == 3)
-            {
-                internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
-                dataFormat = GL_RGB;
-            }
-            else if (nrComponents == 4)
-            {
-                internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
-                dataFormat = GL_RGBA;
-            }
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
+            UploadImage(width, height, nrComponents, data, gammaCorrection);
             stbi_image_free(data);
-            loaded = true;
         }
         else
         {
             std::cout << "Texture failed to load at path: " << path << std::endl;
             stbi_image_free(data);
-            glDeleteTextures(1, &textureID);
         }
-
-        id = textureID;
     }
-}
\ No newline at end of file
+    inline void Texture::TextureFromFile(const char *filepath, const std::string &directory, bool gammaCorrection)
+    {
+        std::string filename = std::string(filepath);
+        filename = directory + '/' + filename;
+        LoadTexture(filename.c_str(), gammaCorrection);
+    }
+}
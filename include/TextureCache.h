@@ -0,0 +1,155 @@
+#pragma once
+// 进程全局的纹理注册表：按(规范化路径, 颜色空间)查找，多个模型共享同一个纹理对象
+// 注册表只持有weak_ptr，最后一个使用者释放时Texture析构，显存随之释放
+#include "Texture.h"
+#include "TextureCompressor.h"
+#include "TextureStreamer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Renderer
+{
+    enum class ColorSpace
+    {
+        Linear,
+        sRGB
+    };
+
+    class TextureCache
+    {
+        TextureCache() = default;
+        ~TextureCache() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static TextureCache instance{};
+            return instance;
+        }
+        TextureCache(const TextureCache &) = delete;
+        TextureCache &operator=(const TextureCache &) = delete;
+
+        struct Stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::size_t liveTextures = 0;
+            std::size_t residentTextures = 0;
+            std::size_t residentBytes = 0;
+        };
+
+        // 返回filepath对应的纹理，已经存在就直接共享，否则新建(async为true时交给TextureStreamer异步加载)
+        // codec不为None时上传块压缩格式，同一张图片的压缩版本和未压缩版本是两个不同的纹理
+        std::shared_ptr<Texture> Acquire(const std::string &filepath, const std::string &directory, ColorSpace colorSpace, bool async = true, TextureCodec codec = TextureCodec::None)
+        {
+            std::string key = MakeKey(directory + '/' + filepath, colorSpace, codec);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_textures.find(key);
+            if (iter != m_textures.end())
+            {
+                if (auto texture = iter->second.lock())
+                {
+                    m_hits++;
+                    return texture;
+                }
+            }
+            m_misses++;
+            bool gammaCorrection = colorSpace == ColorSpace::sRGB;
+            std::shared_ptr<Texture> texture;
+            if (async)
+                texture = TextureStreamer::GetInstance().Load(filepath, directory, gammaCorrection, codec);
+            else if (codec != TextureCodec::None)
+            {
+                texture = std::make_shared<Texture>();
+                texture->LoadCompressed(directory + '/' + filepath, codec);
+            }
+            else
+                texture = std::make_shared<Texture>(filepath.c_str(), directory, gammaCorrection);
+            m_textures[key] = texture;
+            return texture;
+        }
+
+        // 内存中的图片(glb/data URI/Assimp内嵌纹理)，以source.name作为键
+        std::shared_ptr<Texture> Acquire(const ImageSource &source, ColorSpace colorSpace, bool async = true, TextureCodec codec = TextureCodec::None)
+        {
+            std::string key = MakeKey(source.name, colorSpace, codec);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_textures.find(key);
+            if (iter != m_textures.end())
+            {
+                if (auto texture = iter->second.lock())
+                {
+                    m_hits++;
+                    return texture;
+                }
+            }
+            m_misses++;
+            bool gammaCorrection = colorSpace == ColorSpace::sRGB;
+            std::shared_ptr<Texture> texture;
+            if (async)
+                texture = TextureStreamer::GetInstance().Load(source, gammaCorrection, codec);
+            else
+            {
+                texture = std::make_shared<Texture>();
+                if (codec != TextureCodec::None)
+                    texture->LoadCompressed(source, codec);
+                else
+                    texture->LoadFromMemory(source, gammaCorrection);
+            }
+            m_textures[key] = texture;
+            return texture;
+        }
+
+        // 统计命中/未命中次数以及当前驻留显存的纹理大小，顺便清理已经释放的条目
+        Stats GetStats()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Stats stats;
+            stats.hits = m_hits;
+            stats.misses = m_misses;
+            for (auto iter = m_textures.begin(); iter != m_textures.end();)
+            {
+                auto texture = iter->second.lock();
+                if (!texture)
+                {
+                    iter = m_textures.erase(iter);
+                    continue;
+                }
+                stats.liveTextures++;
+                if (texture->IsResident())
+                {
+                    stats.residentTextures++;
+                    stats.residentBytes += texture->gpuBytes;
+                }
+                ++iter;
+            }
+            return stats;
+        }
+        void ResetCounters()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hits = m_misses = 0;
+        }
+
+    private:
+        static std::string MakeKey(const std::string &path, ColorSpace colorSpace, TextureCodec codec)
+        {
+            std::error_code ec;
+            auto canonical = std::filesystem::weakly_canonical(std::filesystem::path(path), ec);
+            std::string key = ec ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+            key += colorSpace == ColorSpace::sRGB ? "|srgb|" : "|linear|";
+            key += TextureCompressor::CodecName(codec);
+            return key;
+        }
+
+        std::mutex m_mutex;
+        std::unordered_map<std::string, std::weak_ptr<Texture>> m_textures;
+        std::uint64_t m_hits = 0;
+        std::uint64_t m_misses = 0;
+    };
+}
@@ -0,0 +1,577 @@
+#pragma once
+// 材质纹理的块压缩(BC7/BC5)，编码完全在CPU上完成，不需要GL上下文
+// 颜色类贴图(albedo/emissive)编码为sRGB BC7，法线贴图编码为BC5(只存xy，shader里重建z)，ORM等线性数据编码为BC7
+// 编码结果连同预先生成的mipmap一起写入源图片旁边的缓存文件(*.texcache)，布局参照KTX2：文件头 | 每级mip的索引 | 各级数据
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "ImageSource.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Renderer
+{
+    enum class TextureCodec : std::uint32_t
+    {
+        None = 0,
+        BC7 = 1,
+        BC7_sRGB = 2,
+        BC5 = 3
+    };
+
+    struct CompressedLevel
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // 压缩后的整条mip链，所有级别连续存放在data里
+    struct CompressedImage
+    {
+        TextureCodec codec = TextureCodec::None;
+        std::vector<CompressedLevel> levels;
+        std::vector<std::uint8_t> data;
+
+        bool Empty() const noexcept { return levels.empty(); }
+    };
+
+    constexpr std::uint32_t kTextureCacheMagic = 0x43544250; // "PBTC"
+    constexpr std::uint32_t kTextureCacheVersion = 1;
+
+    struct TextureCacheHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint32_t codec;
+        std::uint32_t glInternalFormat;
+        std::uint32_t pixelWidth;
+        std::uint32_t pixelHeight;
+        std::uint32_t levelCount;
+        std::uint32_t reserved;
+    };
+
+    struct TextureCacheLevelIndex
+    {
+        std::uint64_t byteOffset;
+        std::uint64_t byteLength;
+    };
+
+    class TextureCompressor
+    {
+    public:
+        static GLenum InternalFormat(TextureCodec codec)
+        {
+            switch (codec)
+            {
+            case TextureCodec::BC7:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            case TextureCodec::BC7_sRGB:
+                return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+            case TextureCodec::BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            default:
+                return 0;
+            }
+        }
+        static const char *CodecName(TextureCodec codec)
+        {
+            switch (codec)
+            {
+            case TextureCodec::BC7:
+                return "bc7";
+            case TextureCodec::BC7_sRGB:
+                return "bc7srgb";
+            case TextureCodec::BC5:
+                return "bc5";
+            default:
+                return "none";
+            }
+        }
+        static std::string CachePathFor(const std::string &sourcePath, TextureCodec codec)
+        {
+            return sourcePath + '.' + CodecName(codec) + ".texcache";
+        }
+
+        // 读取源图片对应的压缩缓存，缓存不存在或已过期时解码源图片重新编码并写回缓存
+        // 在解码线程中调用，失败时返回空的CompressedImage
+        static CompressedImage LoadOrEncode(const std::string &sourcePath, TextureCodec codec)
+        {
+            ModelLoader::MappedFile source(sourcePath);
+            if (!source.IsOpen())
+                return CompressedImage();
+            ImageSource image;
+            image.name = sourcePath;
+            image.data = source.Data();
+            image.size = source.Size();
+            return LoadOrEncode(image, codec);
+        }
+        // 内存中的图片(内嵌纹理)，压缩缓存写在source.name旁边，以图片内容的哈希校验
+        static CompressedImage LoadOrEncode(const ImageSource &source, TextureCodec codec)
+        {
+            CompressedImage image;
+            if (source.Empty())
+                return image;
+            std::uint64_t sourceHash = ModelLoader::HashBytes(source.data, source.size);
+            std::string cachePath = CachePathFor(source.name, codec);
+            {
+                ProfileScope scope("texture.cache_read");
+                if (Read(cachePath, sourceHash, codec, image))
+                    return image;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            if (source.IsRaw())
+            {
+                ProfileScope scope("texture.encode");
+                image = Encode(source.data, source.width, source.height, codec);
+            }
+            else
+            {
+                int width, height, nrComponents;
+                unsigned char *pixels = nullptr;
+                {
+                    ProfileScope scope("texture.decode");
+                    pixels = stbi_load_from_memory(source.data, static_cast<int>(source.size), &width, &height, &nrComponents, 4);
+                }
+                if (!pixels)
+                    return image;
+                {
+                    ProfileScope scope("texture.encode");
+                    image = Encode(pixels, width, height, codec);
+                }
+                stbi_image_free(pixels);
+            }
+            std::cout << "TextureCompressor: encoded " << source.name << " to " << CodecName(codec) << " in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+            ProfileScope scope("texture.cache_write");
+            Write(cachePath, sourceHash, image);
+            return image;
+        }
+
+        // 把RGBA8图片编码成完整的mip链
+        static CompressedImage Encode(const std::uint8_t *rgba, int width, int height, TextureCodec codec)
+        {
+            CompressedImage image;
+            image.codec = codec;
+            std::vector<std::uint8_t> level(rgba, rgba + static_cast<std::size_t>(width) * height * 4);
+            while (true)
+            {
+                std::size_t blocksX = (width + 3) / 4;
+                std::size_t blocksY = (height + 3) / 4;
+                CompressedLevel info{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), image.data.size(), blocksX * blocksY * 16};
+                image.data.resize(image.data.size() + info.size);
+                std::uint8_t *out = image.data.data() + info.offset;
+                std::uint8_t block[64];
+                for (std::size_t by = 0; by < blocksY; by++)
+                {
+                    for (std::size_t bx = 0; bx < blocksX; bx++, out += 16)
+                    {
+                        // 图片尺寸不是4的倍数时复制边缘像素补齐
+                        for (int y = 0; y < 4; y++)
+                        {
+                            for (int x = 0; x < 4; x++)
+                            {
+                                std::size_t sx = std::min<std::size_t>(bx * 4 + x, width - 1);
+                                std::size_t sy = std::min<std::size_t>(by * 4 + y, height - 1);
+                                std::memcpy(block + (y * 4 + x) * 4, level.data() + (sy * width + sx) * 4, 4);
+                            }
+                        }
+                        if (codec == TextureCodec::BC5)
+                            EncodeBC5Block(block, out);
+                        else
+                            EncodeBC7Block(block, out);
+                    }
+                }
+                image.levels.push_back(info);
+                if (width == 1 && height == 1)
+                    break;
+                level = Downsample(level, width, height, codec);
+                width = std::max(width / 2, 1);
+                height = std::max(height / 2, 1);
+            }
+            return image;
+        }
+
+        static bool Read(const std::string &cachePath, std::uint64_t sourceHash, TextureCodec codec, CompressedImage &image)
+        {
+            ModelLoader::MappedFile file(cachePath);
+            if (!file.IsOpen() || file.Size() < sizeof(TextureCacheHeader))
+                return false;
+            TextureCacheHeader header;
+            std::memcpy(&header, file.Data(), sizeof(header));
+            if (header.magic != kTextureCacheMagic || header.version != kTextureCacheVersion ||
+                header.sourceHash != sourceHash || header.codec != static_cast<std::uint32_t>(codec) || header.levelCount == 0 ||
+                sizeof(TextureCacheHeader) + std::uint64_t(header.levelCount) * sizeof(TextureCacheLevelIndex) > file.Size())
+                return false;
+            const auto *index = reinterpret_cast<const TextureCacheLevelIndex *>(file.Data() + sizeof(TextureCacheHeader));
+            std::uint64_t dataBegin = index[0].byteOffset;
+            std::uint64_t dataEnd = dataBegin;
+            image.codec = codec;
+            image.levels.clear();
+            std::uint32_t width = header.pixelWidth;
+            std::uint32_t height = header.pixelHeight;
+            for (std::uint32_t i = 0; i < header.levelCount; i++)
+            {
+                // 各级数据必须连续存放且不越界
+                if (index[i].byteOffset != dataEnd || index[i].byteLength > file.Size() - index[i].byteOffset ||
+                    index[i].byteLength != std::uint64_t((width + 3) / 4) * ((height + 3) / 4) * 16)
+                    return false;
+                image.levels.push_back({width, height, dataEnd - dataBegin, index[i].byteLength});
+                dataEnd += index[i].byteLength;
+                width = std::max(width / 2, 1u);
+                height = std::max(height / 2, 1u);
+            }
+            image.data.assign(file.Data() + dataBegin, file.Data() + dataEnd);
+            return true;
+        }
+
+        // 和网格缓存一样先写临时文件再重命名
+        static bool Write(const std::string &cachePath, std::uint64_t sourceHash, const CompressedImage &image)
+        {
+            if (image.Empty())
+                return false;
+            TextureCacheHeader header{};
+            header.magic = kTextureCacheMagic;
+            header.version = kTextureCacheVersion;
+            header.sourceHash = sourceHash;
+            header.codec = static_cast<std::uint32_t>(image.codec);
+            header.glInternalFormat = InternalFormat(image.codec);
+            header.pixelWidth = image.levels[0].width;
+            header.pixelHeight = image.levels[0].height;
+            header.levelCount = static_cast<std::uint32_t>(image.levels.size());
+            std::uint64_t dataBegin = sizeof(TextureCacheHeader) + image.levels.size() * sizeof(TextureCacheLevelIndex);
+            std::vector<TextureCacheLevelIndex> index;
+            for (const auto &level : image.levels)
+                index.push_back({dataBegin + level.offset, level.size});
+
+            std::string tmpPath = cachePath + ".tmp";
+            {
+                std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(TextureCacheLevelIndex));
+                out.write(reinterpret_cast<const char *>(image.data.data()), image.data.size());
+                if (!out)
+                {
+                    std::cout << "TextureCompressor: failed to write " << tmpPath << std::endl;
+                    return false;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmpPath, cachePath, ec);
+            if (ec)
+            {
+                std::cout << "TextureCompressor: failed to rename " << tmpPath << ": " << ec.message() << std::endl;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+            return true;
+        }
+
+        // BC7 mode 6：单分区，RGBA端点各7位+每端点1个p位，4位索引
+        // 端点取主成分方向上的投影极值，再用最小二乘按索引重新拟合一次
+        static void EncodeBC7Block(const std::uint8_t pixels[64], std::uint8_t out[16])
+        {
+            float mean[4] = {};
+            float lo[4] = {255, 255, 255, 255}, hi[4] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    mean[c] += pixels[i * 4 + c] / 16.0f;
+                    lo[c] = std::min<float>(lo[c], pixels[i * 4 + c]);
+                    hi[c] = std::max<float>(hi[c], pixels[i * 4 + c]);
+                }
+            }
+            float cov[4][4] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                float d[4];
+                for (int c = 0; c < 4; c++)
+                    d[c] = pixels[i * 4 + c] - mean[c];
+                for (int a = 0; a < 4; a++)
+                    for (int b = 0; b < 4; b++)
+                        cov[a][b] += d[a] * d[b];
+            }
+            // 幂迭代求主轴，初值用包围盒对角线
+            float axis[4];
+            for (int c = 0; c < 4; c++)
+                axis[c] = hi[c] - lo[c];
+            for (int iter = 0; iter < 8; iter++)
+            {
+                float next[4] = {};
+                for (int a = 0; a < 4; a++)
+                    for (int b = 0; b < 4; b++)
+                        next[a] += cov[a][b] * axis[b];
+                float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+                if (length < 1e-6f)
+                    break;
+                for (int c = 0; c < 4; c++)
+                    axis[c] = next[c] / length;
+            }
+            float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+            float tMin = 0.0f, tMax = 0.0f;
+            if (axisLength > 1e-6f)
+            {
+                for (int c = 0; c < 4; c++)
+                    axis[c] /= axisLength;
+                tMin = 1e30f;
+                tMax = -1e30f;
+                for (int i = 0; i < 16; i++)
+                {
+                    float t = 0.0f;
+                    for (int c = 0; c < 4; c++)
+                        t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+                    tMin = std::min(tMin, t);
+                    tMax = std::max(tMax, t);
+                }
+            }
+            float e0[4], e1[4];
+            for (int c = 0; c < 4; c++)
+            {
+                e0[c] = mean[c] + tMin * axis[c];
+                e1[c] = mean[c] + tMax * axis[c];
+            }
+
+            BC7Mode6 best = FitBC7Mode6(pixels, e0, e1);
+            // 按当前索引做最小二乘重新求端点
+            float w00 = 0, w01 = 0, w11 = 0, x0[4] = {}, x1[4] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                float w = kBC7Weights4[best.indices[i]] / 64.0f;
+                w00 += (1 - w) * (1 - w);
+                w01 += (1 - w) * w;
+                w11 += w * w;
+                for (int c = 0; c < 4; c++)
+                {
+                    x0[c] += (1 - w) * pixels[i * 4 + c];
+                    x1[c] += w * pixels[i * 4 + c];
+                }
+            }
+            float det = w00 * w11 - w01 * w01;
+            if (std::abs(det) > 1e-6f)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    e0[c] = (w11 * x0[c] - w01 * x1[c]) / det;
+                    e1[c] = (w00 * x1[c] - w01 * x0[c]) / det;
+                }
+                BC7Mode6 refined = FitBC7Mode6(pixels, e0, e1);
+                if (refined.error < best.error)
+                    best = refined;
+            }
+
+            // 第一个像素的索引最高位是隐含的0，不满足时交换两个端点
+            if (best.indices[0] & 8)
+            {
+                for (int c = 0; c < 4; c++)
+                    std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+                std::swap(best.pbits[0], best.pbits[1]);
+                for (int i = 0; i < 16; i++)
+                    best.indices[i] = 15 - best.indices[i];
+            }
+
+            BitWriter writer(out);
+            writer.Write(1u << 6, 7);
+            for (int c = 0; c < 4; c++)
+            {
+                writer.Write(best.endpoints[0][c], 7);
+                writer.Write(best.endpoints[1][c], 7);
+            }
+            writer.Write(best.pbits[0], 1);
+            writer.Write(best.pbits[1], 1);
+            writer.Write(best.indices[0], 3);
+            for (int i = 1; i < 16; i++)
+                writer.Write(best.indices[i], 4);
+        }
+
+        // BC5 = R、G两个通道各一个BC4块
+        static void EncodeBC5Block(const std::uint8_t pixels[64], std::uint8_t out[16])
+        {
+            EncodeBC4Block(pixels + 0, out);
+            EncodeBC4Block(pixels + 1, out + 8);
+        }
+
+        // channel指向第一个像素的某个通道，像素之间间隔4字节
+        static void EncodeBC4Block(const std::uint8_t *channel, std::uint8_t out[8])
+        {
+            int lo = 255, hi = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                lo = std::min<int>(lo, channel[i * 4]);
+                hi = std::max<int>(hi, channel[i * 4]);
+            }
+            // r0 > r1时是8级插值模式
+            int palette[8] = {hi, lo};
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * hi + (i - 1) * lo + 3) / 7;
+            out[0] = static_cast<std::uint8_t>(hi);
+            out[1] = static_cast<std::uint8_t>(lo);
+            std::uint64_t bits = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                int bestIndex = 0;
+                int bestError = 256;
+                if (hi != lo)
+                {
+                    for (int j = 0; j < 8; j++)
+                    {
+                        int error = std::abs(palette[j] - channel[i * 4]);
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            bestIndex = j;
+                        }
+                    }
+                }
+                bits |= std::uint64_t(bestIndex) << (i * 3);
+            }
+            for (int i = 0; i < 6; i++)
+                out[2 + i] = static_cast<std::uint8_t>(bits >> (i * 8));
+        }
+
+    private:
+        static constexpr int kBC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        struct BC7Mode6
+        {
+            std::uint8_t endpoints[2][4];
+            std::uint8_t pbits[2];
+            std::uint8_t indices[16];
+            int error = 0x7fffffff;
+        };
+
+        // 尝试4种p位组合，量化端点并为每个像素选最近的插值颜色
+        static BC7Mode6 FitBC7Mode6(const std::uint8_t pixels[64], const float e0[4], const float e1[4])
+        {
+            BC7Mode6 best;
+            for (int p0 = 0; p0 < 2; p0++)
+            {
+                for (int p1 = 0; p1 < 2; p1++)
+                {
+                    BC7Mode6 candidate;
+                    candidate.pbits[0] = static_cast<std::uint8_t>(p0);
+                    candidate.pbits[1] = static_cast<std::uint8_t>(p1);
+                    int palette[16][4];
+                    int full[2][4];
+                    for (int c = 0; c < 4; c++)
+                    {
+                        candidate.endpoints[0][c] = static_cast<std::uint8_t>(std::clamp<int>(static_cast<int>(std::lround((e0[c] - p0) / 2.0f)), 0, 127));
+                        candidate.endpoints[1][c] = static_cast<std::uint8_t>(std::clamp<int>(static_cast<int>(std::lround((e1[c] - p1) / 2.0f)), 0, 127));
+                        full[0][c] = (candidate.endpoints[0][c] << 1) | p0;
+                        full[1][c] = (candidate.endpoints[1][c] << 1) | p1;
+                    }
+                    for (int j = 0; j < 16; j++)
+                        for (int c = 0; c < 4; c++)
+                            palette[j][c] = ((64 - kBC7Weights4[j]) * full[0][c] + kBC7Weights4[j] * full[1][c] + 32) >> 6;
+                    candidate.error = 0;
+                    for (int i = 0; i < 16; i++)
+                    {
+                        int bestIndex = 0;
+                        int bestError = 0x7fffffff;
+                        for (int j = 0; j < 16; j++)
+                        {
+                            int error = 0;
+                            for (int c = 0; c < 4; c++)
+                            {
+                                int d = palette[j][c] - pixels[i * 4 + c];
+                                error += d * d;
+                            }
+                            if (error < bestError)
+                            {
+                                bestError = error;
+                                bestIndex = j;
+                            }
+                        }
+                        candidate.indices[i] = static_cast<std::uint8_t>(bestIndex);
+                        candidate.error += bestError;
+                    }
+                    if (candidate.error < best.error)
+                        best = candidate;
+                }
+            }
+            return best;
+        }
+
+        struct BitWriter
+        {
+            std::uint8_t *out;
+            int position = 0;
+            explicit BitWriter(std::uint8_t *out) : out(out) { std::memset(out, 0, 16); }
+            void Write(std::uint32_t value, int bits)
+            {
+                for (int i = 0; i < bits; i++, position++)
+                    out[position >> 3] |= static_cast<std::uint8_t>(((value >> i) & 1u) << (position & 7));
+            }
+        };
+
+        static float SRGBToLinear(float c)
+        {
+            return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        static float LinearToSRGB(float c)
+        {
+            return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        }
+
+        // 2x2盒式滤波生成下一级mip：sRGB在线性空间平均，法线平均后重新归一化
+        static std::vector<std::uint8_t> Downsample(const std::vector<std::uint8_t> &src, int width, int height, TextureCodec codec)
+        {
+            int dstWidth = std::max(width / 2, 1);
+            int dstHeight = std::max(height / 2, 1);
+            std::vector<std::uint8_t> dst(static_cast<std::size_t>(dstWidth) * dstHeight * 4);
+            for (int y = 0; y < dstHeight; y++)
+            {
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    const std::uint8_t *samples[4] = {
+                        &src[(static_cast<std::size_t>(std::min(2 * y, height - 1)) * width + std::min(2 * x, width - 1)) * 4],
+                        &src[(static_cast<std::size_t>(std::min(2 * y, height - 1)) * width + std::min(2 * x + 1, width - 1)) * 4],
+                        &src[(static_cast<std::size_t>(std::min(2 * y + 1, height - 1)) * width + std::min(2 * x, width - 1)) * 4],
+                        &src[(static_cast<std::size_t>(std::min(2 * y + 1, height - 1)) * width + std::min(2 * x + 1, width - 1)) * 4]};
+                    float sum[4] = {};
+                    for (const auto *sample : samples)
+                    {
+                        for (int c = 0; c < 4; c++)
+                        {
+                            float value = sample[c] / 255.0f;
+                            if (codec == TextureCodec::BC7_sRGB && c < 3)
+                                value = SRGBToLinear(value);
+                            else if (codec == TextureCodec::BC5 && c < 3)
+                                value = value * 2.0f - 1.0f;
+                            sum[c] += value * 0.25f;
+                        }
+                    }
+                    if (codec == TextureCodec::BC5)
+                    {
+                        float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                        for (int c = 0; c < 3; c++)
+                            sum[c] = length > 1e-6f ? (sum[c] / length) * 0.5f + 0.5f : 0.5f;
+                    }
+                    else if (codec == TextureCodec::BC7_sRGB)
+                    {
+                        for (int c = 0; c < 3; c++)
+                            sum[c] = LinearToSRGB(sum[c]);
+                    }
+                    std::uint8_t *out = &dst[(static_cast<std::size_t>(y) * dstWidth + x) * 4];
+                    for (int c = 0; c < 4; c++)
+                        out[c] = static_cast<std::uint8_t>(std::clamp(std::lround(sum[c] * 255.0f), 0l, 255l));
+                }
+            }
+            return dst;
+        }
+    };
+}
@@ -0,0 +1,291 @@
+#pragma once
+// 异步纹理加载：图片在解码线程池里用stb_image解码，解码完成后交给GL线程通过PBO上传
+// 纹理上传完成之前，绘制时绑定1x1的占位纹理
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "ResourceTracker.h"
+#include "Texture.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Renderer
+{
+    class TextureStreamer
+    {
+        TextureStreamer() = default;
+        // 解码线程在静态析构时才退出，这时GL上下文已经销毁，所以这里不释放任何GL对象
+        ~TextureStreamer() = default;
+
+    public:
+        static auto &GetInstance()
+        {
+            static TextureStreamer instance{};
+            return instance;
+        }
+        TextureStreamer(const TextureStreamer &) = delete;
+        TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+        // 创建一个纹理并把解码任务放入解码线程池，返回的纹理在Update上传之前不驻留显存
+        // codec不为None时在解码线程里读取(或编码生成)块压缩缓存，上传压缩后的mip链
+        std::shared_ptr<Texture> Load(const std::string &filepath, const std::string &directory, bool gammaCorrection = false, TextureCodec codec = TextureCodec::None)
+        {
+            auto texture = std::make_shared<Texture>();
+            texture->path = directory + '/' + filepath;
+            std::weak_ptr<Texture> target = texture;
+            std::string path = texture->path;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending++;
+            }
+            m_decodePool.Submit([this, target, path, gammaCorrection, codec]
+                                {
+                                    DecodedImage image;
+                                    image.target = target;
+                                    image.path = path;
+                                    image.gammaCorrection = gammaCorrection;
+                                    // 纹理在解码前就已经被释放的话就不用再解码了
+                                    if (!target.expired())
+                                    {
+                                        if (codec != TextureCodec::None)
+                                            image.compressed = TextureCompressor::LoadOrEncode(path, codec);
+                                        else
+                                        {
+                                            ProfileScope scope("texture.decode");
+                                            image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+                                            image.TrackPixels();
+                                        }
+                                    }
+                                    std::lock_guard<std::mutex> lock(m_mutex);
+                                    m_decoded.push_back(std::move(image)); });
+            return texture;
+        }
+
+        // 在GL线程每帧调用：上传已经解码完成的图片，单帧上传耗时不超过budgetMs(至少上传一张)
+        void Update(double budgetMs = 4.0)
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (true)
+            {
+                DecodedImage image;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (m_decoded.empty())
+                        break;
+                    image = std::move(m_decoded.front());
+                    m_decoded.pop_front();
+                }
+                Upload(image);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_pending--;
+                }
+                if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+                    break;
+            }
+        }
+
+        // 内存中的图片(内嵌纹理)：解码线程直接从source.data解码，source.owner保证数据在解码完成前有效
+        std::shared_ptr<Texture> Load(const ImageSource &source, bool gammaCorrection = false, TextureCodec codec = TextureCodec::None)
+        {
+            auto texture = std::make_shared<Texture>();
+            texture->path = source.name;
+            std::weak_ptr<Texture> target = texture;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending++;
+            }
+            m_decodePool.Submit([this, target, source, gammaCorrection, codec]
+                                {
+                                    DecodedImage image;
+                                    image.target = target;
+                                    image.path = source.name;
+                                    image.gammaCorrection = gammaCorrection;
+                                    if (!target.expired() && !source.Empty())
+                                    {
+                                        if (codec != TextureCodec::None)
+                                            image.compressed = TextureCompressor::LoadOrEncode(source, codec);
+                                        else if (source.IsRaw())
+                                        {
+                                            // 未压缩的像素不用解码，直接引用源数据
+                                            image.pixels = const_cast<unsigned char *>(source.data);
+                                            image.pixelOwner = source.owner;
+                                            image.width = source.width;
+                                            image.height = source.height;
+                                            image.nrComponents = 4;
+                                        }
+                                        else
+                                        {
+                                            ProfileScope scope("texture.decode");
+                                            image.pixels = stbi_load_from_memory(source.data, static_cast<int>(source.size), &image.width, &image.height, &image.nrComponents, 0);
+                                            image.TrackPixels();
+                                        }
+                                    }
+                                    std::lock_guard<std::mutex> lock(m_mutex);
+                                    m_decoded.push_back(std::move(image)); });
+            return texture;
+        }
+
+        // 阻塞直到所有已提交的纹理都上传完成(只能在GL线程调用)
+        void Flush()
+        {
+            while (PendingCount() > 0)
+            {
+                Update(1e9);
+                std::this_thread::yield();
+            }
+        }
+
+        std::size_t PendingCount()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_pending;
+        }
+
+        // 按纹理用途返回占位纹理：法线贴图用平坦法线，其余用白色
+        GLuint GetPlaceholder(const std::string &type)
+        {
+            if (type == "material.normalMap" || type == "material.texture_normal")
+                return GetPlaceholderTexture(m_flatNormalPlaceholder, 128, 128, 255);
+            return GetPlaceholderTexture(m_whitePlaceholder, 255, 255, 255);
+        }
+        // 纹理驻留时返回纹理本身，否则返回type用途对应的占位纹理
+        // (同一张纹理可能被不同网格用作不同用途，所以用途由调用方传入)
+        GLuint GetBindID(const Texture &texture, const std::string &type)
+        {
+            return texture.IsResident() ? texture.id : GetPlaceholder(type);
+        }
+
+    private:
+        struct DecodedImage
+        {
+            std::weak_ptr<Texture> target;
+            std::string path;
+            unsigned char *pixels = nullptr;
+            int width = 0;
+            int height = 0;
+            int nrComponents = 0;
+            bool gammaCorrection = false;
+            CompressedImage compressed;
+            // 不为空时pixels指向这里持有的源数据，不是stb_image分配的
+            std::shared_ptr<const void> pixelOwner;
+
+            // 解码出来的像素在上传之前一直占着内存，登记到HostImage
+            void TrackPixels()
+            {
+                if (pixels)
+                    ResourceTracker::GetInstance().TrackHost(pixels, ResourceCategory::HostImage, path, std::uint64_t(width) * height * nrComponents);
+            }
+            void FreePixels()
+            {
+                if (!pixelOwner && pixels)
+                {
+                    ResourceTracker::GetInstance().ReleaseHost(pixels);
+                    stbi_image_free(pixels);
+                }
+                pixels = nullptr;
+                pixelOwner.reset();
+            }
+        };
+
+        void Upload(DecodedImage &image)
+        {
+            auto texture = image.target.lock();
+            if (texture && !image.compressed.Empty())
+            {
+                UploadCompressed(*texture, image);
+                return;
+            }
+            if (!texture || !image.pixels)
+            {
+                if (texture)
+                    std::cout << "Texture failed to load at path: " << image.path << std::endl;
+                image.FreePixels();
+                return;
+            }
+            std::size_t size = static_cast<std::size_t>(image.width) * image.height * image.nrComponents;
+            if (m_pbo == 0)
+                glGenBuffers(1, &m_pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+            // 每次重新分配(orphan)PBO，驱动可以在上一次的传输还没完成时直接给一块新内存
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_pbo, ResourceCategory::Staging, "TextureStreamer.pbo", size);
+            void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (staging)
+            {
+                std::memcpy(staging, image.pixels, size);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                texture->UploadImage(image.width, image.height, image.nrComponents, nullptr, image.gammaCorrection);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            else
+            {
+                // 映射失败时退回到直接从内存上传
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                texture->UploadImage(image.width, image.height, image.nrComponents, image.pixels, image.gammaCorrection);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            image.FreePixels();
+            std::cout << "Texture: " << image.path << " created" << std::endl;
+        }
+
+        void UploadCompressed(Texture &texture, const DecodedImage &image)
+        {
+            const auto &compressed = image.compressed;
+            if (m_pbo == 0)
+                glGenBuffers(1, &m_pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, compressed.data.size(), nullptr, GL_STREAM_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, m_pbo, ResourceCategory::Staging, "TextureStreamer.pbo", compressed.data.size());
+            void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, compressed.data.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (staging)
+            {
+                std::memcpy(staging, compressed.data.data(), compressed.data.size());
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                texture.UploadCompressed(compressed, nullptr);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            else
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                texture.UploadCompressed(compressed, compressed.data.data());
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            std::cout << "Texture: " << image.path << " created (" << TextureCompressor::CodecName(compressed.codec) << ")" << std::endl;
+        }
+
+        GLuint GetPlaceholderTexture(GLuint &placeholder, unsigned char r, unsigned char g, unsigned char b)
+        {
+            if (placeholder == 0)
+            {
+                const unsigned char pixel[4] = {r, g, b, 255};
+                glGenTextures(1, &placeholder);
+                glBindTexture(GL_TEXTURE_2D, placeholder);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+                ResourceTracker::GetInstance().Track(ResourceKind::Texture, placeholder, ResourceCategory::Texture, "TextureStreamer.placeholder", 4);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            return placeholder;
+        }
+
+        std::mutex m_mutex;
+        std::deque<DecodedImage> m_decoded;
+        std::size_t m_pending = 0;
+        GLuint m_pbo = 0;
+        GLuint m_whitePlaceholder = 0;
+        GLuint m_flatNormalPlaceholder = 0;
+        // 解码专用线程池，和网格转换的线程池分开，解码大图时不会堵住网格转换
+        // 放在最后声明，析构时最先等待解码线程退出，再销毁它们用到的队列和锁
+        ThreadPool m_decodePool{ThreadPool::DefaultThreadCount()};
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+// 固定线程数的任务池，用于模型加载时的CPU端并行任务(网格转换、图片解码等)
+// 注意：任务里不能调用任何GL函数，GL上下文只在主线程
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Renderer
+{
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(std::size_t threadCount = DefaultThreadCount())
+        {
+            threadCount = std::max<std::size_t>(threadCount, 1);
+            m_workers.reserve(threadCount);
+            for (std::size_t i = 0; i < threadCount; i++)
+            {
+                m_workers.emplace_back([this]
+                                       { WorkerLoop(); });
+            }
+        }
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_condition.notify_all();
+            for (auto &worker : m_workers)
+                worker.join();
+        }
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // 进程共享的默认任务池
+        static ThreadPool &GetInstance()
+        {
+            static ThreadPool instance{};
+            return instance;
+        }
+        // 留一个核给GL线程
+        static std::size_t DefaultThreadCount()
+        {
+            auto count = std::thread::hardware_concurrency();
+            return count > 1 ? count - 1 : 1;
+        }
+
+        std::size_t ThreadCount() const noexcept { return m_workers.size(); }
+
+        template <typename Func>
+        auto Submit(Func &&func) -> std::future<std::invoke_result_t<Func>>
+        {
+            using Result = std::invoke_result_t<Func>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace([task]
+                                { (*task)(); });
+            }
+            m_condition.notify_one();
+            return future;
+        }
+
+    private:
+        void WorkerLoop()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condition.wait(lock, [this]
+                                     { return m_stop || !m_tasks.empty(); });
+                    if (m_stop && m_tasks.empty())
+                        return;
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stop = false;
+    };
+}
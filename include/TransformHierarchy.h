@@ -0,0 +1,193 @@
+#pragma once
+// 模型的节点层级：按父节点在前、子节点在后的顺序平铺，局部矩阵、世界矩阵、法线矩阵各自一个连续数组(SoA)
+// 修改局部矩阵只标记脏，Update时一次线性扫描把脏标记传给子树，只重新计算变化的节点
+// 世界矩阵和法线矩阵放在两个SSBO里(binding 1、2)，着色器按nodeIndex读取，每帧最多上传一次变化的区间
+#include <glad/glad.h>
+
+#include "Mesh.h"
+#include "ResourceTracker.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Renderer
+{
+    constexpr GLuint kNodeWorldBinding = 1;
+    constexpr GLuint kNodeNormalBinding = 2;
+
+    // std430下mat3的布局：三列，每列按vec4对齐
+    struct NormalMatrix
+    {
+        glm::vec4 columns[3];
+    };
+    static_assert(sizeof(NormalMatrix) == 48, "NormalMatrix must match the std430 mat3 layout");
+
+    class TransformHierarchy
+    {
+    public:
+        TransformHierarchy() = default;
+        ~TransformHierarchy()
+        {
+            auto &tracker = ResourceTracker::GetInstance();
+            for (GLuint buffer : {m_worldBuffer, m_normalBuffer})
+            {
+                if (!buffer)
+                    continue;
+                glDeleteBuffers(1, &buffer);
+                tracker.Release(ResourceKind::Buffer, buffer);
+            }
+        }
+        TransformHierarchy(const TransformHierarchy &) = delete;
+        TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+
+        // nodes要求父节点在子节点之前(loader按深度优先先序生成)，违反顺序的节点当作根节点
+        void Assign(const std::vector<ModelLoader::SceneNode> &nodes)
+        {
+            Clear();
+            for (const auto &node : nodes)
+                AddNode(node.parent, node.local);
+        }
+        void Clear()
+        {
+            m_parent.clear();
+            m_local.clear();
+            m_world.clear();
+            m_normal.clear();
+            m_dirty.clear();
+            m_anyDirty = false;
+            m_uploadBegin = m_uploadEnd = 0;
+        }
+        // 返回新节点的下标，parent必须是已经存在的节点(-1表示根节点)
+        std::uint32_t AddNode(std::int32_t parent, const glm::mat4 &local)
+        {
+            auto index = static_cast<std::uint32_t>(m_parent.size());
+            m_parent.push_back(parent >= 0 && static_cast<std::uint32_t>(parent) < index ? parent : -1);
+            m_local.push_back(local);
+            m_world.push_back(glm::mat4(1.0f));
+            m_normal.push_back(NormalMatrix{});
+            m_dirty.push_back(1);
+            m_anyDirty = true;
+            return index;
+        }
+
+        std::size_t Size() const noexcept { return m_parent.size(); }
+        std::int32_t Parent(std::uint32_t node) const { return m_parent[node]; }
+        const glm::mat4 &Local(std::uint32_t node) const { return m_local[node]; }
+        // Update之后才是最新的
+        const glm::mat4 &World(std::uint32_t node) const { return m_world[node]; }
+        const NormalMatrix &Normal(std::uint32_t node) const { return m_normal[node]; }
+        void SetLocal(std::uint32_t node, const glm::mat4 &local)
+        {
+            m_local[node] = local;
+            m_dirty[node] = 1;
+            m_anyDirty = true;
+        }
+
+        // 重新计算脏节点及其子树的世界矩阵和法线矩阵，没有变化时直接返回false
+        bool Update()
+        {
+            if (!m_anyDirty)
+                return false;
+            m_anyDirty = false;
+            const std::size_t count = m_parent.size();
+            // 父节点总在前面，一次顺序扫描就能把脏标记传到整个子树，同时收集要更新的节点
+            m_updateList.clear();
+            for (std::size_t i = 0; i < count; i++)
+            {
+                std::int32_t parent = m_parent[i];
+                m_dirty[i] |= parent >= 0 ? m_dirty[parent] : 0;
+                if (m_dirty[i])
+                    m_updateList.push_back(static_cast<std::uint32_t>(i));
+            }
+            if (m_updateList.empty())
+                return false;
+            for (auto i : m_updateList)
+            {
+                std::int32_t parent = m_parent[i];
+                m_world[i] = parent >= 0 ? m_world[parent] * m_local[i] : m_local[i];
+            }
+            // 法线矩阵互不依赖：逆转置 = 伴随矩阵/行列式，三列分别是另外两列的叉积，没有分支
+            for (auto i : m_updateList)
+            {
+                const glm::vec3 a(m_world[i][0]), b(m_world[i][1]), c(m_world[i][2]);
+                const glm::vec3 bc = glm::cross(b, c), ca = glm::cross(c, a), ab = glm::cross(a, b);
+                const float det = glm::dot(a, bc);
+                const float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+                m_normal[i].columns[0] = glm::vec4(bc * invDet, 0.0f);
+                m_normal[i].columns[1] = glm::vec4(ca * invDet, 0.0f);
+                m_normal[i].columns[2] = glm::vec4(ab * invDet, 0.0f);
+            }
+            for (auto i : m_updateList)
+                m_dirty[i] = 0;
+            // 列表按下标递增，变化的节点落在[front, back]区间内
+            std::size_t begin = m_updateList.front(), end = m_updateList.back() + 1;
+            if (m_uploadEnd > m_uploadBegin)
+            {
+                begin = std::min(begin, m_uploadBegin);
+                end = std::max(end, m_uploadEnd);
+            }
+            m_uploadBegin = begin;
+            m_uploadEnd = end;
+            return true;
+        }
+
+        // 在GL线程调用：把上次上传之后变化的区间写入SSBO，节点数增加时重新分配
+        void Upload()
+        {
+            Update();
+            const std::size_t count = m_parent.size();
+            if (count == 0)
+                return;
+            if (count > m_capacity)
+            {
+                m_capacity = count;
+                allocate(m_worldBuffer, count * sizeof(glm::mat4), m_world.data());
+                allocate(m_normalBuffer, count * sizeof(NormalMatrix), m_normal.data());
+                m_uploadBegin = m_uploadEnd = 0;
+                return;
+            }
+            if (m_uploadEnd <= m_uploadBegin)
+                return;
+            const std::size_t first = m_uploadBegin, length = m_uploadEnd - m_uploadBegin;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_worldBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(glm::mat4), length * sizeof(glm::mat4), m_world.data() + first);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_normalBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(NormalMatrix), length * sizeof(NormalMatrix), m_normal.data() + first);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            m_uploadBegin = m_uploadEnd = 0;
+        }
+        void Bind() const
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kNodeWorldBinding, m_worldBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kNodeNormalBinding, m_normalBuffer);
+        }
+
+    private:
+        static void allocate(GLuint &buffer, std::size_t size, const void *data)
+        {
+            if (!buffer)
+                glGenBuffers(1, &buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+            ResourceTracker::GetInstance().Track(ResourceKind::Buffer, buffer, ResourceCategory::DrawData, "TransformHierarchy", size);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+
+        std::vector<std::int32_t> m_parent;
+        std::vector<glm::mat4> m_local;
+        std::vector<glm::mat4> m_world;
+        std::vector<NormalMatrix> m_normal;
+        std::vector<std::uint8_t> m_dirty;
+        std::vector<std::uint32_t> m_updateList;
+        bool m_anyDirty = false;
+        // 已经计算但还没上传的节点区间
+        std::size_t m_uploadBegin = 0;
+        std::size_t m_uploadEnd = 0;
+        std::size_t m_capacity = 0;
+        GLuint m_worldBuffer = 0;
+        GLuint m_normalBuffer = 0;
+    };
+}
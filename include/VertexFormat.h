@@ -0,0 +1,213 @@
+#pragma once
+// 顶点格式：带骨骼的完整格式(Vertex, 88字节)和静态网格用的压缩格式(CompactVertex, 24字节)
+// 压缩格式：位置float3，法线八面体编码snorm16x2，切线八面体编码+副切线符号位(INT_2_10_10_10_REV)，UV为half2
+// 两种格式共用location 0(位置)和2(UV)，压缩法线和切线放在location 7、8，顶点着色器根据compactVertex uniform选择解码方式
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace ModelLoader
+{
+#define MAX_BONE_INFLUENCE 4
+
+    struct Vertex
+    {
+        // position
+        glm::vec3 Position;
+        // normal
+        glm::vec3 Normal;
+        // texCoords
+        glm::vec2 TexCoords;
+        // tangent
+        glm::vec3 Tangent;
+        // bitangent
+        glm::vec3 Bitangent;
+        // bone indexes which will influence this vertex
+        int m_BoneIDs[MAX_BONE_INFLUENCE];
+        // weights from each bone
+        float m_Weights[MAX_BONE_INFLUENCE];
+    };
+
+    struct CompactVertex
+    {
+        glm::vec3 Position;
+        std::int16_t Normal[2];
+        // x/y: 八面体编码的切线(10位snorm)，w: 副切线方向的符号(2位snorm)
+        std::uint32_t Tangent;
+        std::uint16_t TexCoords[2];
+    };
+    static_assert(sizeof(CompactVertex) == 24, "CompactVertex must stay 24 bytes");
+
+    enum class VertexFormat : std::uint32_t
+    {
+        Full = 0,
+        Compact = 1
+    };
+
+    constexpr GLuint kCompactNormalLocation = 7;
+    constexpr GLuint kCompactTangentLocation = 8;
+
+    // 实例化绘制的逐实例属性：模型矩阵占location 9~12，法线矩阵占13~15，来自单独的顶点缓冲绑定点(divisor为1)
+    constexpr GLuint kInstanceModelLocation = 9;
+    constexpr GLuint kInstanceNormalLocation = 13;
+    constexpr GLuint kInstanceBinding = 9;
+
+    struct InstanceData
+    {
+        glm::mat4 model;
+        glm::mat3 normal;
+    };
+    static_assert(sizeof(InstanceData) == 100, "InstanceData must be tightly packed");
+
+    inline std::size_t VertexStride(VertexFormat format)
+    {
+        return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+    }
+
+    // 索引宽度按网格选择：顶点数不超过65536的网格用16位索引，索引内存和读取带宽减半
+    enum class IndexType : std::uint32_t
+    {
+        UInt32 = 0,
+        UInt16 = 1
+    };
+    constexpr std::size_t kMaxShortIndexVertices = 65536;
+
+    inline std::size_t IndexSize(IndexType type)
+    {
+        return type == IndexType::UInt16 ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    }
+    inline GLenum GLIndexType(IndexType type)
+    {
+        return type == IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+    inline IndexType ChooseIndexType(std::size_t vertexCount)
+    {
+        return vertexCount <= kMaxShortIndexVertices ? IndexType::UInt16 : IndexType::UInt32;
+    }
+    // 32位索引压成16位，调用方保证所有索引都小于65536
+    inline void NarrowIndices(const unsigned int *source, std::size_t count, std::uint16_t *destination)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            destination[i] = static_cast<std::uint16_t>(source[i]);
+    }
+
+    // 任意宽度的索引展开成32位
+    inline void WidenIndices(const void *source, IndexType type, std::size_t count, unsigned int *destination)
+    {
+        if (type == IndexType::UInt16)
+        {
+            const auto *shortIndices = static_cast<const std::uint16_t *>(source);
+            for (std::size_t i = 0; i < count; i++)
+                destination[i] = shortIndices[i];
+        }
+        else
+            std::copy_n(static_cast<const unsigned int *>(source), count, destination);
+    }
+
+    // 单位向量的八面体映射，结果在[-1, 1]^2
+    inline glm::vec2 OctEncode(glm::vec3 n)
+    {
+        float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (sum < 1e-20f)
+            return glm::vec2(0.0f, 0.0f);
+        n = n / sum;
+        if (n.z >= 0.0f)
+            return glm::vec2(n.x, n.y);
+        return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    inline std::int16_t PackSnorm16(float v)
+    {
+        return static_cast<std::int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+    }
+    // GL_INT_2_10_10_10_REV：x在最低10位，w在最高2位
+    inline std::uint32_t PackSnorm1010102(float x, float y, float z, float w)
+    {
+        auto field = [](float v, int bits)
+        {
+            int maxValue = (1 << (bits - 1)) - 1;
+            int value = static_cast<int>(std::lround(std::clamp(v, -1.0f, 1.0f) * maxValue));
+            return static_cast<std::uint32_t>(value) & ((1u << bits) - 1u);
+        };
+        return field(x, 10) | (field(y, 10) << 10) | (field(z, 10) << 20) | (field(w, 2) << 30);
+    }
+
+    inline CompactVertex PackVertex(const Vertex &vertex)
+    {
+        CompactVertex packed{};
+        packed.Position = vertex.Position;
+        glm::vec2 normal = OctEncode(vertex.Normal);
+        packed.Normal[0] = PackSnorm16(normal.x);
+        packed.Normal[1] = PackSnorm16(normal.y);
+        glm::vec2 tangent = OctEncode(vertex.Tangent);
+        // 副切线由cross(N, T) * sign重建
+        float sign = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.Tangent = PackSnorm1010102(tangent.x, tangent.y, 0.0f, sign);
+        packed.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+        packed.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+        return packed;
+    }
+
+    // 为当前绑定的VAO/VBO设置顶点属性
+    inline void SetupVertexAttributes(VertexFormat format)
+    {
+        if (format == VertexFormat::Compact)
+        {
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, Position));
+            glEnableVertexAttribArray(kCompactNormalLocation);
+            glVertexAttribPointer(kCompactNormalLocation, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, Normal));
+            glEnableVertexAttribArray(kCompactTangentLocation);
+            glVertexAttribPointer(kCompactTangentLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, Tangent));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, TexCoords));
+            return;
+        }
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, m_BoneIDs));
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_Weights));
+    }
+
+    // 为当前绑定的VAO设置逐实例属性，缓冲由调用方用glBindVertexBuffer(kInstanceBinding, ...)绑定
+    inline void SetupInstanceAttributes()
+    {
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(kInstanceModelLocation + column);
+            glVertexAttribFormat(kInstanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+            glVertexAttribBinding(kInstanceModelLocation + column, kInstanceBinding);
+        }
+        for (GLuint column = 0; column < 3; column++)
+        {
+            glEnableVertexAttribArray(kInstanceNormalLocation + column);
+            glVertexAttribFormat(kInstanceNormalLocation + column, 3, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(InstanceData, normal) + column * sizeof(glm::vec3)));
+            glVertexAttribBinding(kInstanceNormalLocation + column, kInstanceBinding);
+        }
+        glVertexBindingDivisor(kInstanceBinding, 1);
+    }
+}
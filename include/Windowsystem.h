@@ -164,7 +164,8 @@ namespace Renderer
         /*******glfw初始化*******/
         glfwInit();
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        // 着色器都是#version 460，GeometryArena需要glBufferStorage(4.4)
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         // 创建窗口
         m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
@@ -0,0 +1,306 @@
+#define STB_IMAGE_IMPLEMENTATION
+// 模型加载流程的基准测试：不显示窗口，逐个加载pbr/下的模型N次，按阶段输出耗时、CPU时间和峰值内存(JSON/CSV)
+// 可以在Mesa llvmpipe这类软件GL驱动下运行(--software)，方便在没有显卡的机器上做回归对比
+// 用法: loadBenchmark [--iterations N] [--mode cold|warm|both] [--json out.json] [--csv out.csv]
+//                     [--software] [--no-mesh-cache] [--no-compress] [--serial] [--sync-textures] [--no-native-gltf]
+//                     [--material-textures bindless|arrays|bind] [模型路径...]
+// 加载完成后把材质贴图解析成bindless句柄或纹理数组的层("material.textures"阶段)，在llvmpipe上用arrays也能覆盖回退路径
+// 每个模型先做一次不计入结果的加载生成网格/纹理缓存，cold模式再在每次加载前把模型目录下的文件从系统文件缓存中清出去(目前只支持Linux/macOS的posix_fadvise)
+// 没有显示器的Linux上用GLFW 3.4的null平台+OSMesa；更早的GLFW用 xvfb-run loadBenchmark --software 运行
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "BenchmarkCommon.h"
+#include "MaterialTextures.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "TextureStreamer.h"
+#include "filesystem.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct BenchmarkOptions : Benchmark::CommonOptions
+    {
+        int iterations = 3;
+        bool cold = false;
+        bool warm = true;
+        std::vector<std::string> assets;
+        ModelLoader::ModelLoadOptions load;
+    };
+
+    struct BenchmarkRun
+    {
+        std::string asset;
+        const char *mode = "warm";
+        int iteration = 0;
+        double wallMs = 0.0;
+        double cpuMs = 0.0;
+        std::uint64_t peakResidentBytes = 0;
+        std::vector<Renderer::ProfileStage> stages;
+    };
+
+    bool parseArgs(int argc, char **argv, BenchmarkOptions &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--iterations" && hasValue)
+                options.iterations = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--mode" && hasValue)
+            {
+                std::string mode = argv[++i];
+                options.cold = mode == "cold" || mode == "both";
+                options.warm = mode == "warm" || mode == "both";
+                if (!options.cold && !options.warm)
+                    return false;
+            }
+            else if (bool valid = true; Benchmark::ParseCommonArg(argc, argv, i, options, valid))
+            {
+                if (!valid)
+                    return false;
+            }
+            else if (arg == "--no-mesh-cache")
+                options.load.useMeshCache = false;
+            else if (arg == "--no-compress")
+                options.load.compressTextures = false;
+            else if (arg == "--serial")
+                options.load.parallelConversion = false;
+            else if (arg == "--sync-textures")
+                options.load.asyncTextures = false;
+            else if (arg == "--no-native-gltf")
+                options.load.nativeGltf = false;
+            else if (!arg.empty() && arg[0] == '-')
+                return false;
+            else
+                options.assets.push_back(arg);
+        }
+        return true;
+    }
+
+    // 默认测试pbr/下所有能加载的模型
+    std::vector<std::string> findAssets(const std::string &root)
+    {
+        std::vector<std::string> assets;
+        std::error_code ec;
+        for (auto iter = std::filesystem::recursive_directory_iterator(root, ec); !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec))
+        {
+            if (!iter->is_regular_file())
+                continue;
+            std::string extension = iter->path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                           { return static_cast<char>(std::tolower(c)); });
+            if (extension == ".gltf" || extension == ".glb" || extension == ".obj" || extension == ".fbx")
+                assets.push_back(iter->path().generic_string());
+        }
+        std::sort(assets.begin(), assets.end());
+        return assets;
+    }
+
+    // 把模型目录下的所有文件(模型、.bin、贴图、网格/纹理缓存)从系统文件缓存中清出去
+    bool evictFileCache(const std::string &asset)
+    {
+#ifdef _WIN32
+        return false;
+#else
+        std::error_code ec;
+        auto directory = std::filesystem::path(asset).parent_path();
+        for (auto iter = std::filesystem::recursive_directory_iterator(directory, ec); !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec))
+        {
+            if (!iter->is_regular_file())
+                continue;
+            int fd = open(iter->path().c_str(), O_RDONLY);
+            if (fd < 0)
+                continue;
+            fdatasync(fd);
+#ifdef POSIX_FADV_DONTNEED
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+            close(fd);
+        }
+        return true;
+#endif
+    }
+
+    std::string jsonEscape(const std::string &text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+    double toMB(std::uint64_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+    void writeJson(const std::string &path, const std::string &renderer, const BenchmarkOptions &options, const std::vector<BenchmarkRun> &runs)
+    {
+        std::ofstream out(path);
+        out << std::fixed << std::setprecision(3);
+        out << "{\n  \"renderer\": \"" << jsonEscape(renderer) << "\",\n  \"iterations\": " << options.iterations << ",\n  \"runs\": [";
+        for (std::size_t i = 0; i < runs.size(); i++)
+        {
+            const auto &run = runs[i];
+            out << (i ? "," : "") << "\n    {\"asset\": \"" << jsonEscape(run.asset) << "\", \"mode\": \"" << run.mode << "\", \"iteration\": " << run.iteration
+                << ", \"wallMs\": " << run.wallMs << ", \"cpuMs\": " << run.cpuMs << ", \"peakRssMB\": " << toMB(run.peakResidentBytes) << ", \"stages\": [";
+            for (std::size_t j = 0; j < run.stages.size(); j++)
+            {
+                const auto &stage = run.stages[j];
+                out << (j ? ", " : "") << "{\"name\": \"" << stage.name << "\", \"calls\": " << stage.calls << ", \"wallMs\": " << stage.wallMs
+                    << ", \"cpuMs\": " << stage.cpuMs << ", \"peakRssMB\": " << toMB(stage.peakResidentBytes) << ", \"peakGrowthMB\": " << toMB(stage.peakGrowthBytes) << "}";
+            }
+            out << "]}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // 每个阶段一行，"total"行是整次加载
+    void writeCsv(const std::string &path, const std::vector<BenchmarkRun> &runs)
+    {
+        std::ofstream out(path);
+        out << std::fixed << std::setprecision(3);
+        out << "asset,mode,iteration,stage,calls,wall_ms,cpu_ms,peak_rss_mb,peak_growth_mb\n";
+        for (const auto &run : runs)
+        {
+            out << '"' << run.asset << "\"," << run.mode << ',' << run.iteration << ",total,1," << run.wallMs << ',' << run.cpuMs << ','
+                << toMB(run.peakResidentBytes) << ",0\n";
+            for (const auto &stage : run.stages)
+            {
+                out << '"' << run.asset << "\"," << run.mode << ',' << run.iteration << ',' << stage.name << ',' << stage.calls << ',' << stage.wallMs << ','
+                    << stage.cpuMs << ',' << toMB(stage.peakResidentBytes) << ',' << toMB(stage.peakGrowthBytes) << '\n';
+            }
+        }
+    }
+
+    BenchmarkRun loadOnce(const std::string &asset, const BenchmarkOptions &options)
+    {
+        auto &profiler = Renderer::Profiler::GetInstance();
+        profiler.Reset();
+        BenchmarkRun run;
+        run.asset = asset;
+        double cpuStart = Renderer::ProcessCpuMs();
+        auto start = std::chrono::steady_clock::now();
+        {
+            // 整次加载作为一个阶段，得到这一次加载期间的常驻内存峰值(进程级的peak RSS在预热加载之后就不再变化)
+            Renderer::ProfileScope loadScope("load");
+            ModelLoader::Model model(asset, true, true, options.load);
+            // 异步纹理也要全部上传完才算加载结束
+            Renderer::TextureStreamer::GetInstance().Flush();
+            {
+                Renderer::ProfileScope scope("material.textures", true);
+                for (auto &mesh : model.meshes)
+                    mesh->ResolveMaterialTextures();
+            }
+            glFinish();
+            run.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            run.cpuMs = Renderer::ProcessCpuMs() - cpuStart;
+        }
+        run.stages = profiler.Snapshot();
+        for (const auto &stage : run.stages)
+        {
+            if (stage.name == "load")
+                run.peakResidentBytes = stage.peakResidentBytes;
+        }
+        return run;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        std::cout << "usage: loadBenchmark [--iterations N] [--mode cold|warm|both] [--json out.json] [--csv out.csv] "
+                     "[--software] [--no-mesh-cache] [--no-compress] [--serial] [--sync-textures] [--no-native-gltf] [--material-textures bindless|arrays|bind] [assets...]"
+                  << std::endl;
+        return 1;
+    }
+    if (options.assets.empty())
+        options.assets = findAssets(FileSystem::getPath("pbr"));
+
+    // 加载只需要glBufferStorage(4.4)，llvmpipe等驱动可能只有4.5
+    GLFWwindow *window = Benchmark::CreateHiddenContext(options.software, "loadBenchmark", 5);
+    if (!window)
+    {
+        std::cout << "loadBenchmark: failed to create an OpenGL 4.5+ context" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "loadBenchmark: failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    std::string renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    std::cout << "loadBenchmark: " << renderer << " (" << glGetString(GL_VERSION) << "), " << options.assets.size() << " assets" << std::endl;
+    Renderer::MaterialTextures::GetInstance().Initialize(options.materialTextures);
+
+    auto &profiler = Renderer::Profiler::GetInstance();
+    profiler.SetEnabled(true);
+    profiler.SetGpuSync(true);
+
+    std::vector<BenchmarkRun> runs;
+    for (const char *mode : {"cold", "warm"})
+    {
+        bool cold = mode[0] == 'c';
+        if ((cold && !options.cold) || (!cold && !options.warm))
+            continue;
+        for (const auto &asset : options.assets)
+        {
+            // 先加载一次生成网格/纹理缓存(.meshcache/.texcache)，不计入结果；否则第一次cold要多付导入、BC7/BC5编码和写缓存的开销，
+            // 和之后命中缓存的几次不是同一条路径。cold每次再把文件清出系统缓存，warm则直接命中系统缓存
+            loadOnce(asset, options);
+            for (int iteration = 0; iteration < options.iterations; iteration++)
+            {
+                if (cold && !evictFileCache(asset))
+                {
+                    std::cout << "loadBenchmark: cold mode is not supported on this platform" << std::endl;
+                    break;
+                }
+                auto &run = runs.emplace_back(loadOnce(asset, options));
+                run.mode = mode;
+                run.iteration = iteration;
+            }
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << "\nloadBenchmark results (ms, summed over threads for parallel stages)" << std::endl;
+    for (const auto &run : runs)
+    {
+        std::cout << run.mode << " #" << run.iteration << ' ' << run.asset << ": wall " << run.wallMs << ", cpu " << run.cpuMs << ", peak RSS "
+                  << toMB(run.peakResidentBytes) << " MB" << std::endl;
+        for (const auto &stage : run.stages)
+        {
+            std::cout << "    " << std::left << std::setw(20) << stage.name << std::right << " x" << std::setw(4) << stage.calls << "  wall " << std::setw(9)
+                      << stage.wallMs << "  cpu " << std::setw(9) << stage.cpuMs << "  peak +" << toMB(stage.peakGrowthBytes) << " MB" << std::endl;
+        }
+    }
+    if (!options.jsonPath.empty())
+        writeJson(options.jsonPath, renderer, options, runs);
+    if (!options.csvPath.empty())
+        writeCsv(options.csvPath, runs);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
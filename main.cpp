@@ -57,10 +57,8 @@ int main()
     // 延迟着色
     // 将pbrShader将入到渲染命令中
     Renderer::RenderCommand InitRenderCommand("deferredInitFunc", deferredInitFunc, 1000, gBuffer.m_GbufferGeometryPass.getShaderPtr());
-    Renderer::RenderCommand InitLightRenderCommand("lightBoxInitFunc", lightBoxInitFunc, 2000, lightShader.getShaderPtr());
     auto initQueue = pbrRender.GetInitQueue();
     initQueue->AddRenderCommand(InitRenderCommand);
-    initQueue->AddRenderCommand(InitLightRenderCommand);
 
     Renderer::RenderCommand LoopRenderCommand1("deferredRenderGeometryFunc", deferredRenderGeometryFunc, 1000, gBuffer.m_GbufferGeometryPass.getShaderPtr());
     Renderer::RenderCommand LoopRenderCommand2("deferredRenderShaderFunc", deferredRenderShaderFunc, 2000, gBuffer.m_GbufferLightingPass.getShaderPtr());
@@ -72,8 +70,8 @@ int main()
     renderQueue->AddRenderCommand(LoopLightRenderCommand);
 
     Renderer::Scene scene("testScene");
-    Model helmetModel(FileSystem::getPath("pbr/DamagedHelmet/glTF/DamagedHelmet.gltf").c_str(), true, true);
-    scene.AddModel(std::make_shared<Model>(helmetModel));
+    // 异步加载，渲染循环开始时先绘制包围盒代理
+    scene.AddModelAsync(FileSystem::getPath("pbr/DamagedHelmet/glTF/DamagedHelmet.gltf"), true, true);
     // Model gunModel(FileSystem::getPath("pbr/gltf_Cerberus_low/Cerberus_LP.gltf").c_str(), true, true);
     // scene.AddModel(std::make_shared<Model>(gunModel));
 
@@ -62,4 +62,40 @@ PYBIND11_MODULE(renderPyApi, m)
         .def("RenderTestUpdate", &PBRRender::RenderTestUpdate, "Update the render test")
         .def("RenderTestShouldClose", &PBRRender::RenderTestShouldClose, "Check if the render test should close")
         .def("ReadCurFrameBufferToNumpy", &PBRRender::ReadCurFrameBufferToNumpy, "Read the current framebuffer to numpy array");
+    // 显存/内存占用统计，字段和C++的ResourceStats一致
+    pybind11::class_<ResourceStats>(m, "ResourceStats", "Live/peak bytes and allocation counts of a resource category")
+        .def_property_readonly("category", [](const ResourceStats &stats)
+                               { return ResourceCategoryName(stats.category); })
+        .def_readonly("liveBytes", &ResourceStats::liveBytes)
+        .def_readonly("peakBytes", &ResourceStats::peakBytes)
+        .def_readonly("liveCount", &ResourceStats::liveCount)
+        .def_readonly("allocations", &ResourceStats::allocations);
+    m.def("GetResourceStats", []()
+          {
+              pybind11::dict result;
+              for (const auto &stats : ResourceTracker::GetInstance().Snapshot())
+                  result[ResourceCategoryName(stats.category)] = stats;
+              return result; }, "Get the stats of every resource category as a dict keyed by category name");
+    m.def("GetResourceTotals", []()
+          {
+              auto &tracker = ResourceTracker::GetInstance();
+              pybind11::dict result;
+              result["gpu"] = tracker.GpuTotal();
+              result["host"] = tracker.HostTotal();
+              return result; }, "Get the summed stats of all GPU and all host categories");
+    m.def("GetResourceOwners", []()
+          {
+              pybind11::list result;
+              for (const auto &owner : ResourceTracker::GetInstance().Owners())
+              {
+                  pybind11::dict entry;
+                  entry["category"] = ResourceCategoryName(owner.category);
+                  entry["owner"] = owner.owner;
+                  entry["liveBytes"] = owner.liveBytes;
+                  entry["liveCount"] = owner.liveCount;
+                  result.append(entry);
+              }
+              return result; }, "Get the live resources grouped by category and owner, largest first");
+    m.def("ResetResourcePeaks", []()
+          { ResourceTracker::GetInstance().ResetPeaks(); }, "Restart peak bytes and allocation counts from the current live values");
 }
\ No newline at end of file
@@ -11,7 +11,8 @@ uniform sampler2D gAlbedoMetallic;
 uniform vec3 lightPositions[4];
 uniform vec3 lightColors[4];
 
-uniform vec3 camPos;
+// 每帧一次的相机和时间数据(FrameDataBuffer)
+#include "../frame_data.glsl"
 
 const float PI = 3.14159265359;
 // ----------------------------------------------------------------------------
@@ -77,7 +78,7 @@ void main()
 
     // input lighting data
     vec3 N=texture(gNormalAO, TexCoords).rgb;
-    vec3 V = normalize(camPos - WorldPos);
+    vec3 V = normalize(cameraPosition.xyz - WorldPos);
     vec3 R = reflect(-V, N); 
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
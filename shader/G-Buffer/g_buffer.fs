@@ -1,4 +1,8 @@
 #version 460 core
+// MATERIAL_BINDLESS/MATERIAL_TEXTURE_ARRAYS由MaterialTextures::Initialize插入到#version之后
+#if defined(MATERIAL_BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
 layout (location = 0) out vec4 gPositionRoughness;
 layout (location = 1) out vec4 gNormalAO;
 layout (location = 2) out vec4 gAlbedoMetallic;
@@ -8,8 +12,8 @@ in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
 
-//material parameters block
-layout (std140,binding=0) uniform MaterialBlock
+//material parameters: 所有网格的材质在一个SSBO数组里(MaterialBuffer)，按顶点着色器传来的MaterialIndex读取
+struct MaterialData
 {
  vec3 albedo;
  float metallic;
@@ -21,7 +25,14 @@ layout (std140,binding=0) uniform MaterialBlock
  bool useRoughnessMap;
  bool useAOMap;
  bool useEmissiveMap;
-}materialProperties;
+ // albedo/normal/metallic/roughness/ao的贴图引用：bindless句柄或者(纹理数组下标, 层)，全1表示用下面逐次绑定的采样器
+ uvec2 textures[5];
+};
+layout (std430, binding = 3) readonly buffer MaterialBuffer
+{
+ MaterialData materials[];
+};
+flat in int MaterialIndex;
 // texture samplers struct(不透明数据只能放在uniform里)
 struct MaterialTexture{
  sampler2D albedoMap;
@@ -31,10 +42,32 @@ struct MaterialTexture{
  sampler2D aoMap;
 };
 uniform MaterialTexture material;
+#if defined(MATERIAL_TEXTURE_ARRAYS)
+// 按(格式, 尺寸)分组的材质纹理数组，固定绑定在8~15号纹理单元
+layout (binding = 8) uniform sampler2DArray materialArrays[8];
+#endif
+MaterialData materialProperties;
+
+vec4 sampleMaterial(uint slot, sampler2D bound)
+{
+    uvec2 ref = materialProperties.textures[slot];
+    if (ref == uvec2(0xFFFFFFFFu))
+        return texture(bound, TexCoords);
+#if defined(MATERIAL_BINDLESS)
+    return texture(sampler2D(ref), TexCoords);
+#elif defined(MATERIAL_TEXTURE_ARRAYS)
+    return texture(materialArrays[ref.x], vec3(TexCoords, float(ref.y)));
+#else
+    return texture(bound, TexCoords);
+#endif
+}
 
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(material.normalMap, TexCoords).xyz * 2.0 - 1.0;
+    // 法线贴图可能是BC5压缩的(只有xy)，z由单位长度重建
+    vec3 tangentNormal;
+    tangentNormal.xy = sampleMaterial(1u, material.normalMap).rg * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
@@ -50,10 +83,11 @@ vec3 getNormalFromMap()
 }
 
 void main()
-{    
-    vec3 albedo = materialProperties.useAlbedoMap? (texture(material.albedoMap, TexCoords).rgb) : materialProperties.albedo;
-    float metallic= materialProperties.useMetallicMap? (texture(material.metallicMap, TexCoords).b) : materialProperties.metallic;
-    float roughness = materialProperties.useRoughnessMap? (texture(material.roughnessMap, TexCoords).g) : materialProperties.roughness;
+{
+    materialProperties = materials[MaterialIndex];
+    vec3 albedo = materialProperties.useAlbedoMap? (sampleMaterial(0u, material.albedoMap).rgb) : materialProperties.albedo;
+    float metallic= materialProperties.useMetallicMap? (sampleMaterial(2u, material.metallicMap).b) : materialProperties.metallic;
+    float roughness = materialProperties.useRoughnessMap? (sampleMaterial(3u, material.roughnessMap).g) : materialProperties.roughness;
     //float ao = material.useAOMap? (texture(material.aoMap, TexCoords).r) : 1.0f;
     float ao=1.0f;
     
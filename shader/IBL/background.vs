@@ -1,8 +1,8 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// 每帧一次的相机和时间数据(FrameDataBuffer)
+#include "../frame_data.glsl"
 
 out vec3 WorldPos;
 
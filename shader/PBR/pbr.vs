@@ -2,21 +2,79 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// 压缩顶点格式(CompactVertex)：八面体编码的法线，以及八面体编码的切线+副切线符号
+// (片元着色器目前用屏幕空间导数构建TBN，切线暂时没有用到)
+layout (location = 7) in vec2 aOctNormal;
+layout (location = 8) in vec4 aOctTangent;
+// 实例化绘制(instanced为true)：逐实例的模型矩阵和法线矩阵，作用在整个模型上
+layout (location = 9) in mat4 aInstanceModel;
+layout (location = 13) in mat3 aInstanceNormal;
 
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+// 材质槽位：普通绘制来自materialIndex uniform，间接绘制来自每条命令的绘制数据
+flat out int MaterialIndex;
 
-uniform mat4 projection;
-uniform mat4 view;
+// 每帧一次的相机和时间数据(FrameDataBuffer)
+#include "../frame_data.glsl"
 uniform mat4 model;
 uniform mat3 normalMatrix;
+uniform bool compactVertex;
+uniform bool instanced;
+// 模型的节点层级(Model::GetTransforms)：nodeTransform为true时按nodeIndex读取节点的世界矩阵和法线矩阵，否则用model/normalMatrix
+layout (std430, binding = 1) readonly buffer NodeWorld
+{
+    mat4 nodeWorld[];
+};
+layout (std430, binding = 2) readonly buffer NodeNormal
+{
+    mat3 nodeNormal[];
+};
+uniform bool nodeTransform;
+uniform int nodeIndex;
+uniform int materialIndex;
+// 间接绘制(IndirectDrawBuffer)：indirectDraw为true时按indirectDrawBase + gl_DrawID读取每条命令的世界矩阵、法线矩阵和材质槽位
+struct IndirectDraw
+{
+    mat4 world;
+    mat3 normal;
+    uint materialIndex;
+};
+layout (std430, binding = 4) readonly buffer IndirectDraws
+{
+    IndirectDraw indirectDraws[];
+};
+uniform bool indirectDraw;
+uniform int indirectDrawBase;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = normalMatrix * aNormal;   
+    mat4 base = nodeTransform ? nodeWorld[nodeIndex] : model;
+    mat3 baseNormal = nodeTransform ? nodeNormal[nodeIndex] : normalMatrix;
+    MaterialIndex = materialIndex;
+    if (indirectDraw)
+    {
+        IndirectDraw draw = indirectDraws[indirectDrawBase + gl_DrawID];
+        base = draw.world;
+        baseNormal = draw.normal;
+        MaterialIndex = int(draw.materialIndex);
+    }
+    mat4 world = instanced ? aInstanceModel * base : base;
+    mat3 normalWorld = instanced ? aInstanceNormal * baseNormal : baseNormal;
+    WorldPos = vec3(world * vec4(aPos, 1.0));
+    vec3 normal = compactVertex ? octDecode(aOctNormal) : aNormal;
+    Normal = normalWorld * normal;
 
-    gl_Position =  projection * view * vec4(WorldPos, 1.0);
+    gl_Position =  viewProjection * vec4(WorldPos, 1.0);
 }
\ No newline at end of file
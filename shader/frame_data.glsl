@@ -0,0 +1,20 @@
+// 每帧一次的相机和时间数据(FrameDataBuffer)，所有着色器共用binding 0，成员必须和FrameDataBuffer.h里的FrameData一致
+// 着色器里用 #include "../frame_data.glsl" 引入(路径相对于着色器文件)，由Shader在编译前展开
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 previousView;
+    mat4 previousProjection;
+    mat4 previousViewProjection;
+    vec4 cameraPosition;
+    vec2 resolution;
+    float time;
+    float deltaTime;
+    float nearPlane;
+    float farPlane;
+    uint frameIndex;
+};